@@ -0,0 +1,87 @@
+// MotionPayload.h
+// Binary telemetry payload, version 1, as decoded by the Pi (pi/src/Payload.cpp).
+// Plain C++ without Arduino headers, so it also builds on the host.
+//
+// All fields little-endian:
+//   header, 16 bytes:  'M' 'D' version(u8 = 1) count(u8)
+//                      deviceId(u32) seq(u32) uptimeMs(u32, device millis() at send)
+//   count entries, 8 bytes each:
+//                      key(u32, FNV-1a hash of the SSID) ageMs(u16, how long before
+//                      uptimeMs the sample was taken) rssi(i8, dBm) flags(u8, 0)
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+static const uint8_t  MOTION_PAYLOAD_VERSION = 1;
+static const size_t   MOTION_PAYLOAD_HEADER = 16;
+static const size_t   MOTION_PAYLOAD_ENTRY = 8;
+static const size_t   MOTION_PAYLOAD_MAX_ENTRIES = 255;
+
+struct MotionEntry {
+  uint32_t key;     // motionSsidHash() of the network
+  uint16_t ageMs;   // sample time = header uptimeMs - ageMs
+  int8_t   rssi;    // dBm
+};
+
+// FNV-1a, 32 bit
+inline uint32_t motionSsidHash(const char* ssid) {
+  uint32_t h = 2166136261u;
+  for (; *ssid; ++ssid) {
+    h ^= static_cast<uint8_t>(*ssid);
+    h *= 16777619u;
+  }
+  return h;
+}
+
+inline size_t motionPayloadSize(size_t count) {
+  return MOTION_PAYLOAD_HEADER + count * MOTION_PAYLOAD_ENTRY;
+}
+
+inline uint8_t* motionPutU16(uint8_t* p, uint16_t v) {
+  p[0] = static_cast<uint8_t>(v);
+  p[1] = static_cast<uint8_t>(v >> 8);
+  return p + 2;
+}
+
+inline uint8_t* motionPutU32(uint8_t* p, uint32_t v) {
+  p[0] = static_cast<uint8_t>(v);
+  p[1] = static_cast<uint8_t>(v >> 8);
+  p[2] = static_cast<uint8_t>(v >> 16);
+  p[3] = static_cast<uint8_t>(v >> 24);
+  return p + 4;
+}
+
+// Header only, for senders that stream the entries after it (see motionPutEntry)
+inline size_t encodeMotionHeader(uint8_t* out, uint32_t deviceId, uint32_t seq,
+                                 uint32_t uptimeMs, size_t count) {
+  out[0] = 'M';
+  out[1] = 'D';
+  out[2] = MOTION_PAYLOAD_VERSION;
+  out[3] = static_cast<uint8_t>(count);
+  uint8_t* p = motionPutU32(out + 4, deviceId);
+  p = motionPutU32(p, seq);
+  motionPutU32(p, uptimeMs);
+  return MOTION_PAYLOAD_HEADER;
+}
+
+inline size_t motionPutEntry(uint8_t* out, const MotionEntry& e) {
+  uint8_t* p = motionPutU32(out, e.key);
+  p = motionPutU16(p, e.ageMs);
+  p[0] = static_cast<uint8_t>(e.rssi);
+  p[1] = 0;
+  return MOTION_PAYLOAD_ENTRY;
+}
+
+// Whole payload into out[0..cap). Returns its size, or 0 if it does not fit
+// (or count is 0 or above MOTION_PAYLOAD_MAX_ENTRIES).
+inline size_t encodeMotionPayload(uint8_t* out, size_t cap, uint32_t deviceId, uint32_t seq,
+                                  uint32_t uptimeMs, const MotionEntry* entries, size_t count) {
+  if (count == 0 || count > MOTION_PAYLOAD_MAX_ENTRIES || cap < motionPayloadSize(count)) {
+    return 0;
+  }
+  size_t n = encodeMotionHeader(out, deviceId, seq, uptimeMs, count);
+  for (size_t i = 0; i < count; ++i) {
+    n += motionPutEntry(out + n, entries[i]);
+  }
+  return n;
+}
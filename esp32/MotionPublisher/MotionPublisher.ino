@@ -1,15 +1,39 @@
 #include <WiFi.h>
 #include <PubSubClient.h>
+#include <esp_timer.h>
+#include "MotionPayload.h"
+#include "SampleBatcher.h"
 
 // 1) Home Wi-Fi credentials
 const char* ssidAP     = "Starlink";
 const char* passwordAP = "159632487";
 // 2) Raspberry Pi IP on LAN
 const char* mqttServer = "192.168.1.187";
+// 3) This board: topic motion/esp32/<DEVICE_ID>
+const uint32_t DEVICE_ID = 1;
+const char*    mqttTopic = "motion/esp32/1";
+// 4) Sampling and batching: SAMPLE_HZ readings per second, published BATCH at a
+//    time (or once the oldest is BATCH_MAX_AGE_MS old)
+const uint32_t SAMPLE_HZ        = 25;
+const size_t   BATCH            = 10;
+const uint32_t BATCH_MAX_AGE_MS = 1000;
 
 WiFiClient   espClient;
 PubSubClient mqtt(espClient);
 
+// ~10 s of samples at 25 Hz, kept while the broker is unreachable
+SampleBatcher<256> batcher;
+// SSID hash of the current AP (set on connect; the sampling timer reads it)
+volatile uint32_t apKey = 0;
+esp_timer_handle_t sampleTimer;
+
+// esp_timer task context: read the RSSI and queue it
+void sampleRssi(void*) {
+  if (WiFi.status() == WL_CONNECTED) {
+    batcher.push(apKey, static_cast<int8_t>(WiFi.RSSI()), millis());
+  }
+}
+
 void connectWiFi() {
   Serial.printf("Connecting to Wi-Fi \"%s\" …", ssidAP);
   WiFi.begin(ssidAP, passwordAP);
@@ -17,6 +41,7 @@ void connectWiFi() {
     delay(500); Serial.print(".");
   }
   Serial.printf("\nConnected, IP: %s\n", WiFi.localIP().toString().c_str());
+  apKey = motionSsidHash(WiFi.SSID().c_str());
 }
 
 void connectMQTT() {
@@ -35,6 +60,10 @@ void setup() {
   Serial.begin(115200);
   connectWiFi();
   mqtt.setServer(mqttServer, 1883);
+
+  const esp_timer_create_args_t args = { sampleRssi, nullptr, ESP_TIMER_TASK, "rssi" };
+  esp_timer_create(&args, &sampleTimer);
+  esp_timer_start_periodic(sampleTimer, 1000000 / SAMPLE_HZ);
 }
 
 void loop() {
@@ -42,13 +71,13 @@ void loop() {
   if (!mqtt.connected())       connectMQTT();
   mqtt.loop();
 
-  long rssi = WiFi.RSSI();
-  String ssid = WiFi.SSID();
-  // payload = "SSID,RSSI"
-  String payload = ssid + "," + String(rssi);
-  bool ok = mqtt.publish("motion/esp32/1", payload.c_str());
-  Serial.printf("%s | RSSI=%ld dBm | %s\n",
-                ssid.c_str(), rssi, ok?"Pub OK":"Pub FAIL");
-
-  delay(500);
+  // one streamed publish per batch instead of one packet per reading
+  uint32_t now = millis();
+  if (batcher.due(BATCH, now, BATCH_MAX_AGE_MS)) {
+    size_t sent = batcher.publish(mqtt, mqttTopic, DEVICE_ID, now, BATCH);
+    Serial.printf("seq=%lu | %u samples | pending=%u dropped=%lu | %s\n",
+                  (unsigned long)batcher.seq(), (unsigned)sent, (unsigned)batcher.pending(),
+                  (unsigned long)batcher.dropped(), sent ? "Pub OK" : "Pub FAIL");
+  }
+  delay(5);
 }
@@ -309,6 +309,31 @@ boolean PubSubClient::readByte(uint8_t * result, uint16_t * index){
   return false;
 }
 
+// reads length bytes into result, taking from the client as much as it has
+// available per read instead of one byte at a time
+boolean PubSubClient::readBytes(uint8_t * result, size_t length) {
+    uint32_t previousMillis = millis();
+    while (length > 0) {
+        int rc = 0;
+        int available = _client->available();
+        if (available > 0) {
+            rc = _client->read(result, (size_t)available < length ? (size_t)available : length);
+        }
+        if (rc > 0) {
+            result += rc;
+            length -= rc;
+            previousMillis = millis();
+            continue;
+        }
+        yield();
+        uint32_t currentMillis = millis();
+        if(currentMillis - previousMillis >= ((int32_t) this->socketTimeout * 1000)){
+            return false;
+        }
+    }
+    return true;
+}
+
 uint32_t PubSubClient::readPacket(uint8_t* lengthLength) {
     uint16_t len = 0;
     if(!readByte(this->buffer, &len)) return 0;
@@ -345,20 +370,32 @@ uint32_t PubSubClient::readPacket(uint8_t* lengthLength) {
         }
     }
     uint32_t idx = len;
-
-    for (uint32_t i = start;i<length;i++) {
-        if(!readByte(&digit)) return 0;
-        if (this->stream) {
-            if (isPublish && idx-*lengthLength-2>skip) {
-                this->stream->write(digit);
-            }
-        }
-
+    uint32_t remaining = length > start ? length - start : 0;
+    uint32_t payloadStart = *lengthLength + 3 + skip; // first byte passed to the Stream
+    uint8_t scratch[32];
+
+    while (remaining > 0) {
+        // Straight into the buffer while it has room; the rest of an oversized
+        // packet goes through scratch (streamed and/or dropped)
+        uint8_t* dst = scratch;
+        size_t n = sizeof(scratch);
         if (len < this->bufferSize) {
-            this->buffer[len] = digit;
-            len++;
+            dst = this->buffer + len;
+            n = this->bufferSize - len;
+        }
+        if (n > remaining) {
+            n = remaining;
         }
-        idx++;
+        if(!readBytes(dst, n)) return 0;
+        if (this->stream && isPublish && idx + n > payloadStart) {
+            size_t from = idx < payloadStart ? payloadStart - idx : 0;
+            this->stream->write(dst + from, n - from);
+        }
+        if (dst != scratch) {
+            len += n;
+        }
+        idx += n;
+        remaining -= n;
     }
 
     if (!this->stream && idx > this->bufferSize) {
@@ -523,6 +560,52 @@ boolean PubSubClient::publish_P(const char* topic, const uint8_t* payload, unsig
     return (rc == expectedLength);
 }
 
+boolean PubSubClient::publishDirect(const char* topic, const uint8_t* payload, unsigned int plength, boolean retained) {
+    PubSubSegment segment = { payload, plength };
+    return publishSegments(topic, &segment, 1, retained);
+}
+
+boolean PubSubClient::publishSegments(const char* topic, const PubSubSegment* segments, size_t count, boolean retained) {
+    if (!connected() || topic == NULL) {
+        return false;
+    }
+    size_t tlen = strlen(topic);
+    uint32_t remaining = 2 + tlen;
+    for (size_t i = 0; i < count; i++) {
+        if (segments[i].length > 268435455UL - remaining) {
+            // Too long for the remaining length field
+            return false;
+        }
+        remaining += segments[i].length;
+    }
+    if (tlen > 0xFFFF || remaining > 268435455UL) {
+        return false;
+    }
+
+    // Fixed header, remaining length and topic length: the only bytes not taken
+    // from the caller
+    uint8_t header[MQTT_MAX_HEADER_SIZE + 2];
+    uint8_t pos = 0;
+    header[pos++] = retained ? (MQTTPUBLISH | 1) : MQTTPUBLISH;
+    do {
+        uint8_t digit = remaining & 127; //digit = remaining %128
+        remaining >>= 7; //remaining = remaining / 128
+        if (remaining > 0) {
+            digit |= 0x80;
+        }
+        header[pos++] = digit;
+    } while (remaining > 0);
+    header[pos++] = (tlen >> 8);
+    header[pos++] = (tlen & 0xFF);
+
+    boolean rc = writeSegment(header, pos) && writeSegment((const uint8_t*)topic, tlen);
+    for (size_t i = 0; rc && i < count; i++) {
+        rc = writeSegment(segments[i].data, segments[i].length);
+    }
+    lastOutActivity = millis();
+    return rc;
+}
+
 boolean PubSubClient::beginPublish(const char* topic, unsigned int plength, boolean retained) {
     if (connected()) {
         // Send the header and variable length field
@@ -602,6 +685,26 @@ boolean PubSubClient::write(uint8_t header, uint8_t* buf, uint16_t length) {
 #endif
 }
 
+// writes data to the client in as many calls as it takes (at most MQTT_MAX_TRANSFER_SIZE
+// bytes each, if defined); false once the client accepts nothing
+boolean PubSubClient::writeSegment(const uint8_t* data, size_t length) {
+    while (length > 0) {
+        size_t bytesToWrite = length;
+#ifdef MQTT_MAX_TRANSFER_SIZE
+        if (bytesToWrite > MQTT_MAX_TRANSFER_SIZE) {
+            bytesToWrite = MQTT_MAX_TRANSFER_SIZE;
+        }
+#endif
+        size_t rc = _client->write(data, bytesToWrite);
+        if (rc == 0 || rc > bytesToWrite) {
+            return false;
+        }
+        data += rc;
+        length -= rc;
+    }
+    return true;
+}
+
 boolean PubSubClient::subscribe(const char* topic) {
     return subscribe(topic, 0);
 }
@@ -83,6 +83,12 @@
 #define MQTT_CALLBACK_SIGNATURE void (*callback)(char*, uint8_t*, unsigned int)
 #endif
 
+// One caller-owned piece of a payload, for publishSegments()
+struct PubSubSegment {
+   const uint8_t* data;
+   size_t length;
+};
+
 #define CHECK_STRING_LENGTH(l,s) if (l+2+strnlen(s, this->bufferSize) > this->bufferSize) {_client->stop();return false;}
 
 class PubSubClient : public Print {
@@ -100,8 +106,10 @@ private:
    uint32_t readPacket(uint8_t*);
    boolean readByte(uint8_t * result);
    boolean readByte(uint8_t * result, uint16_t * index);
+   boolean readBytes(uint8_t * result, size_t length);
    boolean write(uint8_t header, uint8_t* buf, uint16_t length);
    uint16_t writeString(const char* string, uint8_t* buf, uint16_t pos);
+   boolean writeSegment(const uint8_t* data, size_t length);
    // Build up the header ready to send
    // Returns the size of the header
    // Note: the header is built at the end of the first MQTT_MAX_HEADER_SIZE bytes, so will start
@@ -154,6 +162,13 @@ public:
    boolean publish(const char* topic, const uint8_t * payload, unsigned int plength, boolean retained);
    boolean publish_P(const char* topic, const char* payload, boolean retained);
    boolean publish_P(const char* topic, const uint8_t * payload, unsigned int plength, boolean retained);
+   // Publish without copying into the internal buffer: the fixed header, the topic and
+   // each caller-owned payload segment are handed to the client in turn, straight from
+   // where they are (the network stack gathers them into TCP segments). Not limited by
+   // the buffer size; the payload may be up to the MQTT maximum of 268435455 bytes.
+   // Returns 1 if every byte was written, 0 otherwise
+   boolean publishDirect(const char* topic, const uint8_t * payload, unsigned int plength, boolean retained);
+   boolean publishSegments(const char* topic, const PubSubSegment* segments, size_t count, boolean retained);
    // Start to publish a message.
    // This API:
    //   beginPublish(...)
@@ -0,0 +1,97 @@
+// SampleBatcher.h
+// RSSI samples taken at a fixed rate (timer context) are queued in a lock-free
+// single-producer/single-consumer ring and published from loop() in batches of
+// binary v1 payloads (MotionPayload.h). A batch is streamed with
+// beginPublish()/write()/endPublish(), so it may exceed MQTT_MAX_PACKET_SIZE.
+// No Arduino headers: the MQTT client is a template parameter, so the batcher
+// also builds on the host against a mock.
+#pragma once
+#include "MotionPayload.h"
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+template <size_t Capacity>
+class SampleBatcher {
+  static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+  struct Sample {
+    uint32_t key;      // motionSsidHash() of the network
+    uint32_t timeMs;   // millis() when taken
+    int8_t   rssi;
+  };
+
+  // Producer (sampling timer). Returns false, and counts a drop, if the ring is full.
+  bool push(uint32_t key, int8_t rssi, uint32_t nowMs) {
+    const uint32_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) == Capacity) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    ring_[head & (Capacity - 1)] = Sample{ key, nowMs, rssi };
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer: samples waiting to be published
+  size_t pending() const {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_relaxed);
+  }
+
+  // Consumer: true once `batch` samples are queued or the oldest is maxAgeMs old
+  bool due(size_t batch, uint32_t nowMs, uint32_t maxAgeMs) const {
+    const size_t n = pending();
+    if (n == 0) {
+      return false;
+    }
+    return n >= batch || nowMs - ring_[tail_.load(std::memory_order_relaxed) & (Capacity - 1)].timeMs >= maxAgeMs;
+  }
+
+  // Consumer: publish up to maxEntries queued samples as one payload on `topic`.
+  // Samples leave the ring only if the publish succeeded. Returns the number sent.
+  template <typename Mqtt>
+  size_t publish(Mqtt& mqtt, const char* topic, uint32_t deviceId, uint32_t nowMs, size_t maxEntries) {
+    size_t count = pending();
+    if (count > maxEntries) count = maxEntries;
+    if (count > MOTION_PAYLOAD_MAX_ENTRIES) count = MOTION_PAYLOAD_MAX_ENTRIES;
+    if (count == 0) {
+      return 0;
+    }
+
+    if (!mqtt.beginPublish(topic, motionPayloadSize(count), false)) {
+      return 0;
+    }
+    uint8_t chunk[MOTION_PAYLOAD_HEADER + kChunkEntries * MOTION_PAYLOAD_ENTRY];
+    size_t used = encodeMotionHeader(chunk, deviceId, seq_, nowMs, count);
+    const uint32_t tail = tail_.load(std::memory_order_relaxed);
+    bool ok = true;
+    for (size_t i = 0; i < count && ok; ++i) {
+      const Sample& s = ring_[(tail + i) & (Capacity - 1)];
+      const uint32_t age = nowMs - s.timeMs;
+      used += motionPutEntry(chunk + used, MotionEntry{ s.key, static_cast<uint16_t>(age > 0xFFFF ? 0xFFFF : age), s.rssi });
+      if (used + MOTION_PAYLOAD_ENTRY > sizeof(chunk) || i + 1 == count) {
+        ok = mqtt.write(chunk, used) == used;
+        used = 0;
+      }
+    }
+    if (!mqtt.endPublish() || !ok) {
+      return 0;
+    }
+    ++seq_;
+    tail_.store(tail + static_cast<uint32_t>(count), std::memory_order_release);
+    return count;
+  }
+
+  uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+  uint32_t seq() const { return seq_; }
+
+private:
+  static const size_t kChunkEntries = 16;   // entries per write() call
+
+  Sample                ring_[Capacity];
+  std::atomic<uint32_t> head_{ 0 };   // written by the producer only
+  std::atomic<uint32_t> tail_{ 0 };   // written by the consumer only
+  std::atomic<uint32_t> dropped_{ 0 };
+  uint32_t              seq_ = 0;     // consumer only
+};
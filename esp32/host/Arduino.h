@@ -0,0 +1,26 @@
+// Arduino.h
+// Host (Linux) stand-in for the parts of the Arduino core that PubSubClient and
+// the sketch headers use, so the MQTT client builds and runs against MockClient.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Print.h"
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+// Milliseconds since an arbitrary start, like the Arduino millis()
+inline unsigned long millis() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<unsigned long>(ts.tv_sec * 1000UL + ts.tv_nsec / 1000000L);
+}
+
+inline void yield() {}
+
+// No separate program memory on the host
+#define PROGMEM
+#define pgm_read_byte_near(addr) (*reinterpret_cast<const uint8_t*>(addr))
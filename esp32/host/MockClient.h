@@ -0,0 +1,86 @@
+// MockClient.h
+// In-memory Client for running PubSubClient on the host: everything written is
+// appended to sent(), and reads are served from a caller-owned input buffer
+// (setInput), so a test or benchmark controls both directions of the "socket".
+#pragma once
+#include "Client.h"
+#include <string.h>
+#include <vector>
+
+class MockClient : public Client {
+public:
+  // Serve data[0..size) to the reader, from the start. The data is not copied.
+  void setInput(const uint8_t* data, size_t size) {
+    in_ = data;
+    inSize_ = size;
+    inPos_ = 0;
+  }
+
+  const std::vector<uint8_t>& sent() const { return sent_; }
+  void clearSent() { sent_.clear(); }
+
+  // Calls of write() and read() since construction, to count per-packet round trips
+  unsigned long writeCalls() const { return writeCalls_; }
+  unsigned long readCalls() const { return readCalls_; }
+
+  int connect(IPAddress, uint16_t) override { return connect(); }
+  int connect(const char*, uint16_t) override { return connect(); }
+
+  size_t write(uint8_t b) override {
+    ++writeCalls_;
+    if (!connected_) {
+      return 0;
+    }
+    sent_.push_back(b);
+    return 1;
+  }
+
+  size_t write(const uint8_t* buf, size_t size) override {
+    ++writeCalls_;
+    if (!connected_) {
+      return 0;
+    }
+    sent_.insert(sent_.end(), buf, buf + size);
+    return size;
+  }
+
+  int available() override { return static_cast<int>(inSize_ - inPos_); }
+
+  int read() override {
+    ++readCalls_;
+    return inPos_ < inSize_ ? in_[inPos_++] : -1;
+  }
+
+  int read(uint8_t* buf, size_t size) override {
+    ++readCalls_;
+    if (inPos_ == inSize_) {
+      return -1;
+    }
+    if (size > inSize_ - inPos_) {
+      size = inSize_ - inPos_;
+    }
+    memcpy(buf, in_ + inPos_, size);
+    inPos_ += size;
+    return static_cast<int>(size);
+  }
+
+  int peek() override { return inPos_ < inSize_ ? in_[inPos_] : -1; }
+  void flush() override {}
+  void stop() override { connected_ = false; }
+  uint8_t connected() override { return connected_; }
+  operator bool() override { return connected_; }
+
+private:
+  int connect() {
+    connected_ = true;
+    return 1;
+  }
+
+  std::vector<uint8_t> sent_;
+  const uint8_t*       in_ = nullptr;
+  size_t               inSize_ = 0;
+  size_t               inPos_ = 0;
+  unsigned long        writeCalls_ = 0;
+  unsigned long        readCalls_ = 0;
+  bool                 connected_ = false;
+};
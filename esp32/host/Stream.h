@@ -0,0 +1,12 @@
+// Stream.h
+// Host stand-in for the Arduino Stream base class
+#pragma once
+#include "Print.h"
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual void flush() {}
+};
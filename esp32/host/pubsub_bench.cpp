@@ -0,0 +1,309 @@
+// pubsub_bench.cpp
+// pubsub_bench: per-packet cost of the ESP32 MQTT client (PubSubClient) on the
+// host, against MockClient. Encode: the copying publish(), publishDirect() and the
+// SampleBatcher's streamed publish; decode: loop() on incoming PUBLISH packets.
+// Before timing, the output of every path is checked against the copying
+// publish() byte for byte. Results go to stderr as a table and to stdout (or
+// --out=FILE) as JSON, like motion_bench.
+#include "Bench.h"
+#include "MockClient.h"
+#include "MotionPayload.h"
+#include "PubSubClient.h"
+#include "SampleBatcher.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+// ---- allocation counting ----
+std::atomic<std::uint64_t> benchAllocs{ 0 };
+
+void* operator new(std::size_t n) {
+  benchAllocs.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(n ? n : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+void* operator new[](std::size_t n) { return operator new(n); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+  const char* const kTopic = "motion/esp32/esp32_1";
+  const uint32_t    kDeviceId = 1;
+
+  // Large enough for a full 255-entry binary payload
+  const uint16_t kBufferSize = 4096;
+
+  // What loop() handed to the callback (a plain function pointer off the ESP32)
+  std::string   receivedTopic;
+  std::string   receivedPayload;
+  std::uint64_t receivedBytes = 0;
+
+  void onMessage(char* topic, uint8_t* payload, unsigned int length) {
+    receivedBytes += length;
+    if (receivedTopic.empty()) {
+      receivedTopic = topic;
+      receivedPayload.assign(reinterpret_cast<const char*>(payload), length);
+    }
+  }
+
+  // Stream that keeps what PubSubClient forwards from oversized packets
+  struct SinkStream : Stream {
+    std::string data;
+    size_t write(uint8_t b) override {
+      data += char(b);
+      return 1;
+    }
+    size_t write(const uint8_t* buf, size_t size) override {
+      data.append(reinterpret_cast<const char*>(buf), size);
+      return size;
+    }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+  };
+
+  // Connect `mqtt` through `client` (answering CONNECT with a CONNACK) and forget
+  // what was sent so far
+  bool connect(PubSubClient& mqtt, MockClient& client) {
+    static const uint8_t connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    client.setInput(connack, sizeof(connack));
+    mqtt.setBufferSize(kBufferSize);
+    const bool ok = mqtt.connect("pubsub_bench");
+    client.clearSent();
+    return ok;
+  }
+
+  // A binary v1 payload of `count` entries, as the sketch sends it
+  std::vector<uint8_t> makePayload(size_t count) {
+    std::vector<MotionEntry> entries(count);
+    for (size_t i = 0; i < count; ++i) {
+      entries[i] = MotionEntry{ 0x9E3779B1u * uint32_t(i + 1), uint16_t(i * 40), int8_t(-30 - int(i % 60)) };
+    }
+    std::vector<uint8_t> out(motionPayloadSize(count));
+    encodeMotionPayload(out.data(), out.size(), kDeviceId, 7, 123456, entries.data(), count);
+    return out;
+  }
+
+  // The packets publish() sends for `payload` on kTopic
+  std::vector<uint8_t> copiedPacket(const std::vector<uint8_t>& payload) {
+    MockClient client;
+    PubSubClient mqtt(client);
+    connect(mqtt, client);
+    mqtt.publish(kTopic, payload.data(), payload.size(), false);
+    return client.sent();
+  }
+
+  bool check(bool ok, const char* what) {
+    if (!ok) {
+      std::cerr << "pubsub_bench: self-check failed: " << what << "\n";
+    }
+    return ok;
+  }
+
+  bool selfCheck() {
+    bool ok = true;
+    for (size_t count : { size_t(10), size_t(255) }) {
+      const std::vector<uint8_t> payload = makePayload(count);
+      const std::vector<uint8_t> expected = copiedPacket(payload);
+      ok &= check(!expected.empty(), "publish() sent nothing");
+
+      MockClient client;
+      PubSubClient mqtt(client);
+      connect(mqtt, client);
+      ok &= check(mqtt.publishDirect(kTopic, payload.data(), payload.size(), false) && client.sent() == expected,
+                  "publishDirect() differs from publish()");
+
+      client.clearSent();
+      const PubSubSegment segments[] = {
+        { payload.data(), MOTION_PAYLOAD_HEADER },
+        { payload.data() + MOTION_PAYLOAD_HEADER, payload.size() - MOTION_PAYLOAD_HEADER },
+      };
+      ok &= check(mqtt.publishSegments(kTopic, segments, 2, false) && client.sent() == expected,
+                  "publishSegments() differs from publish()");
+
+      // loop() hands the same topic and payload back, through bulk reads
+      receivedTopic.clear();
+      mqtt.setCallback(onMessage);
+      client.setInput(expected.data(), expected.size());
+      const unsigned long reads = client.readCalls();
+      ok &= check(mqtt.loop() && receivedTopic == kTopic
+                  && receivedPayload == std::string(payload.begin(), payload.end()),
+                  "loop() decoded a different message");
+      ok &= check(client.readCalls() - reads < 8, "loop() read the packet byte by byte");
+    }
+
+    {
+      // SampleBatcher: the same bytes as publish() of the encoded batch
+      MockClient client;
+      PubSubClient mqtt(client);
+      connect(mqtt, client);
+      static SampleBatcher<256> batcher;
+      std::vector<MotionEntry> entries;
+      for (uint32_t i = 0; i < 10; ++i) {
+        batcher.push(0x1000 + i, int8_t(-40 - int(i)), 1000 + 40 * i);
+        entries.push_back(MotionEntry{ 0x1000 + i, uint16_t(2000 - (1000 + 40 * i)), int8_t(-40 - int(i)) });
+      }
+      std::vector<uint8_t> payload(motionPayloadSize(10));
+      encodeMotionPayload(payload.data(), payload.size(), kDeviceId, 0, 2000, entries.data(), 10);
+      ok &= check(batcher.publish(mqtt, kTopic, kDeviceId, 2000, 255) == 10 && client.sent() == copiedPacket(payload),
+                  "SampleBatcher::publish() differs from publish()");
+    }
+
+    {
+      // A packet larger than the buffer still reaches a Stream in full
+      const std::vector<uint8_t> payload = makePayload(255);
+      MockClient client;
+      PubSubClient mqtt(client);
+      connect(mqtt, client);
+      mqtt.publishDirect(kTopic, payload.data(), payload.size(), false);
+      const std::vector<uint8_t> packet = client.sent();
+
+      SinkStream sink;
+      PubSubClient small(client);
+      small.setStream(sink);
+      connect(small, client);
+      small.setBufferSize(256);
+      client.setInput(packet.data(), packet.size());
+      ok &= check(small.loop() && client.available() == 0
+                  && sink.data == std::string(payload.begin(), payload.end()),
+                  "oversized packet not streamed");
+    }
+    return ok;
+  }
+
+  // ---- encode ----
+
+  void benchPublish(BenchRunner& bench, size_t count) {
+    const std::vector<uint8_t> payload = makePayload(count);
+    const std::string size = std::to_string(payload.size()) + "B";
+    MockClient client;
+    PubSubClient mqtt(client);
+    connect(mqtt, client);
+    size_t failed = 0;
+
+    bench.run("pubsub.publish_copy_" + size, [&](std::uint64_t n) {
+      for (std::uint64_t i = 0; i < n; ++i) {
+        failed += !mqtt.publish(kTopic, payload.data(), payload.size(), false);
+        client.clearSent();
+      }
+      return n;
+    });
+    bench.run("pubsub.publish_direct_" + size, [&](std::uint64_t n) {
+      for (std::uint64_t i = 0; i < n; ++i) {
+        failed += !mqtt.publishDirect(kTopic, payload.data(), payload.size(), false);
+        client.clearSent();
+      }
+      return n;
+    });
+    if (failed) {
+      std::cerr << "pubsub.publish_*_" << size << ": " << failed << " publishes failed\n";
+    }
+  }
+
+  void benchBatcher(BenchRunner& bench) {
+    // one op: 10 timer samples queued, then published as one payload (the sketch's BATCH)
+    MockClient client;
+    PubSubClient mqtt(client);
+    connect(mqtt, client);
+    static SampleBatcher<256> batcher;
+    uint32_t now = 0;
+    size_t short_ = 0;
+    bench.run("pubsub.batcher_publish_10", [&](std::uint64_t n) {
+      for (std::uint64_t i = 0; i < n; ++i) {
+        for (uint32_t s = 0; s < 10; ++s) {
+          batcher.push(0x1000 + s, int8_t(-40 - int(s)), now);
+          now += 40;
+        }
+        short_ += batcher.publish(mqtt, kTopic, kDeviceId, now, 10) != 10;
+        client.clearSent();
+      }
+      return n;
+    });
+    if (short_) {
+      std::cerr << "pubsub.batcher_publish_10: " << short_ << " short batches\n";
+    }
+  }
+
+  // ---- decode ----
+
+  void benchLoop(BenchRunner& bench, size_t count) {
+    const std::vector<uint8_t> payload = makePayload(count);
+    const std::string size = std::to_string(payload.size()) + "B";
+    const std::vector<uint8_t> packet = copiedPacket(payload);
+
+    // 64 back-to-back PUBLISH packets, as if they had queued up in the socket
+    const size_t kPackets = 64;
+    std::vector<uint8_t> input;
+    for (size_t i = 0; i < kPackets; ++i) {
+      input.insert(input.end(), packet.begin(), packet.end());
+    }
+
+    MockClient client;
+    PubSubClient mqtt(client);
+    connect(mqtt, client);
+    mqtt.setCallback(onMessage);
+    receivedBytes = 0;
+    bench.run("pubsub.loop_publish_" + size, [&](std::uint64_t n) {
+      for (std::uint64_t i = 0; i < n; ++i) {
+        if (client.available() == 0) {
+          client.setInput(input.data(), input.size());
+        }
+        mqtt.loop();
+      }
+      return n;
+    });
+    if (receivedBytes == 0) {
+      std::cerr << "pubsub.loop_publish_" << size << ": nothing received\n";
+    }
+  }
+
+  void usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [--filter=SUBSTR] [--min-time-ms=N] [--out=FILE]\n";
+  }
+}
+
+int main(int argc, char** argv) {
+  std::string filter;
+  std::string outPath;
+  long minTimeMs = 500;
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    if (std::strncmp(arg, "--filter=", 9) == 0) {
+      filter = arg + 9;
+    } else if (std::strncmp(arg, "--min-time-ms=", 14) == 0) {
+      minTimeMs = std::strtol(arg + 14, nullptr, 10);
+    } else if (std::strncmp(arg, "--out=", 6) == 0) {
+      outPath = arg + 6;
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (!selfCheck()) {
+    return 1;
+  }
+
+  BenchRunner bench(std::chrono::milliseconds(minTimeMs), filter);
+  benchPublish(bench, 10);
+  benchPublish(bench, 255);
+  benchBatcher(bench);
+  benchLoop(bench, 10);
+  benchLoop(bench, 255);
+
+  if (outPath.empty()) {
+    bench.writeJson(std::cout);
+  } else {
+    std::ofstream out(outPath);
+    bench.writeJson(out);
+  }
+  return 0;
+}
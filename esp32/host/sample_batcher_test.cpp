@@ -0,0 +1,223 @@
+// sample_batcher_test.cpp
+// Host tests of SampleBatcher (esp32/MotionPublisher) against PubSubClient over
+// MockClient: ring-full drops, the due() triggers, samples staying queued when a
+// publish fails, and multi-chunk payloads decoding on the Pi side
+// (decodeBinaryPayload in pi/src/Payload.cpp). Exits non-zero on any failure.
+#include "MockClient.h"
+#include "MotionPayload.h"
+#include "Payload.h"
+#include "PubSubClient.h"
+#include "SampleBatcher.h"
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+  const char* const kTopic = "motion/esp32/test";
+  const uint32_t    kDeviceId = 42;
+
+  int failures = 0;
+
+  void check(bool ok, const char* what) {
+    if (!ok) {
+      std::cerr << "FAIL: " << what << "\n";
+      ++failures;
+    }
+  }
+
+  // Connect `mqtt` through `client` (answering CONNECT with a CONNACK) and forget
+  // what was sent so far
+  bool connect(PubSubClient& mqtt, MockClient& client) {
+    static const uint8_t connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    client.setInput(connack, sizeof(connack));
+    mqtt.setBufferSize(4096);
+    const bool ok = mqtt.connect("sample_batcher_test");
+    client.clearSent();
+    return ok;
+  }
+
+  // MockClient whose write(buf, size) fails from the `failAt`-th call on (0: never)
+  class FailingClient : public MockClient {
+  public:
+    unsigned long failAt = 0;
+
+    size_t write(const uint8_t* buf, size_t size) override {
+      ++bulkWrites_;
+      if (failAt && bulkWrites_ >= failAt) {
+        return 0;
+      }
+      return MockClient::write(buf, size);
+    }
+    size_t write(uint8_t b) override { return MockClient::write(b); }
+
+    void resetWrites() { bulkWrites_ = 0; }
+
+  private:
+    unsigned long bulkWrites_ = 0;
+  };
+
+  // PubSubClient whose endPublish() reports failure
+  struct FailingEnd {
+    PubSubClient& mqtt;
+    bool beginPublish(const char* topic, unsigned int length, bool retained) {
+      return mqtt.beginPublish(topic, length, retained);
+    }
+    size_t write(const uint8_t* buf, size_t size) { return mqtt.write(buf, size); }
+    int endPublish() { return 0; }
+  };
+
+  // Topic and payload of the single PUBLISH packet in `packet`
+  bool splitPublish(const std::vector<uint8_t>& packet, std::string& topic, std::string& payload) {
+    if (packet.size() < 2 || (packet[0] & 0xF0) != 0x30) {
+      return false;
+    }
+    size_t pos = 1;
+    size_t length = 0;
+    for (int shift = 0; pos < packet.size(); shift += 7) {
+      const uint8_t digit = packet[pos++];
+      length |= size_t(digit & 0x7F) << shift;
+      if (!(digit & 0x80)) {
+        break;
+      }
+    }
+    if (pos + length != packet.size() || length < 2) {
+      return false;
+    }
+    const size_t topicLength = size_t(packet[pos]) << 8 | packet[pos + 1];
+    pos += 2;
+    if (pos + topicLength > packet.size()) {
+      return false;
+    }
+    topic.assign(reinterpret_cast<const char*>(&packet[pos]), topicLength);
+    pos += topicLength;
+    payload.assign(reinterpret_cast<const char*>(&packet[pos]), packet.size() - pos);
+    return true;
+  }
+
+  void testRingFull() {
+    static SampleBatcher<4> batcher;
+    for (uint32_t i = 0; i < 4; ++i) {
+      check(batcher.push(i, -50, 100 + i), "push into a ring with room");
+    }
+    check(!batcher.push(4, -50, 104), "push into a full ring succeeds");
+    check(!batcher.push(5, -50, 105), "second push into a full ring succeeds");
+    check(batcher.dropped() == 2, "drops not counted");
+    check(batcher.pending() == 4, "a drop changed the queued samples");
+
+    // room again once a publish took samples out
+    MockClient client;
+    PubSubClient mqtt(client);
+    check(connect(mqtt, client), "connect");
+    check(batcher.publish(mqtt, kTopic, kDeviceId, 200, 2) == 2, "publish of 2 samples");
+    check(batcher.pending() == 2 && batcher.push(6, -50, 200), "no room after publish");
+  }
+
+  void testDue() {
+    static SampleBatcher<64> batcher;
+    check(!batcher.due(4, 1000, 500), "an empty ring is due");
+    batcher.push(1, -60, 1000);
+    check(!batcher.due(4, 1499, 500), "due before the oldest sample is maxAgeMs old");
+    check(batcher.due(4, 1500, 500), "not due once the oldest sample is maxAgeMs old");
+    for (uint32_t i = 0; i < 3; ++i) {
+      batcher.push(2 + i, -60, 1010);
+    }
+    check(batcher.due(4, 1010, 500), "not due with a full batch queued");
+    check(!batcher.due(5, 1010, 500), "due below the batch size and age");
+
+    // millis() wraps after 49.7 days; the age must survive that
+    static SampleBatcher<8> wrap;
+    wrap.push(1, -60, 0xFFFFFF00u);
+    check(!wrap.due(4, 0x00000010u, 500), "due across the millis() wrap too early");
+    check(wrap.due(4, 0x00000200u, 500), "not due across the millis() wrap");
+  }
+
+  void testFailedPublishKeepsSamples() {
+    static SampleBatcher<64> batcher;
+    for (uint32_t i = 0; i < 40; ++i) {
+      batcher.push(0x100 + i, int8_t(-40 - int(i)), 1000 + i);
+    }
+
+    // a write() fails part way through the entries
+    FailingClient client;
+    PubSubClient mqtt(client);
+    check(connect(mqtt, client), "connect");
+    client.resetWrites();
+    client.failAt = 3;   // header, first chunk, then fail
+    check(batcher.publish(mqtt, kTopic, kDeviceId, 2000, 255) == 0, "publish with a failed write reported success");
+    check(batcher.pending() == 40 && batcher.seq() == 0, "a failed write consumed samples");
+
+    // endPublish() fails
+    client.failAt = 0;
+    FailingEnd failingEnd{ mqtt };
+    check(batcher.publish(failingEnd, kTopic, kDeviceId, 2000, 255) == 0, "publish with a failed endPublish reported success");
+    check(batcher.pending() == 40 && batcher.seq() == 0, "a failed endPublish consumed samples");
+
+    // not connected: beginPublish() fails
+    MockClient down;
+    PubSubClient offline(down);
+    check(batcher.publish(offline, kTopic, kDeviceId, 2000, 255) == 0, "publish while disconnected reported success");
+    check(batcher.pending() == 40, "a failed beginPublish consumed samples");
+
+    // the retry sends all of them
+    client.clearSent();
+    check(batcher.publish(mqtt, kTopic, kDeviceId, 2000, 255) == 40, "retry did not send everything");
+    check(batcher.pending() == 0 && batcher.seq() == 1, "retry left samples queued");
+  }
+
+  void testRoundTrip() {
+    // 40 entries: header plus three write() chunks of up to 16 entries
+    static SampleBatcher<256> batcher;
+    const size_t kCount = 40;
+    const uint32_t nowMs = 50000;
+    for (uint32_t i = 0; i < kCount; ++i) {
+      batcher.push(0x9E3779B1u * (i + 1), int8_t(-30 - int(i)), nowMs - 2000 + 50 * i);
+    }
+    MockClient client;
+    PubSubClient mqtt(client);
+    check(connect(mqtt, client), "connect");
+    const unsigned long writes = client.writeCalls();
+    check(batcher.publish(mqtt, kTopic, kDeviceId, nowMs, 255) == kCount, "publish of 40 samples");
+    check(client.writeCalls() - writes >= 4, "payload was not streamed in chunks");
+
+    std::string topic, payload;
+    check(splitPublish(client.sent(), topic, payload), "sent bytes are not one PUBLISH packet");
+    check(topic == kTopic, "wrong topic");
+    check(payload.size() == motionPayloadSize(kCount), "wrong payload size");
+
+    const std::int64_t receivedUs = 1700000000000000;
+    Sample out[kMaxPayloadSamples];
+    BinaryPayloadHeader header;
+    const size_t n = decodeBinaryPayload(topic, payload, receivedUs, out, kMaxPayloadSamples, &header);
+    check(n == kCount, "decodeBinaryPayload rejected the payload");
+    check(header.deviceId == kDeviceId && header.seq == 0 && header.uptimeMs == nowMs && header.count == kCount,
+          "header fields differ");
+    for (size_t i = 0; i < n; ++i) {
+      char name[16];
+      std::snprintf(name, sizeof(name), "#%08x", 0x9E3779B1u * uint32_t(i + 1));
+      const std::int64_t ageMs = 2000 - 50 * std::int64_t(i);
+      const bool ok = out[i].rssi == float(-30 - int(i))
+        && out[i].tsUs == receivedUs - ageMs * 1000
+        && symbols.source(out[i].link) == kTopic
+        && symbols.ssid(out[i].link) == name;
+      if (!ok) {
+        std::cerr << "entry " << i << ": ";
+        check(false, "entry differs after the round trip");
+        break;
+      }
+    }
+  }
+}
+
+int main() {
+  testRingFull();
+  testDue();
+  testFailedPublishKeepsSamples();
+  testRoundTrip();
+  if (failures) {
+    std::cerr << failures << " check(s) failed\n";
+    return 1;
+  }
+  std::cout << "sample_batcher_test: all checks passed\n";
+  return 0;
+}
@@ -0,0 +1,110 @@
+// Bench.h
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// Heap allocations since start-up, counted by the operator new replacement in bench.cpp
+extern std::atomic<std::uint64_t> benchAllocs;
+
+/// Minimal benchmark runner. Each benchmark is a callable `fn(iterations)` that
+/// performs `iterations` operations and returns how many it performed. The runner
+/// grows the iteration count until one batch takes at least a tenth of `minTime`,
+/// then repeats batches until `minTime` has elapsed, and reports ops/s, ns/op and
+/// heap allocations/op.
+class BenchRunner
+{
+public:
+    struct Result
+    {
+        std::string   name;
+        std::uint64_t ops;
+        double        seconds;
+        std::uint64_t allocs;
+    };
+
+    BenchRunner(std::chrono::milliseconds minTime, std::string filter)
+        : minTime_(minTime), filter_(std::move(filter))
+    {
+    }
+
+    /// True if `name` passes the --filter substring
+    bool enabled(const std::string& name) const
+    {
+        return filter_.empty() || name.find(filter_) != std::string::npos;
+    }
+
+    template <typename Fn>
+    void run(const std::string& name, Fn&& fn)
+    {
+        if (!enabled(name))
+        {
+            return;
+        }
+        using Clock = std::chrono::steady_clock;
+        const auto minTime = std::chrono::duration<double>(minTime_).count();
+
+        // find a batch size that runs long enough to time reliably
+        std::uint64_t batch = 1;
+        for (;;)
+        {
+            auto t0 = Clock::now();
+            fn(batch);
+            double dt = std::chrono::duration<double>(Clock::now() - t0).count();
+            if (dt >= minTime / 10 || batch >= (std::uint64_t(1) << 40))
+            {
+                break;
+            }
+            batch = dt <= 0.0 ? batch * 10 : std::max(batch * 2, std::uint64_t(batch * (minTime / 10) / dt * 1.2));
+        }
+
+        Result r{ name, 0, 0.0, 0 };
+        const std::uint64_t allocs0 = benchAllocs.load(std::memory_order_relaxed);
+        while (r.seconds < minTime)
+        {
+            auto t0 = Clock::now();
+            r.ops += fn(batch);
+            r.seconds += std::chrono::duration<double>(Clock::now() - t0).count();
+        }
+        r.allocs = benchAllocs.load(std::memory_order_relaxed) - allocs0;
+        std::fprintf(stderr, "%-40s %14.0f ops/s %12.1f ns/op %10.3f allocs/op\n",
+            name.c_str(), r.ops / r.seconds, r.seconds * 1e9 / r.ops, double(r.allocs) / r.ops);
+        results_.push_back(std::move(r));
+    }
+
+    /// All results as one JSON document
+    void writeJson(std::ostream& out) const
+    {
+        out << "{\n  \"min_time_ms\": " << minTime_.count()
+            << ",\n  \"compiler\": \"" << __VERSION__ << "\""
+#ifdef NDEBUG
+            << ",\n  \"assertions\": false"
+#else
+            << ",\n  \"assertions\": true"
+#endif
+            << ",\n  \"results\": [";
+        const char* sep = "\n";
+        for (const Result& r : results_)
+        {
+            char line[512];
+            std::snprintf(line, sizeof(line),
+                "    {\"name\": \"%s\", \"ops\": %llu, \"seconds\": %.6f, "
+                "\"ops_per_s\": %.1f, \"ns_per_op\": %.2f, \"allocs_per_op\": %.4f}",
+                r.name.c_str(), static_cast<unsigned long long>(r.ops), r.seconds,
+                r.ops / r.seconds, r.seconds * 1e9 / r.ops, double(r.allocs) / r.ops);
+            out << sep << line;
+            sep = ",\n";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+private:
+    std::chrono::milliseconds minTime_;
+    std::string               filter_;
+    std::vector<Result>       results_;
+};
@@ -0,0 +1,733 @@
+// bench.cpp
+// motion_bench: reproducible microbenchmarks of the motion_detector hot paths.
+// Results go to stderr as a table and to stdout (or --out=FILE) as JSON.
+#include "Bench.h"
+#include "EpisodeTracker.h"
+#include "FusionEngine.h"
+#include "Instrument.h"
+#include "IwParser.h"
+#include "LinkFeatures.h"
+#include "Logger.h"
+#include "MotionDetector.h"
+#include "Payload.h"
+#include "SQLiteDB.h"
+#include "Scanner.h"
+#include "ShardedDetector.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#ifndef MOTION_BENCH_DATA_DIR
+#define MOTION_BENCH_DATA_DIR "bench/data"
+#endif
+
+// Logger.h expects the process-wide database (main.cpp defines it for motion_detector)
+SQLiteDB db;
+
+// ---- allocation counting ----
+std::atomic<std::uint64_t> benchAllocs{ 0 };
+
+void* operator new(std::size_t n)
+{
+    benchAllocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t n) { return operator new(n); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+namespace
+{
+    /// Stream buffer that discards everything (mutes FileLogger's console output)
+    struct NullBuffer : std::streambuf
+    {
+        int overflow(int c) override { return c; }
+        std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+    };
+
+    std::string readFile(const std::string& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        std::ostringstream ss;
+        ss << in.rdbuf();
+        return ss.str();
+    }
+
+    /// Deterministic samples over `links` links, one per 500 ms per link
+    std::vector<Sample> makeSamples(std::size_t links, std::size_t count, unsigned seed)
+    {
+        std::vector<LinkId> ids(links);
+        for (std::size_t i = 0; i < links; ++i)
+        {
+            ids[i] = symbols.link("motion/esp32/bench", "SSID-" + std::to_string(i));
+        }
+        std::mt19937 rng(seed);
+        std::normal_distribution<float> noise(0.0f, 2.0f);
+        std::vector<Sample> out(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const std::size_t l = i % links;
+            out[i] = Sample{ 1700000000000000 + std::int64_t(i / links) * 500000 + std::int64_t(l),
+                ids[l], -40.0f - float(l % 50) + noise(rng) };
+        }
+        return out;
+    }
+
+    void benchScanner(BenchRunner& bench, const std::string& dataDir)
+    {
+        for (const char* dump : { "iw_home.txt", "iw_dense.txt" })
+        {
+            const std::string path = dataDir + "/" + dump;
+            const std::string text = readFile(path);
+            if (text.empty())
+            {
+                std::cerr << "Missing benchmark input " << path << "\n";
+                continue;
+            }
+
+            // whole Scanner::scan() on the recorded dump (file read + parse)
+            Scanner scanner = Scanner::fromDump(path);
+            std::vector<Sample> out;
+            bench.run(std::string("scanner.scan/") + dump, [&](std::uint64_t n)
+            {
+                for (std::uint64_t i = 0; i < n; ++i)
+                {
+                    scanner.scan(out);
+                }
+                return n;
+            });
+
+            // parser alone, fed from memory in 4 KiB chunks like Scanner does
+            IwScanParser parser;
+            const SymbolId pi = symbols.intern("pi");
+            bench.run(std::string("iw_parser.feed/") + dump, [&](std::uint64_t n)
+            {
+                for (std::uint64_t i = 0; i < n; ++i)
+                {
+                    parser.begin(0, pi);
+                    for (std::size_t off = 0; off < text.size(); off += 4096)
+                    {
+                        parser.feed(text.data() + off, std::min<std::size_t>(4096, text.size() - off), out);
+                    }
+                    parser.finish(out);
+                }
+                return n;
+            });
+        }
+    }
+
+    void benchPayload(BenchRunner& bench)
+    {
+        // 8 ESPs x 32 SSIDs, as on_message sees them
+        std::vector<std::string> topics, payloads;
+        std::mt19937 rng(3);
+        for (int e = 0; e < 8; ++e)
+        {
+            topics.push_back("motion/esp32/" + std::to_string(e));
+        }
+        for (int s = 0; s < 32; ++s)
+        {
+            payloads.push_back("Network " + std::to_string(s) + "," + std::to_string(-30 - int(rng() % 60)));
+        }
+        std::size_t bad = 0;
+        bench.run("payload.decode_text", [&](std::uint64_t n)
+        {
+            Sample m{ 0, 0, 0.0f };
+            for (std::uint64_t i = 0; i < n; ++i)
+            {
+                const std::string& topic = topics[i % topics.size()];
+                const std::string& payload = payloads[(i / topics.size()) % payloads.size()];
+                bad += !decodeTextPayload(topic, payload, m);
+            }
+            return n;
+        });
+        if (bad)
+        {
+            std::cerr << "payload.decode_text: " << bad << " payloads rejected\n";
+        }
+
+        // the same readings as binary v1 payloads of 10 entries (as batching firmware sends)
+        std::vector<std::string> binary;
+        for (int b = 0; b < 32; ++b)
+        {
+            std::string p = { 'M', 'D', '\x01', 10 };
+            p.append(12, '\0');
+            for (int e = 0; e < 10; ++e)
+            {
+                const std::uint32_t key = 0x9E3779B1u * std::uint32_t(b * 10 + e);
+                const char entry[8] = { char(key), char(key >> 8), char(key >> 16), char(key >> 24),
+                    char(e * 40), 0, char(-30 - int(rng() % 60)), 0 };
+                p.append(entry, sizeof(entry));
+            }
+            binary.push_back(p);
+        }
+        std::size_t badBinary = 0;
+        bench.run("payload.decode_binary_sample", [&](std::uint64_t n)
+        {
+            Sample out[kMaxPayloadSamples];
+            std::uint64_t samples = 0;
+            for (std::uint64_t i = 0; samples < n; ++i)
+            {
+                const std::size_t got = decodePayload(topics[i % topics.size()],
+                    binary[(i / topics.size()) % binary.size()], 0, out, kMaxPayloadSamples);
+                badBinary += got == 0;
+                samples += got ? got : 1;
+            }
+            return samples;
+        });
+        if (badBinary)
+        {
+            std::cerr << "payload.decode_binary_sample: " << badBinary << " payloads rejected\n";
+        }
+    }
+
+#if MOTION_INSTRUMENT
+    void benchInstrument(BenchRunner& bench)
+    {
+        // cost of one timed scope around (almost) nothing: the per-sample overhead
+        // MOTION_INSTRUMENT adds to each instrumented stage
+        volatile std::uint64_t sink = 0;
+        bench.run("instrument.stage_timer", [&](std::uint64_t n)
+        {
+            for (std::uint64_t i = 0; i < n; ++i)
+            {
+                MOTION_TIME_STAGE(Stage::Detect);
+                sink = sink + i;
+            }
+            return n;
+        });
+    }
+#endif
+
+    void benchDetector(BenchRunner& bench)
+    {
+        for (std::size_t links : { 10, 100, 1000, 10000 })
+        {
+            const std::string suffix = "/" + std::to_string(links);
+            bool any = false;
+            for (const char* op : { "addSample", "computeAverages", "isMovement", "observe" })
+            {
+                any = any || bench.enabled("detector." + std::string(op) + suffix);
+            }
+            if (!any)
+            {
+                continue;
+            }
+            const std::vector<Sample> samples = makeSamples(links, links * 64, unsigned(links));
+
+            MotionDetector detector(30, 10.0, links);
+            std::size_t next = 0;
+            bench.run("detector.addSample" + suffix, [&](std::uint64_t n)
+            {
+                for (std::uint64_t i = 0; i < n; ++i)
+                {
+                    detector.addSample(samples[next]);
+                    next = next + 1 == samples.size() ? 0 : next + 1;
+                }
+                return n;
+            });
+
+            // one op = one pass over all links
+            bench.run("detector.computeAverages" + suffix, [&](std::uint64_t n)
+            {
+                for (std::uint64_t i = 0; i < n; ++i)
+                {
+                    detector.computeAverages();
+                }
+                return n;
+            });
+
+            std::size_t movements = 0;
+            bench.run("detector.isMovement" + suffix, [&](std::uint64_t n)
+            {
+                for (std::uint64_t i = 0; i < n; ++i)
+                {
+                    movements += detector.isMovement(samples[next]);
+                    next = next + 1 == samples.size() ? 0 : next + 1;
+                }
+                return n;
+            });
+
+            bench.run("detector.observe" + suffix, [&](std::uint64_t n)
+            {
+                for (std::uint64_t i = 0; i < n; ++i)
+                {
+                    movements += detector.observe(samples[next]);
+                    next = next + 1 == samples.size() ? 0 : next + 1;
+                }
+                return n;
+            });
+            if (movements == std::size_t(-1))
+            {
+                std::cerr << movements;   // keep the result alive
+            }
+        }
+    }
+
+    void benchEpisodes(BenchRunner& bench)
+    {
+        if (!bench.enabled("episode.observe"))
+        {
+            return;
+        }
+
+        // 1000 links, deviations ~N(0, 5 dB): about 5% of the samples are movement
+        const std::size_t links = 1000;
+        std::vector<Sample> samples = makeSamples(links, links * 64, 5);
+        std::vector<float> deviations(samples.size());
+        std::mt19937 rng(5);
+        std::normal_distribution<float> dev(0.0f, 5.0f);
+        for (float& d : deviations)
+        {
+            d = dev(rng);
+        }
+        EpisodeTracker tracker;
+        std::size_t next = 0, events = 0;
+        std::int64_t offsetUs = 0;   // keeps time moving forward across passes
+        auto fn = [&](const Episode&, EpisodeTracker::Event) { ++events; };
+        // one op = one sample (plus an expire sweep every 1024)
+        bench.run("episode.observe", [&](std::uint64_t n)
+        {
+            for (std::uint64_t i = 0; i < n; ++i)
+            {
+                Sample m = samples[next];
+                m.tsUs += offsetUs;
+                tracker.observe(m, std::fabs(deviations[next]) > 10.0f, deviations[next], fn);
+                if ((i & 1023) == 0)
+                {
+                    tracker.expire(m.tsUs, fn);
+                }
+                if (++next == samples.size())
+                {
+                    next = 0;
+                    offsetUs += 64 * 500000;
+                }
+            }
+            return n;
+        });
+        if (events == std::size_t(-1))
+        {
+            std::cerr << events;   // keep the result alive
+        }
+    }
+
+    void benchFusion(BenchRunner& bench)
+    {
+        if (!bench.enabled("fusion.tick/"))
+        {
+            return;
+        }
+        VirtualTime time;
+
+        for (std::size_t links : { 100, 1000 })
+        {
+            const std::string name = "fusion.tick/" + std::to_string(links);
+            if (!bench.enabled(name))
+            {
+                continue;
+            }
+            const std::vector<Sample> samples = makeSamples(links, links * 16, unsigned(links));
+            std::vector<float> deviations(samples.size());
+            std::mt19937 rng(7);
+            std::normal_distribution<float> dev(0.0f, 5.0f);
+            for (float& d : deviations)
+            {
+                d = dev(rng);
+            }
+            FusionOptions options;
+            options.maxLinks = links;
+            options.queueCapacity = links * 2;
+            FusionEngine fusion(time, options);
+            std::size_t next = 0;
+            std::int64_t offsetUs = 0;
+            std::uint64_t votes = 0;
+            // one op = one tick: a fresh sample of every link (500 ms apart, like
+            // the ESPs) pushed and drained, then resampling, vote and coherence
+            bench.run(name, [&](std::uint64_t n)
+            {
+                for (std::uint64_t i = 0; i < n; ++i)
+                {
+                    for (std::size_t l = 0; l < links; ++l, ++next)
+                    {
+                        Sample m = samples[next];
+                        m.tsUs += offsetUs;
+                        fusion.push(0, m, deviations[next]);
+                    }
+                    if (next == samples.size())
+                    {
+                        next = 0;
+                        offsetUs += 16 * 500000;
+                    }
+                    votes += fusion.tick(samples[next ? next - 1 : samples.size() - 1].tsUs + offsetUs).votes;
+                }
+                return n;
+            });
+            if (votes == std::uint64_t(-1))
+            {
+                std::cerr << votes;   // keep the result alive
+            }
+        }
+    }
+
+    void benchFeatures(BenchRunner& bench)
+    {
+        const FeatureKernel kernels[] = { FeatureKernel::Scalar, FeatureKernel::Avx2, FeatureKernel::Neon };
+        bool any = false;
+        for (FeatureKernel k : kernels)
+        {
+            any = any || bench.enabled(std::string("features.compute/") + featureKernelName(k));
+        }
+        if (!any)
+        {
+            return;
+        }
+
+        // RSSI-like windows, partly filled, flat and fresh links included
+        const std::size_t links = 1000;
+        LinkFeatureTable table(links, 16);
+        std::mt19937 rng(25);
+        std::normal_distribution<float> noise(0.0f, 3.0f);
+        for (std::size_t step = 0; step < 40; ++step)
+        {
+            for (std::size_t l = 0; l < links; ++l)
+            {
+                if (l % 10 == 3 && step > 0)
+                {
+                    continue;   // one sample only: a flat window
+                }
+                if (l % 10 == 7 && step < 35)
+                {
+                    continue;   // seen recently
+                }
+                table.push(l, -40.0f - float(l % 50) + noise(rng) * float(l % 4));
+            }
+        }
+
+        // one op = every feature of all 1000 links over a 16-sample window
+        for (FeatureKernel k : kernels)
+        {
+            const std::string name = std::string("features.compute/") + featureKernelName(k);
+            if (!featureKernelSupported(k) || !bench.enabled(name))
+            {
+                continue;
+            }
+            bench.run(name, [&](std::uint64_t n)
+            {
+                for (std::uint64_t i = 0; i < n; ++i)
+                {
+                    table.compute(k);
+                }
+                return n;
+            });
+        }
+    }
+
+    /// Output batch of a sharded.process worker thread (main.cpp keeps one per worker the same way)
+    thread_local FileLogger::Batch shardBatch;
+
+    void benchSharded(BenchRunner& bench, const std::string& dir)
+    {
+        // 256 ESP publishers x 16 SSIDs, fed by two producer threads like on_message + scans
+        std::vector<LinkId> links;
+        for (int e = 0; e < 256; ++e)
+        {
+            for (int s = 0; s < 16; ++s)
+            {
+                links.push_back(symbols.link("motion/esp32/node" + std::to_string(e), "SSID-" + std::to_string(s)));
+            }
+        }
+        std::vector<Sample> samples(1 << 16);
+        std::mt19937 rng(13);
+        for (std::size_t i = 0; i < samples.size(); ++i)
+        {
+            samples[i] = Sample{ std::int64_t(i), links[rng() % links.size()], -60.0f + float(rng() % 20) };
+        }
+
+        // the real output stage (as in motion_detector): lines formatted per
+        // worker, written to CSV, console (discarded) and the DB queue per batch
+        FileLogger fileLogger(dir + "/bench_sharded.csv");
+        NullBuffer null;
+        std::streambuf* console = std::cout.rdbuf(&null);
+
+        const std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+        for (std::size_t workers : { 1, 2, 4, 8 })
+        {
+            const std::string name = "sharded.process/" + std::to_string(workers) + "w";
+            if (workers > cores || !bench.enabled(name))
+            {
+                continue;
+            }
+            // one op = one sample through push, detection and the output stage;
+            // every batch runs a fresh detector until its queues are drained
+            bench.run(name, [&](std::uint64_t n)
+            {
+                VirtualTime time;
+                ShardedDetector::Options options;
+                options.workers = workers;
+                options.producers = 2;
+                options.calibrationSec = 0;   // calibrated on the first tick: measure detection
+                options.queueCapacity = 1 << 14;
+                ShardedDetector detector(time, options,
+                    [&](const Sample& m, bool) { fileLogger.add(shardBatch, m); },
+                    ShardedDetector::EpisodeFn(),
+                    [&] { fileLogger.write(shardBatch); });
+                detector.start();
+                auto produce = [&](std::size_t producer)
+                {
+                    for (std::uint64_t i = producer; i < n; i += 2)
+                    {
+                        while (!detector.push(producer, samples[i & (samples.size() - 1)]))
+                        {
+                            std::this_thread::yield();
+                        }
+                    }
+                };
+                std::thread second(produce, 1);
+                produce(0);
+                second.join();
+                detector.stop();
+                return n;
+            });
+        }
+        std::cout.rdbuf(console);
+        db.flush();
+    }
+
+    void benchLogger(BenchRunner& bench, const std::string& dir)
+    {
+        if (!bench.enabled("logger.log"))
+        {
+            return;
+        }
+        const std::vector<Sample> samples = makeSamples(32, 4096, 5);
+        FileLogger fileLogger(dir + "/bench_log.csv");
+        NullBuffer null;
+        std::streambuf* console = std::cout.rdbuf(&null);
+        std::size_t next = 0;
+        // CSV line + console line + enqueue on the DB writer thread
+        bench.run("logger.log", [&](std::uint64_t n)
+        {
+            for (std::uint64_t i = 0; i < n; ++i)
+            {
+                fileLogger.log(samples[next]);
+                next = next + 1 == samples.size() ? 0 : next + 1;
+            }
+            return n;
+        });
+        std::cout.rdbuf(console);
+        db.flush();
+    }
+
+    void benchSQLite(BenchRunner& bench)
+    {
+        const std::vector<Sample> samples = makeSamples(64, 1 << 16, 9);
+        std::size_t next = 0;
+
+        // one op = one row; timed from enqueue until committed
+        bench.run("sqlite.insert_batched", [&](std::uint64_t n)
+        {
+            for (std::uint64_t i = 0; i < n; ++i)
+            {
+                db.enqueueSignal(samples[next]);
+                next = next + 1 == samples.size() ? 0 : next + 1;
+            }
+            db.flush();
+            return n;
+        });
+
+        if (!bench.enabled("sqlite.read_range_1min") && !bench.enabled("sqlite.read_span_raw")
+            && !bench.enabled("sqlite.read_span_rollup") && !bench.enabled("sqlite.read_span_paged"))
+        {
+            return;
+        }
+        // fill at least the time span of the samples once, then read 1-minute windows
+        for (const Sample& s : samples)
+        {
+            db.enqueueSignal(s);
+        }
+        db.flush();
+        const std::int64_t t0 = samples.front().tsUs;
+        const std::int64_t span = samples.back().tsUs - t0;
+        const std::int64_t window = 60 * 1000000;
+        std::vector<Measurement> out;
+        std::mt19937_64 rng(11);
+        std::uint64_t rows = 0;
+        bench.run("sqlite.read_range_1min", [&](std::uint64_t n)
+        {
+            for (std::uint64_t i = 0; i < n; ++i)
+            {
+                const std::int64_t from = t0 + std::int64_t(rng() % std::uint64_t(span - window));
+                out.clear();
+                db.readSignal(from, from + window, out);
+                rows += out.size();
+            }
+            return n;
+        });
+
+        // per-link, per-minute statistics of the whole span: from the raw rows
+        // versus from rollup_1m
+        const std::int64_t end = t0 + span + 1;
+        bench.run("sqlite.read_span_raw", [&](std::uint64_t n)
+        {
+            for (std::uint64_t i = 0; i < n; ++i)
+            {
+                double sum = 0.0;
+                db.forEachSignal(t0, end, [&](std::int64_t, std::string_view, std::string_view, double rssi) { sum += rssi; });
+                rows += sum != 0.0;
+            }
+            return n;
+        });
+        bench.run("sqlite.read_span_rollup", [&](std::uint64_t n)
+        {
+            for (std::uint64_t i = 0; i < n; ++i)
+            {
+                double sum = 0.0;
+                db.forEachRollup(t0, end, 1000, [&](const RollupRow& r) { sum += r.mean * double(r.count); });
+                rows += sum != 0.0;
+            }
+            return n;
+        });
+
+        // the whole span again through a cursor, in keyset pages of 1000 rows
+        auto readPaged = [&]()
+        {
+            RangeQuery q;
+            q.fromUs = t0;
+            q.toUs = end;
+            q.limit = 1000;
+            std::uint64_t paged = 0;
+            for (;;)
+            {
+                SignalCursor cursor = db.openSignals(q);
+                SignalRow row;
+                std::size_t page = 0;
+                while (cursor.next(row))
+                {
+                    ++page;
+                }
+                paged += page;
+                if (page < q.limit)
+                {
+                    return paged;
+                }
+                q.after = cursor.lastKey();
+            }
+        };
+        bench.run("sqlite.read_span_paged", [&](std::uint64_t n)
+        {
+            for (std::uint64_t i = 0; i < n; ++i)
+            {
+                rows += readPaged();
+            }
+            return n;
+        });
+        if (rows == std::uint64_t(-1))
+        {
+            std::cerr << rows;   // keep the result alive
+        }
+    }
+
+    void usage(const char* argv0)
+    {
+        std::cerr << "Usage: " << argv0 << " [options]\n"
+            << "  --filter=TEXT     only run benchmarks whose name contains TEXT\n"
+            << "  --min-time-ms=N   time spent per benchmark (default: 500)\n"
+            << "  --data-dir=DIR    recorded iw dumps (default: " MOTION_BENCH_DATA_DIR ")\n"
+            << "  --out=FILE        write the JSON results to FILE instead of stdout\n";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string filter;
+    std::string dataDir = MOTION_BENCH_DATA_DIR;
+    std::string outPath;
+    long minTimeMs = 500;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        if (std::strncmp(arg, "--filter=", 9) == 0)
+        {
+            filter = arg + 9;
+        }
+        else if (std::strncmp(arg, "--min-time-ms=", 14) == 0)
+        {
+            minTimeMs = std::strtol(arg + 14, nullptr, 10);
+        }
+        else if (std::strncmp(arg, "--data-dir=", 11) == 0)
+        {
+            dataDir = arg + 11;
+        }
+        else if (std::strncmp(arg, "--out=", 6) == 0)
+        {
+            outPath = arg + 6;
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // scratch directory for the database and CSV written by the benchmarks
+    char tmpl[] = "/tmp/motion_bench.XXXXXX";
+    const char* dir = mkdtemp(tmpl);
+    if (!dir)
+    {
+        std::cerr << "Cannot create scratch directory\n";
+        return 1;
+    }
+    const std::string dbPath = std::string(dir) + "/bench.db";
+    if (!db.open(dbPath) || !db.initSchema() || !db.startWriter(512, std::chrono::milliseconds(250), 1u << 20))
+    {
+        std::cerr << "Cannot open benchmark database " << dbPath << "\n";
+        return 1;
+    }
+
+    BenchRunner bench(std::chrono::milliseconds(minTimeMs), filter);
+    benchScanner(bench, dataDir);
+    benchPayload(bench);
+#if MOTION_INSTRUMENT
+    benchInstrument(bench);
+#endif
+    benchDetector(bench);
+    benchEpisodes(bench);
+    benchFusion(bench);
+    benchFeatures(bench);
+    benchSharded(bench, dir);
+    benchLogger(bench, dir);
+    benchSQLite(bench);
+    db.stopWriter();
+
+    if (outPath.empty())
+    {
+        bench.writeJson(std::cout);
+    }
+    else
+    {
+        std::ofstream out(outPath);
+        bench.writeJson(out);
+    }
+
+    for (const char* f : { "/bench.db", "/bench.db-wal", "/bench.db-shm", "/bench_log.csv", "/bench_sharded.csv" })
+    {
+        unlink((std::string(dir) + f).c_str());
+    }
+    rmdir(dir);
+    return 0;
+}
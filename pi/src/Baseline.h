@@ -0,0 +1,158 @@
+// Baseline.h
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+
+/// How a link's baseline (the RSSI it is compared against) evolves after calibration
+enum class BaselineMode
+{
+    Frozen,   ///< calibration (or warm-up) mean, never updated
+    Ewma,     ///< exponentially weighted mean/variance of the non-movement samples
+    Window,   ///< mean/variance of the last N non-movement samples
+};
+
+/// Parse "frozen" / "ewma" / "window"; returns false on anything else
+inline bool parseBaselineMode(const std::string& text, BaselineMode& mode)
+{
+    if (text == "frozen") { mode = BaselineMode::Frozen; return true; }
+    if (text == "ewma")   { mode = BaselineMode::Ewma;   return true; }
+    if (text == "window") { mode = BaselineMode::Window; return true; }
+    return false;
+}
+
+struct BaselineConfig
+{
+    BaselineMode  mode = BaselineMode::Ewma;
+    double        alpha = 0.01;   ///< EWMA weight of a new sample
+    std::uint32_t window = 64;    ///< ring-buffer length for BaselineMode::Window
+    /// Samples a link first seen after calibration (including one that was
+    /// evicted and came back) is watched for before its baseline is seeded
+    std::uint32_t warmup = 8;
+    /// EWMA/window: after this many movement samples in a row at a steady new
+    /// level (a moved access point, not someone walking), the baseline jumps
+    /// to that level (0: never)
+    std::uint32_t relearn = 64;
+};
+
+/// Per-link baseline estimate. All updates are O(1).
+struct BaselineState
+{
+    double mean = std::numeric_limits<double>::quiet_NaN();  ///< NaN until calibrated
+    double var = 0.0;
+
+    // Window mode: the ring itself lives outside (one slice per tracked link)
+    std::uint32_t head = 0;     ///< next ring slot to overwrite
+    std::uint32_t filled = 0;   ///< valid ring slots
+    double        sum = 0.0;    ///< sum of the valid slots
+    double        sumSq = 0.0;  ///< sum of squares of the valid slots
+    double        seedMean = 0.0;   ///< calibration mean, stands in for unfilled slots
+    double        seedVar = 0.0;
+
+    // Re-baselining: Welford statistics of the current run of movement samples
+    std::uint32_t runCount = 0;
+    double        runMean = 0.0;
+    double        runM2 = 0.0;
+
+    bool valid() const { return !std::isnan(mean); }
+
+    /// Start from the calibration statistics
+    void seed(double calibMean, double calibVar)
+    {
+        mean = seedMean = calibMean;
+        var = seedVar = calibVar;
+        head = filled = 0;
+        sum = sumSq = 0.0;
+        runCount = 0;
+    }
+
+    /// Add movement sample x to the current run. Returns true once the run is
+    /// `n` samples long and about as steady as the baseline itself (standard
+    /// deviation within twice the baseline's, and at least 1 dB): a lasting
+    /// offset rather than a person moving, whose RSSI keeps swinging.
+    bool shifted(double x, std::uint32_t n)
+    {
+        if (runCount == 0)
+        {
+            runMean = runM2 = 0.0;
+        }
+        ++runCount;
+        double delta = x - runMean;
+        runMean += delta / runCount;
+        runM2 += delta * (x - runMean);
+        if (runCount < n)
+        {
+            return false;
+        }
+        double runVar = runM2 / (runCount - 1);
+        double limit = std::max(2.0 * std::sqrt(var), 1.0);
+        if (runVar <= limit * limit)
+        {
+            return true;
+        }
+        runCount = 0;   // too noisy: start a new run
+        return false;
+    }
+
+    /// A non-movement sample ends the run
+    void quiet() { runCount = 0; }
+
+    /// Variance of the current run (valid once shifted() returned true)
+    double runVariance() const { return runCount > 1 ? runM2 / (runCount - 1) : 0.0; }
+
+    /// Exponentially weighted update (West's incremental form)
+    void updateEwma(double x, double alpha)
+    {
+        double diff = x - mean;
+        double incr = alpha * diff;
+        mean += incr;
+        var = (1.0 - alpha) * (var + diff * incr);
+    }
+
+    /// Sliding-window update over ring[0..n). Until the ring is full the
+    /// missing slots count as the calibration mean, so one sample cannot yank
+    /// the baseline away from calibration.
+    void updateWindow(double x, float* ring, std::uint32_t n)
+    {
+        if (filled == n)
+        {
+            double old = ring[head];
+            sum -= old;
+            sumSq -= old * old;
+        }
+        else
+        {
+            ++filled;
+        }
+        ring[head] = static_cast<float>(x);
+        x = ring[head];   // keep the sums consistent with what is stored
+        sum += x;
+        sumSq += x * x;
+        if (++head == n)
+        {
+            head = 0;
+            // re-sum once per lap so rounding errors cannot accumulate
+            sum = sumSq = 0.0;
+            for (std::uint32_t i = 0; i < filled; ++i)
+            {
+                sum += ring[i];
+                sumSq += double(ring[i]) * ring[i];
+            }
+        }
+
+        double missing = static_cast<double>(n - filled);
+        mean = (sum + missing * seedMean) / n;
+        if (filled >= 2)
+        {
+            double m = sum / filled;
+            var = std::max(0.0, (sumSq - filled * m * m) / (filled - 1));
+        }
+        else
+        {
+            var = seedVar;
+        }
+    }
+};
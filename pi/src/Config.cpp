@@ -0,0 +1,188 @@
+// Config.cpp
+#include "Config.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+    /// If `arg` is "--name=value", store value and return true
+    bool option(const char* arg, const char* name, std::string& value)
+    {
+        std::size_t n = std::strlen(name);
+        if (std::strncmp(arg, "--", 2) != 0 || std::strncmp(arg + 2, name, n) != 0 || arg[2 + n] != '=')
+        {
+            return false;
+        }
+        value = arg + 3 + n;
+        return true;
+    }
+
+    bool intOption(const char* arg, const char* name, int& value, bool& bad)
+    {
+        std::string text;
+        if (!option(arg, name, text))
+        {
+            return false;
+        }
+        char* end = nullptr;
+        long v = std::strtol(text.c_str(), &end, 10);
+        bad = text.empty() || *end != '\0' || v < 0;
+        value = static_cast<int>(v);
+        return true;
+    }
+
+    bool doubleOption(const char* arg, const char* name, double& value, bool& bad)
+    {
+        std::string text;
+        if (!option(arg, name, text))
+        {
+            return false;
+        }
+        char* end = nullptr;
+        value = std::strtod(text.c_str(), &end);
+        bad = text.empty() || *end != '\0';
+        return true;
+    }
+
+    /// Quote `s` for /bin/sh
+    std::string shellQuote(const std::string& s)
+    {
+        std::string out = "'";
+        for (char c : s)
+        {
+            if (c == '\'')
+            {
+                out += "'\\''";
+            }
+            else
+            {
+                out += c;
+            }
+        }
+        return out + "'";
+    }
+}
+
+int Config::workerCount() const
+{
+    if (workers > 0)
+    {
+        return workers;
+    }
+    const int cores = static_cast<int>(std::thread::hardware_concurrency());
+    return cores > 2 ? cores - 1 : 1;
+}
+
+std::string Config::scanCommand() const
+{
+    return scanDump.empty() ? scanCmd : "cat " + shellQuote(scanDump);
+}
+
+void printUsage(const char* argv0)
+{
+    std::cerr << "Usage: " << argv0 << " [options]\n"
+        << "  --scan-cmd=CMD       command printing `iw` scan output (default: sudo iw dev wlan0 scan)\n"
+        << "  --scan-dump=FILE     replay a recorded `iw dev wlan0 scan` output instead of scanning\n"
+        << "  --scan-interval-ms=N minimum time between scan starts (default: 0, back-to-back)\n"
+        << "  --max-links=N        (source, SSID) links tracked per worker, LRU-evicted (default: 4096)\n"
+        << "  --workers=N          detector threads, sources are sharded across them (default: cores - 1)\n"
+        << "  --binlog-dir=DIR     also write samples to a binary segment log in DIR (read with motion_logdump)\n"
+        << "  --binlog-segment-mb=N size of one binary log segment (default: 64)\n"
+        << "  --metrics-port=N     serve Prometheus metrics on http://ADDR:N/metrics (default: 0, off)\n"
+        << "  --metrics-addr=ADDR  address the metrics endpoint listens on (default: 127.0.0.1; 0.0.0.0 for all interfaces)\n"
+        << "  --retention-days=N   delete raw measurements older than N days (default: 0, keep)\n"
+        << "  --retention-1m-days=N delete per-minute rollups older than N days (default: 0, keep)\n"
+        << "  --baseline=MODE      frozen | ewma | window: how baselines adapt after calibration (default: ewma)\n"
+        << "  --ewma-alpha=A       weight of a new sample in the EWMA baseline (default: 0.01)\n"
+        << "  --window=N           samples in the sliding-window baseline (default: 64)\n"
+        << "  --relearn=N          re-baseline a link after N steady movement samples in a row (default: 64, 0: off)\n"
+        << "  --exit-threshold=D   |deviation| in dB under which an episode counts as quiet (default: 6)\n"
+        << "  --min-dwell-ms=N     report an episode only once it has lasted N ms (default: 1000)\n"
+        << "  --episode-quiet-ms=N end an episode after N ms without a sample past the exit threshold (default: 5000)\n"
+        << "  --fusion-tick-ms=N   resample all links onto an N ms grid and vote across them (default: 500, 0: off)\n"
+        << "  --fusion-min-vote=F  weighted share of links past the threshold for fused movement (default: 0.3)\n";
+}
+
+bool parseArgs(int argc, char** argv, Config& cfg)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        bool bad = false;
+        if (option(arg, "scan-cmd", cfg.scanCmd)
+            || option(arg, "scan-dump", cfg.scanDump)
+            || intOption(arg, "scan-interval-ms", cfg.scanIntervalMs, bad)
+            || intOption(arg, "max-links", cfg.maxLinks, bad)
+            || intOption(arg, "workers", cfg.workers, bad)
+            || option(arg, "binlog-dir", cfg.binlogDir)
+            || intOption(arg, "binlog-segment-mb", cfg.binlogSegmentMb, bad)
+            || intOption(arg, "metrics-port", cfg.metricsPort, bad)
+            || option(arg, "metrics-addr", cfg.metricsAddr)
+            || intOption(arg, "retention-days", cfg.retentionDays, bad)
+            || intOption(arg, "retention-1m-days", cfg.retention1mDays, bad)
+            || intOption(arg, "fusion-tick-ms", cfg.fusionTickMs, bad))
+        {
+            if (!bad)
+            {
+                continue;
+            }
+            std::cerr << "Bad value: " << arg << "\n";
+            printUsage(argv[0]);
+            return false;
+        }
+
+        std::string mode;
+        int window = 0;
+        int ms = 0;
+        if (option(arg, "baseline", mode))
+        {
+            bad = !parseBaselineMode(mode, cfg.baseline.mode);
+        }
+        else if (doubleOption(arg, "ewma-alpha", cfg.baseline.alpha, bad))
+        {
+            bad = bad || cfg.baseline.alpha <= 0.0 || cfg.baseline.alpha > 1.0;
+        }
+        else if (intOption(arg, "window", window, bad))
+        {
+            bad = bad || window == 0;
+            cfg.baseline.window = static_cast<std::uint32_t>(window);
+        }
+        else if (intOption(arg, "relearn", window, bad))
+        {
+            cfg.baseline.relearn = static_cast<std::uint32_t>(window);
+        }
+        else if (doubleOption(arg, "fusion-min-vote", cfg.fusionMinVote, bad))
+        {
+            bad = bad || cfg.fusionMinVote < 0.0 || cfg.fusionMinVote > 1.0;
+        }
+        else if (doubleOption(arg, "exit-threshold", cfg.episodes.exitThreshold, bad))
+        {
+            bad = bad || cfg.episodes.exitThreshold < 0.0;
+        }
+        else if (intOption(arg, "min-dwell-ms", ms, bad))
+        {
+            bad = bad || ms < 0;
+            cfg.episodes.minDwellUs = std::int64_t(ms) * 1000;
+        }
+        else if (intOption(arg, "episode-quiet-ms", ms, bad))
+        {
+            bad = bad || ms <= 0;
+            cfg.episodes.quietUs = std::int64_t(ms) * 1000;
+        }
+        else
+        {
+            std::cerr << "Unknown option: " << arg << "\n";
+            printUsage(argv[0]);
+            return false;
+        }
+        if (bad)
+        {
+            std::cerr << "Bad value: " << arg << "\n";
+            printUsage(argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
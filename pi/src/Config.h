@@ -0,0 +1,64 @@
+// Config.h
+#pragma once
+#include "Baseline.h"
+#include "EpisodeTracker.h"
+#include <string>
+
+/// Run-time settings of motion_detector, taken from the command line
+/// as --name=value (see printUsage() for the list).
+struct Config
+{
+    /// Shell command printing `iw ... scan` output (a fake script can stand in for iw)
+    std::string scanCmd = "sudo iw dev wlan0 scan";
+
+    /// Recorded `iw dev wlan0 scan` output to replay instead of scanning (empty: live scans)
+    std::string scanDump;
+
+    /// Minimum time between scan starts; 0 scans back-to-back
+    int scanIntervalMs = 0;
+
+    /// (source, SSID) links tracked per detector worker; the least recently seen is evicted beyond this
+    int maxLinks = 4096;
+
+    /// Directory of the binary segment log (empty: CSV only)
+    std::string binlogDir;
+
+    /// Size of one binary log segment before rotating to the next
+    int binlogSegmentMb = 64;
+
+    /// Detector worker threads (shards); 0 picks one per core, minus one for MQTT/scans
+    int workers = 0;
+
+    /// workers, with 0 resolved against the number of cores
+    int workerCount() const;
+
+    /// Port of the Prometheus /metrics endpoint (0: disabled) and the address it listens on.
+    /// The endpoint has no authentication, so it is local-only unless opted in.
+    int metricsPort = 0;
+    std::string metricsAddr = "127.0.0.1";
+
+    /// Raw measurements older than this many days are deleted in the background (0: kept)
+    int retentionDays = 0;
+
+    /// Per-minute rollups older than this many days are deleted, hourly ones kept (0: kept)
+    int retention1mDays = 0;
+
+    /// How link baselines adapt after calibration (--baseline, --ewma-alpha, --window, --relearn)
+    BaselineConfig baseline;
+
+    /// Grid spacing of the cross-link fusion stage (0: off) and the weighted share
+    /// of links that must be past the threshold for fused movement
+    int fusionTickMs = 500;
+    double fusionMinVote = 0.3;
+
+    /// How flagged samples are grouped into episodes (--exit-threshold, --min-dwell-ms, --episode-quiet-ms)
+    EpisodeConfig episodes;
+
+    /// The command the scan engine runs: scanCmd, or `cat` of scanDump
+    std::string scanCommand() const;
+};
+
+/// Fill `cfg` from argv. Returns false (after printing usage) on an unknown option.
+bool parseArgs(int argc, char** argv, Config& cfg);
+
+void printUsage(const char* argv0);
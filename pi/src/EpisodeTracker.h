@@ -0,0 +1,129 @@
+// EpisodeTracker.h
+#pragma once
+#include "Measurement.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <unordered_map>
+
+struct EpisodeConfig
+{
+    double       exitThreshold = 6.0;    ///< |deviation| (dB) under which a link counts as quiet
+    std::int64_t minDwellUs = 1000000;   ///< an episode is reported once it has lasted this long
+    std::int64_t quietUs = 5000000;      ///< and ends after this long without a sample past exitThreshold
+};
+
+/// Coalesces the per-sample movement decisions of one detector into episodes,
+/// with at most one open per link.
+///
+/// A sample the detector flags as movement opens an episode. Every later
+/// sample whose |deviation| is at least exitThreshold (below the detector's
+/// threshold: hysteresis) extends it, and it ends once the link has been quiet
+/// for quietUs. Episodes are reported (Started) only after minDwellUs, so a
+/// one-sample spike produces nothing; a confirmed one reports Ended exactly once.
+///
+/// Not thread-safe: like MotionPipeline, a tracker belongs to one thread.
+class EpisodeTracker
+{
+public:
+    enum class Event
+    {
+        Started,   ///< the episode has lasted minDwellUs (fields as of then)
+        Ended,     ///< final fields; endUs is the last sample past the exit level
+    };
+
+    explicit EpisodeTracker(EpisodeConfig config = EpisodeConfig())
+        : config_(config)
+    {
+    }
+
+    /// Feed one detected sample: `movement` as returned by the detector,
+    /// `deviation` its RSSI minus the link's baseline. Calls fn(const Episode&, Event).
+    template <typename Fn>
+    void observe(const Sample& m, bool movement, double deviation, Fn&& fn)
+    {
+        auto it = open_.find(m.link);
+        if (it == open_.end())
+        {
+            if (movement)
+            {
+                it = open_.emplace(m.link, Open{ Episode{ m.link, m.tsUs, m.tsUs, float(deviation), m.rssi, 0 }, false }).first;
+                extend(it->second, m, deviation, fn);
+            }
+            return;
+        }
+        if (movement || std::fabs(deviation) >= config_.exitThreshold)
+        {
+            extend(it->second, m, deviation, fn);
+        }
+        else if (m.tsUs - it->second.episode.endUs >= config_.quietUs)
+        {
+            close(it, fn);
+        }
+    }
+
+    /// End the episodes of links that have been quiet or silent for quietUs at nowUs
+    template <typename Fn>
+    void expire(std::int64_t nowUs, Fn&& fn)
+    {
+        for (auto it = open_.begin(); it != open_.end();)
+        {
+            it = nowUs - it->second.episode.endUs >= config_.quietUs ? close(it, fn) : std::next(it);
+        }
+    }
+
+    /// End every open episode (at shutdown)
+    template <typename Fn>
+    void closeAll(Fn&& fn)
+    {
+        for (auto it = open_.begin(); it != open_.end();)
+        {
+            it = close(it, fn);
+        }
+    }
+
+    /// Links with an episode in progress (confirmed or not)
+    std::size_t openEpisodes() const { return open_.size(); }
+
+    const EpisodeConfig& config() const { return config_; }
+
+private:
+    struct Open
+    {
+        Episode episode;
+        bool    confirmed;   ///< Started has been reported
+    };
+    using Map = std::unordered_map<LinkId, Open>;
+
+    template <typename Fn>
+    void extend(Open& open, const Sample& m, double deviation, Fn& fn)
+    {
+        Episode& e = open.episode;
+        e.endUs = m.tsUs;
+        ++e.samples;
+        if (std::fabs(deviation) > std::fabs(e.peakDeviation))
+        {
+            e.peakDeviation = float(deviation);
+            e.peakRssi = m.rssi;
+        }
+        if (!open.confirmed && e.endUs - e.startUs >= config_.minDwellUs)
+        {
+            open.confirmed = true;
+            fn(static_cast<const Episode&>(e), Event::Started);
+        }
+    }
+
+    template <typename Fn>
+    Map::iterator close(Map::iterator it, Fn& fn)
+    {
+        if (it->second.confirmed)
+        {
+            fn(static_cast<const Episode&>(it->second.episode), Event::Ended);
+        }
+        return open_.erase(it);
+    }
+
+    EpisodeConfig config_;
+    Map           open_;
+};
@@ -0,0 +1,348 @@
+// FusionEngine.cpp
+#include "FusionEngine.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+FusionEngine::FusionEngine(TimeSource& time, const FusionOptions& options, TickFn onTick)
+    : time_(time), options_(options), onTick_(std::move(onTick)),
+      features_(std::max<std::size_t>(options.maxLinks, 1), std::max<std::size_t>(options.window, 2))
+{
+    options_.maxLinks = std::max<std::size_t>(options_.maxLinks, 1);
+    options_.window = std::max<std::size_t>(options_.window, 2);
+    options_.tickUs = std::max<std::int64_t>(options_.tickUs, 1000);
+    for (std::size_t p = 0; p < std::max<std::size_t>(options_.producers, 1); ++p)
+    {
+        inputs_.emplace_back(new SpscQueue<Input>(options_.queueCapacity));
+    }
+    // everything is sized for maxLinks up front
+    const std::size_t n = options_.maxLinks;
+    slotLink_.assign(n, 0);
+    ringTs_.assign(n * kRing, 0);
+    ringDev_.assign(n * kRing, 0.0f);
+    ringStart_.assign(n, 0);
+    ringCount_.assign(n, 0);
+    value_.assign(n, 0.0f);
+    weight_.assign(n, 0.0f);
+    history_.assign(options_.window * n, 0.0f);
+    rowSum_.assign(options_.window, 0.0);
+    sum_.assign(n, 0.0);
+    sumSq_.assign(n, 0.0);
+}
+
+FusionEngine::~FusionEngine()
+{
+    stop();
+}
+
+void FusionEngine::start()
+{
+    if (thread_.joinable())
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        stopping_ = false;
+    }
+    thread_ = std::thread([this]() { run(); });
+}
+
+void FusionEngine::stop()
+{
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+}
+
+void FusionEngine::run()
+{
+    std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+    for (;;)
+    {
+        next += std::chrono::microseconds(options_.tickUs);
+        {
+            std::unique_lock<std::mutex> lk(mu_);
+            if (cv_.wait_until(lk, next, [this]() { return stopping_; }))
+            {
+                return;
+            }
+        }
+        const FusionTick t = tick(time_.nowUs());
+        if (onTick_)
+        {
+            onTick_(t);
+        }
+    }
+}
+
+FusionTick FusionEngine::lastTick() const
+{
+    std::lock_guard<std::mutex> lk(lastMu_);
+    return last_;
+}
+
+std::uint64_t FusionEngine::dropped() const
+{
+    std::uint64_t drops = overflow_.load(std::memory_order_relaxed);
+    for (const auto& queue : inputs_)
+    {
+        drops += queue->drops();
+    }
+    return drops;
+}
+
+std::uint32_t FusionEngine::reclaim(std::int64_t tUs)
+{
+    if (noneFadedTick_ == ticks_)
+    {
+        return kNone;   // already scanned everything this tick
+    }
+    // a link whose newest sample is this old has weight 0 at tUs
+    const std::int64_t cutoff = tUs - options_.maxAgeUs;
+    for (std::size_t n = 0; n < links_; ++n)
+    {
+        const std::size_t s = reclaimNext_;
+        reclaimNext_ = reclaimNext_ + 1 == links_ ? 0 : reclaimNext_ + 1;
+        const std::size_t count = ringCount_[s];
+        if (count && ringTs_[s * kRing + ((ringStart_[s] + count - 1) & (kRing - 1))] > cutoff)
+        {
+            continue;
+        }
+
+        index_[slotLink_[s]] = kNone;
+        ringStart_[s] = 0;
+        ringCount_[s] = 0;
+        value_[s] = 0.0f;
+        weight_[s] = 0.0f;
+        // take its column out of the coherence window and the running sums
+        for (std::size_t r = 0; r < options_.window; ++r)
+        {
+            float& v = history_[r * options_.maxLinks + s];
+            const double before = rowSum_[r];
+            const double after = before - v;
+            sSum_ += after - before;
+            sSumSq_ += after * after - before * before;
+            rowSum_[r] = after;
+            v = 0.0f;
+        }
+        sum_[s] = 0.0;
+        sumSq_[s] = 0.0;
+        features_.reset(s);
+        recycled_.fetch_add(1, std::memory_order_relaxed);
+        return static_cast<std::uint32_t>(s);
+    }
+    noneFadedTick_ = ticks_;
+    return kNone;
+}
+
+void FusionEngine::insert(const Input& in, std::int64_t tUs)
+{
+    if (in.link >= index_.size())
+    {
+        index_.resize(std::size_t(in.link) + 1, kNone);
+    }
+    std::uint32_t& slot = index_[in.link];
+    if (slot == kNone)
+    {
+        std::uint32_t s;
+        if (links_ < options_.maxLinks)
+        {
+            s = static_cast<std::uint32_t>(links_++);
+            linkCount_.store(links_, std::memory_order_relaxed);
+        }
+        else if ((s = reclaim(tUs)) == kNone)
+        {
+            overflow_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        slot = s;
+        slotLink_[s] = in.link;
+    }
+    std::int64_t* ts = &ringTs_[std::size_t(slot) * kRing];
+    float* dev = &ringDev_[std::size_t(slot) * kRing];
+    std::uint8_t& start = ringStart_[slot];
+    std::uint8_t& count = ringCount_[slot];
+    auto at = [&start](std::size_t k) { return (start + k) & (kRing - 1); };
+
+    if (count == kRing)
+    {
+        if (in.tsUs <= ts[at(0)])
+        {
+            return;   // older than everything kept
+        }
+        start = static_cast<std::uint8_t>(at(1));   // drop the oldest
+        --count;
+    }
+    // samples mostly arrive in order: insert from the back
+    std::size_t k = count;
+    while (k > 0 && ts[at(k - 1)] > in.tsUs)
+    {
+        ts[at(k)] = ts[at(k - 1)];
+        dev[at(k)] = dev[at(k - 1)];
+        --k;
+    }
+    ts[at(k)] = in.tsUs;
+    dev[at(k)] = in.deviation;
+    ++count;
+}
+
+void FusionEngine::resample(std::int64_t tUs)
+{
+    const std::size_t links = links_;
+    const float maxAge = float(options_.maxAgeUs);
+    for (std::size_t i = 0; i < links; ++i)
+    {
+        const std::int64_t* ts = &ringTs_[i * kRing];
+        const float* dev = &ringDev_[i * kRing];
+        const std::size_t start = ringStart_[i];
+        const std::size_t count = ringCount_[i];
+        auto at = [start](std::size_t k) { return (start + k) & (kRing - 1); };
+
+        // j: samples at or before tUs
+        std::size_t j = count;
+        while (j > 0 && ts[at(j - 1)] > tUs)
+        {
+            --j;
+        }
+        if (j == 0)
+        {
+            value_[i] = 0.0f;
+            weight_[i] = 0.0f;
+            continue;
+        }
+        const std::size_t before = at(j - 1);
+        if (j < count)
+        {
+            // bracketed: interpolate
+            const std::size_t after = at(j);
+            const float f = float(tUs - ts[before]) / float(ts[after] - ts[before]);
+            value_[i] = dev[before] + f * (dev[after] - dev[before]);
+            weight_[i] = 1.0f;
+        }
+        else
+        {
+            // hold the last sample, trusted less as it ages
+            value_[i] = dev[before];
+            weight_[i] = std::max(0.0f, 1.0f - float(tUs - ts[before]) / maxAge);
+        }
+    }
+}
+
+void FusionEngine::pushHistory(std::size_t links)
+{
+    // replace the oldest row of the window, keeping the per-link and row sums
+    // running, so a tick costs O(links) whatever the window
+    const std::size_t r = ticks_ % options_.window;
+    float* row = &history_[r * options_.maxLinks];
+    double s = 0.0;
+    for (std::size_t i = 0; i < links; ++i)
+    {
+        const double old = row[i];
+        const double v = std::fabs(value_[i]);
+        row[i] = static_cast<float>(v);
+        sum_[i] += v - old;
+        sumSq_[i] += v * v - old * old;
+        s += v;
+    }
+    sSum_ += s - rowSum_[r];
+    sSumSq_ += s * s - rowSum_[r] * rowSum_[r];
+    rowSum_[r] = s;
+    ++ticks_;
+}
+
+float FusionEngine::coherence(std::size_t rows, std::size_t links) const
+{
+    // Var(sum of links) = sum of variances + sum of pairwise covariances, so
+    // (Var(S) - sum Var_i) / ((L - 1) * sum Var_i) is the mean pairwise
+    // covariance over the mean variance: the mean correlation when the
+    // variances are alike. No pairs are visited.
+    const double sSum = sSum_, sSq = sSumSq_;
+    const double inv = 1.0 / double(rows);
+    double varSum = 0.0;
+    std::size_t varying = 0;
+    for (std::size_t i = 0; i < links; ++i)
+    {
+        const double mean = sum_[i] * inv;
+        const double var = sumSq_[i] * inv - mean * mean;
+        if (var > 1e-6)
+        {
+            varSum += var;
+            ++varying;
+        }
+    }
+    if (varying < 2)
+    {
+        return 0.0f;
+    }
+    const double mean = sSum * inv;
+    const double varS = sSq * inv - mean * mean;
+    const double c = (varS - varSum) / (double(varying - 1) * varSum);
+    return static_cast<float>(std::min(1.0, std::max(-1.0, c)));
+}
+
+FusionTick FusionEngine::tick(std::int64_t nowUs)
+{
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    FusionTick t;
+    t.tUs = nowUs - options_.delayUs;
+    for (auto& queue : inputs_)
+    {
+        queue->drain(queue->capacity(), [this, &t](Input& in) { insert(in, t.tUs); });
+    }
+    resample(t.tUs);
+
+    // weighted vote and score in one pass over the grid values
+    const std::size_t links = links_;
+    const float invThreshold = float(1.0 / options_.threshold);
+    float wSum = 0.0f, voteSum = 0.0f, scoreSum = 0.0f;
+    std::uint32_t active = 0, votes = 0;
+    for (std::size_t i = 0; i < links; ++i)
+    {
+        const float a = std::fabs(value_[i]) * invThreshold;
+        const float w = weight_[i];
+        const bool on = w > 0.0f;
+        const bool vote = on && a > 1.0f;
+        wSum += w;
+        scoreSum += w * std::min(a, 2.0f);
+        voteSum += vote ? w : 0.0f;
+        active += on;
+        votes += vote;
+    }
+    t.links = active;
+    t.votes = votes;
+    if (wSum > 0.0f)
+    {
+        t.vote = voteSum / wSum;
+        t.score = scoreSum / wSum;
+    }
+    t.movement = votes >= options_.minLinks && t.vote >= options_.minVote;
+
+    // this tick's |value| row, then coherence over the rows so far
+    pushHistory(links);
+    t.coherence = coherence(static_cast<std::size_t>(std::min<std::uint64_t>(ticks_, options_.window)), links);
+
+    // per-link window features, all links in one SIMD pass
+    features_.push(value_.data(), links);
+    features_.compute();
+    const float* z = features_.zscore();
+    for (std::size_t i = 0; i < links; ++i)
+    {
+        const float a = weight_[i] > 0.0f ? std::fabs(z[i]) : 0.0f;
+        t.peakZ = a > t.peakZ ? a : t.peakZ;
+    }
+
+    tickLatency_.record(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count()));
+    {
+        std::lock_guard<std::mutex> lk(lastMu_);
+        last_ = t;
+    }
+    return t;
+}
@@ -0,0 +1,156 @@
+// FusionEngine.h
+#pragma once
+#include "Histogram.h"
+#include "LinkFeatures.h"
+#include "SpscQueue.h"
+#include "TimeSource.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct FusionOptions
+{
+    std::size_t  maxLinks = 1024;          ///< links fused at once; a new link takes over the slot of one
+                                           ///< silent for maxAgeUs, or its samples are dropped if there is none
+    std::size_t  producers = 1;            ///< threads calling push(), each with its own index
+    std::size_t  queueCapacity = 8192;     ///< per producer
+    std::int64_t tickUs = 500000;          ///< grid spacing
+    std::int64_t delayUs = 1000000;        ///< grid point = tick time - delayUs, so batched ESP samples are in
+    std::int64_t maxAgeUs = 6000000;       ///< a held sample's weight falls from 1 to 0 over this age
+    double       threshold = 10.0;         ///< |deviation| (dB) at which a link votes for movement
+    double       minVote = 0.3;            ///< weighted share of votes for fused movement
+    std::size_t  minLinks = 2;             ///< and at least this many voting links
+    std::size_t  window = 16;              ///< ticks over which coherence is measured
+};
+
+/// Result of one grid tick
+struct FusionTick
+{
+    std::int64_t  tUs = 0;         ///< grid time, microseconds since the Unix epoch
+    std::uint32_t links = 0;       ///< links with a non-zero weight at tUs
+    std::uint32_t votes = 0;       ///< of them, past the threshold
+    float         vote = 0.0f;     ///< weighted share of votes
+    float         score = 0.0f;    ///< weighted mean of min(|deviation| / threshold, 2)
+    float         coherence = 0.0f;   ///< about the mean pairwise correlation of |deviation| over the window
+    float         peakZ = 0.0f;       ///< largest |z-score| of a link's grid value against its own window
+    bool          movement = false;   ///< votes >= minLinks and vote >= minVote
+};
+
+/// Correlates the links that the detector shards judge one by one.
+///
+/// Workers push each detected sample's deviation from its baseline. Every
+/// tick drains them into a small sorted ring per link, resamples all links
+/// onto one grid point (linear interpolation between the samples around it,
+/// or the last sample held with a weight that fades over maxAgeUs, so a Pi
+/// scan every few seconds and an ESP every 500 ms both count), and reduces the
+/// grid values to a weighted vote, a score and a cross-link coherence.
+///
+/// Link state is a structure of arrays indexed by a dense link number, so
+/// each tick is a few linear passes over contiguous memory. Once all maxLinks
+/// numbers are taken, a new link reuses the number of one whose newest sample
+/// has fully faded (older than maxAgeUs), so links that come and go (SSIDs
+/// seen by the Pi's scans) do not lock newer ones out.
+class FusionEngine
+{
+public:
+    using TickFn = std::function<void(const FusionTick& tick)>;
+
+    FusionEngine(TimeSource& time, const FusionOptions& options, TickFn onTick = TickFn());
+    ~FusionEngine();
+
+    FusionEngine(const FusionEngine&) = delete;
+    FusionEngine& operator=(const FusionEngine&) = delete;
+
+    /// Producer side (thread `producer` only). Returns false if its queue was full.
+    bool push(std::size_t producer, const Sample& m, float deviation)
+    {
+        return inputs_[producer]->push(Input{ m.tsUs, m.link, deviation });
+    }
+
+    /// Tick every tickUs on a thread of its own, calling onTick
+    void start();
+    void stop();
+
+    /// One tick at nowUs: drain the queues, resample, reduce. Called by the
+    /// tick thread, or directly when it is not started (replays, benchmarks).
+    FusionTick tick(std::int64_t nowUs);
+
+    /// Latest tick (for the metrics endpoint)
+    FusionTick lastTick() const;
+
+    /// Link numbers in use (at most maxLinks), numbers handed from a faded link
+    /// to a new one, and samples dropped (full queue, or maxLinks live links)
+    std::size_t links() const { return linkCount_.load(std::memory_order_relaxed); }
+    std::uint64_t recycled() const { return recycled_.load(std::memory_order_relaxed); }
+    std::uint64_t dropped() const;
+
+    /// Windowed features (variance, MAD, z-score, range) of every link's grid
+    /// values as of the last tick, indexed by dense link number; tick thread only
+    const LinkFeatureTable& features() const { return features_; }
+
+    /// add the duration of every tick so far (µs) to `out`
+    void tickLatencySnapshot(Histogram& out) const { tickLatency_.snapshot(out); }
+
+private:
+    struct Input
+    {
+        std::int64_t tsUs;
+        LinkId       link;
+        float        deviation;
+    };
+
+    static constexpr std::size_t   kRing = 8;   ///< samples kept per link (a power of two)
+    static constexpr std::uint32_t kNone = ~std::uint32_t(0);
+
+    void run();
+    void insert(const Input& in, std::int64_t tUs);
+    /// number of a link faded at grid time tUs, reset for reuse (kNone if none)
+    std::uint32_t reclaim(std::int64_t tUs);
+    void resample(std::int64_t tUs);
+    void pushHistory(std::size_t links);
+    float coherence(std::size_t rows, std::size_t links) const;
+
+    TimeSource&   time_;
+    FusionOptions options_;
+    TickFn        onTick_;
+    std::vector<std::unique_ptr<SpscQueue<Input>>> inputs_;
+
+    // tick thread only
+    std::vector<std::uint32_t> index_;     ///< LinkId -> dense link number (LinkIds are dense too)
+    std::vector<LinkId>        slotLink_;  ///< dense link number -> LinkId
+    std::size_t                links_ = 0;
+    std::size_t                reclaimNext_ = 0;        ///< where reclaim() resumes its scan
+    std::uint64_t              noneFadedTick_ = ~std::uint64_t(0);   ///< tick whose scan found nothing
+    std::vector<std::int64_t>  ringTs_;    ///< kRing per link, ascending from ringStart_
+    std::vector<float>         ringDev_;
+    std::vector<std::uint8_t>  ringStart_;
+    std::vector<std::uint8_t>  ringCount_;
+    std::vector<float>         value_;     ///< resampled deviation at the grid point
+    std::vector<float>         weight_;
+    std::vector<float>         history_;   ///< window rows of maxLinks |value|, by tick
+    std::vector<double>        rowSum_;    ///< sum of each history row
+    std::vector<double>        sum_;       ///< per link, running over the rows in the window
+    std::vector<double>        sumSq_;
+    double                     sSum_ = 0.0;   ///< running over rowSum_
+    double                     sSumSq_ = 0.0;
+    LinkFeatureTable           features_;   ///< signed grid values, window ticks per link
+    std::uint64_t              ticks_ = 0;
+    std::atomic<std::size_t>   linkCount_{ 0 };
+    std::atomic<std::uint64_t> overflow_{ 0 };   ///< samples of links beyond maxLinks
+    std::atomic<std::uint64_t> recycled_{ 0 };
+
+    mutable std::mutex lastMu_;
+    FusionTick         last_;
+    ConcurrentHistogram tickLatency_;   ///< µs per tick; tick thread only
+
+    std::mutex              mu_;
+    std::condition_variable cv_;
+    bool                    stopping_ = false;
+    std::thread             thread_;
+};
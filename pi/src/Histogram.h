@@ -0,0 +1,216 @@
+// Histogram.h
+#pragma once
+#include <atomic>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// Log-linear bucketing of non-negative integers (latencies in microseconds):
+/// values below 32 get a bucket each, above that every power of two is split
+/// into 32 linear sub-buckets, so a value is known to within ~3%. Values of
+/// 2^40 and more (12+ days in µs) share the last bucket.
+struct HistogramBuckets
+{
+    static constexpr unsigned    kSubBits = 5;
+    static constexpr std::size_t kSub = std::size_t(1) << kSubBits;
+    static constexpr unsigned    kMaxBits = 40;
+    static constexpr std::size_t kCount = (kMaxBits - kSubBits + 1) * kSub;
+
+    static std::size_t bucketOf(std::uint64_t v)
+    {
+        if (v < kSub)
+        {
+            return static_cast<std::size_t>(v);
+        }
+        const unsigned msb = 63u - static_cast<unsigned>(__builtin_clzll(v));
+        if (msb >= kMaxBits)
+        {
+            return kCount - 1;
+        }
+        const unsigned shift = msb - kSubBits;
+        return (shift + 1) * kSub + static_cast<std::size_t>((v >> shift) - kSub);
+    }
+
+    /// Smallest value of bucket i
+    static std::uint64_t lowOf(std::size_t i)
+    {
+        if (i < kSub)
+        {
+            return i;
+        }
+        const unsigned shift = static_cast<unsigned>(i / kSub - 1);
+        return (kSub + i % kSub) << shift;
+    }
+
+    /// Representative (middle) value of bucket i
+    static std::uint64_t midOf(std::size_t i)
+    {
+        return i < kSub ? i : lowOf(i) + (std::uint64_t(1) << (i / kSub - 1)) / 2;
+    }
+};
+
+/// Plain counts: merged snapshots, percentiles and a compact text form for transport
+class Histogram
+{
+public:
+    Histogram() : counts_(HistogramBuckets::kCount, 0) {}
+
+    void record(std::uint64_t v, std::uint64_t n = 1)
+    {
+        counts_[HistogramBuckets::bucketOf(v)] += n;
+        total_ += n;
+    }
+
+    void add(const Histogram& other)
+    {
+        for (std::size_t i = 0; i < counts_.size(); ++i)
+        {
+            counts_[i] += other.counts_[i];
+        }
+        total_ += other.total_;
+    }
+
+    /// Remove an earlier snapshot of the same (cumulative) histogram
+    void subtract(const Histogram& earlier)
+    {
+        total_ = 0;
+        for (std::size_t i = 0; i < counts_.size(); ++i)
+        {
+            counts_[i] = counts_[i] >= earlier.counts_[i] ? counts_[i] - earlier.counts_[i] : 0;
+            total_ += counts_[i];
+        }
+    }
+
+    void clear()
+    {
+        counts_.assign(counts_.size(), 0);
+        total_ = 0;
+    }
+
+    std::uint64_t total() const { return total_; }
+    std::uint64_t bucket(std::size_t i) const { return counts_[i]; }
+    void addBucket(std::size_t i, std::uint64_t n)
+    {
+        counts_[i] += n;
+        total_ += n;
+    }
+
+    /// Value below which a fraction q (0..1) of the recorded values lie; 0 if empty
+    std::uint64_t percentile(double q) const
+    {
+        if (total_ == 0)
+        {
+            return 0;
+        }
+        std::uint64_t rank = static_cast<std::uint64_t>(q * static_cast<double>(total_ - 1)) + 1;
+        for (std::size_t i = 0; i < counts_.size(); ++i)
+        {
+            if (counts_[i] >= rank)
+            {
+                return HistogramBuckets::midOf(i);
+            }
+            rank -= counts_[i];
+        }
+        return HistogramBuckets::midOf(counts_.size() - 1);
+    }
+
+    /// "h1 <bucket>:<count> ..." listing the non-empty buckets
+    std::string encode() const
+    {
+        std::string out = "h1";
+        char buf[48];
+        for (std::size_t i = 0; i < counts_.size(); ++i)
+        {
+            if (counts_[i] == 0)
+            {
+                continue;
+            }
+            char* p = buf;
+            *p++ = ' ';
+            p = std::to_chars(p, buf + sizeof(buf), i).ptr;
+            *p++ = ':';
+            p = std::to_chars(p, buf + sizeof(buf), counts_[i]).ptr;
+            out.append(buf, p);
+        }
+        return out;
+    }
+
+    /// Parse encode() output (replacing the current counts)
+    bool decode(std::string_view text)
+    {
+        clear();
+        if (text.substr(0, 2) != "h1")
+        {
+            return false;
+        }
+        text.remove_prefix(2);
+        while (!text.empty())
+        {
+            if (text.front() == ' ')
+            {
+                text.remove_prefix(1);
+                continue;
+            }
+            std::size_t i = 0;
+            std::uint64_t n = 0;
+            auto r = std::from_chars(text.data(), text.data() + text.size(), i);
+            if (r.ec != std::errc() || r.ptr == text.data() + text.size() || *r.ptr != ':' || i >= counts_.size())
+            {
+                return false;
+            }
+            auto r2 = std::from_chars(r.ptr + 1, text.data() + text.size(), n);
+            if (r2.ec != std::errc())
+            {
+                return false;
+            }
+            addBucket(i, n);
+            text.remove_prefix(static_cast<std::size_t>(r2.ptr - text.data()));
+        }
+        return true;
+    }
+
+private:
+    std::vector<std::uint64_t> counts_;
+    std::uint64_t              total_ = 0;
+};
+
+/// Histogram written by exactly one thread and read by any: record() is two
+/// relaxed load/store pairs, no read-modify-write, no lock.
+class ConcurrentHistogram
+{
+public:
+    ConcurrentHistogram() : counts_(new std::atomic<std::uint64_t>[HistogramBuckets::kCount])
+    {
+        for (std::size_t i = 0; i < HistogramBuckets::kCount; ++i)
+        {
+            counts_[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /// Writer thread only
+    void record(std::uint64_t v)
+    {
+        std::atomic<std::uint64_t>& c = counts_[HistogramBuckets::bucketOf(v)];
+        c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    /// Add the current counts to `out` (any thread)
+    void snapshot(Histogram& out) const
+    {
+        for (std::size_t i = 0; i < HistogramBuckets::kCount; ++i)
+        {
+            const std::uint64_t n = counts_[i].load(std::memory_order_relaxed);
+            if (n)
+            {
+                out.addBucket(i, n);
+            }
+        }
+    }
+
+private:
+    std::unique_ptr<std::atomic<std::uint64_t>[]> counts_;
+};
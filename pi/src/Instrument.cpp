@@ -0,0 +1,98 @@
+// Instrument.cpp
+#include "Instrument.h"
+
+const char* stageName(Stage stage)
+{
+    switch (stage)
+    {
+    case Stage::Scan:       return "scan";
+    case Stage::MqttIngest: return "mqtt_ingest";
+    case Stage::Detect:     return "detect";
+    case Stage::Log:        return "log";
+    case Stage::DbInsert:   return "db_insert";
+    case Stage::DbCommit:   return "db_commit";
+    case Stage::Count:      break;
+    }
+    return "?";
+}
+
+#if MOTION_INSTRUMENT
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Every thread's histograms, for the lifetime of the process
+    std::mutex                                    registryMu;
+    std::vector<std::unique_ptr<StageHistograms>> registry;
+}
+
+StageHistograms* registerStageThread()
+{
+    std::lock_guard<std::mutex> lk(registryMu);
+    registry.emplace_back(new StageHistograms);
+    return registry.back().get();
+}
+
+double stageNsPerTick()
+{
+    static const double nsPerTick = []()
+    {
+#if defined(__aarch64__)
+        std::uint64_t freq;
+        asm volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+        return 1e9 / double(freq);
+#elif defined(__x86_64__) || defined(__i386__)
+        // the TSC runs at a fixed rate: measure it against the steady clock
+        const auto t0 = std::chrono::steady_clock::now();
+        const std::uint64_t c0 = stageTicks();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        const std::uint64_t c1 = stageTicks();
+        const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+        return c1 > c0 ? ns / double(c1 - c0) : 1.0;
+#else
+        return 1.0;
+#endif
+    }();
+    return nsPerTick;
+}
+
+void stageSnapshot(Stage stage, Histogram& out)
+{
+    std::lock_guard<std::mutex> lk(registryMu);
+    for (const auto& thread : registry)
+    {
+        thread->stages[static_cast<std::size_t>(stage)].snapshot(out);
+    }
+}
+
+void dumpStageLatencies(std::ostream& os)
+{
+    char line[128];
+    std::snprintf(line, sizeof(line), "%-12s %12s %10s %10s %10s %10s\n",
+        "Stage (us)", "count", "p50", "p90", "p99", "p999");
+    os << line;
+    const double usPerTick = stageNsPerTick() / 1000.0;
+    Histogram h;
+    for (unsigned s = 0; s < static_cast<unsigned>(Stage::Count); ++s)
+    {
+        h.clear();
+        stageSnapshot(static_cast<Stage>(s), h);
+        if (h.total() == 0)
+        {
+            continue;
+        }
+        std::snprintf(line, sizeof(line), "%-12s %12llu %10.1f %10.1f %10.1f %10.1f\n",
+            stageName(static_cast<Stage>(s)), static_cast<unsigned long long>(h.total()),
+            double(h.percentile(0.50)) * usPerTick, double(h.percentile(0.90)) * usPerTick,
+            double(h.percentile(0.99)) * usPerTick, double(h.percentile(0.999)) * usPerTick);
+        os << line;
+    }
+    os.flush();
+}
+#endif
@@ -0,0 +1,110 @@
+// Instrument.h
+#pragma once
+#include <cstddef>
+
+/// Pipeline stages timed when built with MOTION_INSTRUMENT (cmake -DMOTION_INSTRUMENT=ON)
+enum class Stage : unsigned
+{
+    Scan,        ///< one `iw` scan, from spawning it to its last record (ScanEngine, Scanner::scan)
+    MqttIngest,  ///< on_message: decode an ESP32 payload and queue it
+    Detect,      ///< MotionDetector::observe / isMovement
+    Log,         ///< FileLogger::write: one batch to CSV + console + binary log + DB enqueue
+    DbInsert,    ///< one measurements/motions row
+    DbCommit,    ///< COMMIT of one writer batch
+    Count
+};
+
+const char* stageName(Stage stage);
+
+#if MOTION_INSTRUMENT
+#include "Histogram.h"
+#include <cstdint>
+#include <ctime>
+#include <iosfwd>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/// Cheapest monotonic counter of the CPU: the TSC on x86, the generic timer
+/// (CNTVCT) on ARMv8, CLOCK_MONOTONIC ns elsewhere. A tick read costs a few ns
+/// where clock_gettime() costs tens.
+inline std::uint64_t stageTicks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    std::uint64_t v;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#else
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return std::uint64_t(ts.tv_sec) * 1000000000u + std::uint64_t(ts.tv_nsec);
+#endif
+}
+
+/// Length of one stageTicks() tick in ns (calibrated on first use)
+double stageNsPerTick();
+
+/// One thread's stage latencies in ticks. Written only by its thread; registered
+/// on first use and kept after the thread exits, so nothing is lost.
+struct StageHistograms
+{
+    ConcurrentHistogram stages[static_cast<std::size_t>(Stage::Count)];
+};
+
+StageHistograms* registerStageThread();
+
+/// The calling thread's histograms (registers the thread on first use)
+inline StageHistograms& threadStageHistograms()
+{
+    static thread_local StageHistograms* mine = nullptr;
+    if (!mine)
+    {
+        mine = registerStageThread();
+    }
+    return *mine;
+}
+
+/// Record one latency of `stage` (in ticks, see stageTicks()) on the calling
+/// thread, for stages that do not fit one scope, like a scan spread over many poll()s
+inline void recordStage(Stage stage, std::uint64_t ticks)
+{
+    threadStageHistograms().stages[static_cast<std::size_t>(stage)].record(ticks);
+}
+
+/// Merge every thread's latencies of `stage` (in ticks) into `out`
+void stageSnapshot(Stage stage, Histogram& out);
+
+/// Print count and p50/p90/p99/p999 (µs) of every stage that saw any samples
+void dumpStageLatencies(std::ostream& os);
+
+/// Times its scope into the calling thread's histogram of one stage
+class StageTimer
+{
+public:
+    explicit StageTimer(Stage stage)
+        : hist_(threadStageHistograms().stages[static_cast<std::size_t>(stage)]), start_(stageTicks())
+    {
+    }
+
+    ~StageTimer()
+    {
+        hist_.record(stageTicks() - start_);
+    }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+    ConcurrentHistogram& hist_;
+    std::uint64_t        start_;
+};
+
+#define MOTION_STAGE_CONCAT2(a, b) a##b
+#define MOTION_STAGE_CONCAT(a, b) MOTION_STAGE_CONCAT2(a, b)
+/// Time the rest of the enclosing scope as `stage` (e.g. MOTION_TIME_STAGE(Stage::Scan))
+#define MOTION_TIME_STAGE(stage) StageTimer MOTION_STAGE_CONCAT(stageTimer_, __LINE__)(stage)
+#else
+#define MOTION_TIME_STAGE(stage) do {} while (false)
+#endif
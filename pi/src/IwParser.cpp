@@ -0,0 +1,142 @@
+// IwParser.cpp
+#include "IwParser.h"
+#include <charconv>
+#include <cstring>
+
+namespace
+{
+    std::string_view trim(std::string_view s)
+    {
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+        {
+            s.remove_prefix(1);
+        }
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r' || s.back() == '\n'))
+        {
+            s.remove_suffix(1);
+        }
+        return s;
+    }
+
+    /// If `line` starts with `key`, strip it (and surrounding blanks) into `value`
+    bool keyValue(std::string_view line, std::string_view key, std::string_view& value)
+    {
+        if (line.size() < key.size() || line.compare(0, key.size(), key) != 0)
+        {
+            return false;
+        }
+        value = trim(line.substr(key.size()));
+        return true;
+    }
+}
+
+void IwScanParser::begin(std::int64_t tsUs, SymbolId source)
+{
+    pending_.clear();
+    tsUs_ = tsUs;
+    source_ = source;
+    ssid_.clear();
+    haveRssi_ = false;
+    is2_4ghz_ = false;
+    count_ = 0;
+}
+
+void IwScanParser::feed(const char* data, std::size_t n, std::vector<Sample>& out)
+{
+    const char* end = data + n;
+    while (data < end)
+    {
+        const char* nl = static_cast<const char*>(std::memchr(data, '\n', end - data));
+        if (!nl)
+        {
+            // keep the partial line for the next chunk
+            pending_.append(data, end - data);
+            return;
+        }
+        if (pending_.empty())
+        {
+            parseLine(std::string_view(data, nl - data), out);
+        }
+        else
+        {
+            pending_.append(data, nl - data);
+            parseLine(pending_, out);
+            pending_.clear();
+        }
+        data = nl + 1;
+    }
+}
+
+std::size_t IwScanParser::finish(std::vector<Sample>& out)
+{
+    if (!pending_.empty())
+    {
+        parseLine(pending_, out);
+        pending_.clear();
+    }
+    out.resize(count_);
+    return count_;
+}
+
+void IwScanParser::parseLine(std::string_view line, std::vector<Sample>& out)
+{
+    line = trim(line);
+    std::string_view value;
+
+    // 1) "freq:" starts a new BSS block; decide whether it is 2.4 GHz
+    if (keyValue(line, "freq:", value))
+    {
+        int freq = 0;
+        auto res = std::from_chars(value.data(), value.data() + value.size(), freq);
+        is2_4ghz_ = res.ec == std::errc() && freq >= 2400 && freq < 2500;
+
+        // Reset for the new block
+        ssid_.clear();
+        haveRssi_ = false;
+        return;
+    }
+    if (!is2_4ghz_)
+    {
+        return;
+    }
+
+    // 2) "signal: -45.00 dBm"
+    if (keyValue(line, "signal:", value))
+    {
+        auto res = std::from_chars(value.data(), value.data() + value.size(), rssi_);
+        haveRssi_ = res.ec == std::errc();
+        emit(out);
+        return;
+    }
+
+    // 3) "SSID: MyNetwork" (empty SSIDs are skipped)
+    if (keyValue(line, "SSID:", value))
+    {
+        if (!value.empty())
+        {
+            ssid_.assign(value.data(), value.size());
+        }
+        emit(out);
+    }
+}
+
+void IwScanParser::emit(std::vector<Sample>& out)
+{
+    if (ssid_.empty() || !haveRssi_)
+    {
+        return;
+    }
+    const LinkId link = symbols.link(source_, symbols.intern(ssid_));
+    if (link != SymbolTable::kNoLink)   // SymbolTable full: drop the record
+    {
+        if (count_ == out.size())
+        {
+            out.emplace_back();
+        }
+        out[count_++] = Sample{ tsUs_, link, static_cast<float>(rssi_) };
+    }
+
+    // Clear so we only emit once per block
+    ssid_.clear();
+    haveRssi_ = false;
+}
@@ -0,0 +1,43 @@
+// IwParser.h
+#pragma once
+#include "Measurement.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// Incremental parser for the text printed by `iw dev <if> scan`.
+/// Bytes can be fed in chunks of any size (lines may span chunks and be of any
+/// length); each 2.4 GHz BSS with both an SSID and a signal becomes one
+/// Sample, its SSID interned in the global SymbolTable. The output vector is
+/// reused between scans, so a warmed-up parser does not allocate.
+class IwScanParser
+{
+public:
+    /// Start a new scan. Every record of this scan gets `tsUs` and `source`.
+    void begin(std::int64_t tsUs, SymbolId source);
+
+    /// Parse as many complete lines of [data, data+n) as possible
+    void feed(const char* data, std::size_t n, std::vector<Sample>& out);
+
+    /// Parse a trailing line without '\n' and trim `out` to the records of this scan.
+    /// Returns the number of records.
+    std::size_t finish(std::vector<Sample>& out);
+
+    /// Records written to `out` so far in this scan
+    std::size_t size() const { return count_; }
+
+private:
+    void parseLine(std::string_view line, std::vector<Sample>& out);
+    void emit(std::vector<Sample>& out);
+
+    std::string pending_;       ///< partial line carried between feed() calls
+    std::int64_t tsUs_ = 0;
+    SymbolId    source_ = 0;
+    std::string ssid_;          ///< SSID of the current BSS block
+    double      rssi_ = 0.0;
+    bool        haveRssi_ = false;
+    bool        is2_4ghz_ = false;  ///< true if the current BSS block is in 2.4 GHz
+    std::size_t count_ = 0;     ///< records written to `out` in this scan
+};
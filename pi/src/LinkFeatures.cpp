@@ -0,0 +1,150 @@
+// LinkFeatures.cpp
+#include "LinkFeatures.h"
+#include <algorithm>
+#include <cmath>
+
+const char* featureKernelName(FeatureKernel kernel)
+{
+    switch (kernel)
+    {
+    case FeatureKernel::Avx2:
+        return "avx2";
+    case FeatureKernel::Neon:
+        return "neon";
+    case FeatureKernel::Scalar:
+        break;
+    }
+    return "scalar";
+}
+
+bool featureKernelSupported(FeatureKernel kernel)
+{
+    switch (kernel)
+    {
+    case FeatureKernel::Scalar:
+        return true;
+    case FeatureKernel::Avx2:
+#if MOTION_HAVE_AVX2
+        return __builtin_cpu_supports("avx2");
+#else
+        return false;
+#endif
+    case FeatureKernel::Neon:
+        // Advanced SIMD is mandatory on AArch64
+#if MOTION_HAVE_NEON
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+FeatureKernel bestFeatureKernel()
+{
+    static const FeatureKernel best = []()
+    {
+        for (FeatureKernel k : { FeatureKernel::Avx2, FeatureKernel::Neon })
+        {
+            if (featureKernelSupported(k))
+            {
+                return k;
+            }
+        }
+        return FeatureKernel::Scalar;
+    }();
+    return best;
+}
+
+void computeFeaturesScalar(const FeatureArrays& a)
+{
+    const float invWindow = 1.0f / float(a.window);
+    for (std::size_t i = 0; i < a.links; ++i)
+    {
+        // sum the offsets from the first ring row: a flat window then has its
+        // value as the exact mean, so sd is 0 rather than a rounding residue
+        const float base = a.samples[i];
+        float sum = 0.0f;
+        for (std::size_t w = 0; w < a.window; ++w)
+        {
+            sum = sum + (a.samples[w * a.stride + i] - base);
+        }
+        const float mean = base + sum * invWindow;
+
+        float sq = 0.0f, abs = 0.0f;
+        float lo = a.samples[i], hi = a.samples[i];
+        for (std::size_t w = 0; w < a.window; ++w)
+        {
+            const float x = a.samples[w * a.stride + i];
+            const float d = x - mean;
+            sq = sq + d * d;
+            abs = abs + std::fabs(d);
+            lo = x < lo ? x : lo;   // the operand order of _mm256_min_ps / max_ps
+            hi = x > hi ? x : hi;
+        }
+        const float variance = sq * invWindow;
+        const float sd = std::sqrt(variance);
+        a.mean[i] = mean;
+        a.variance[i] = variance;
+        a.mad[i] = abs * invWindow;
+        a.zscore[i] = sd > 0.0f ? (a.last[i] - mean) / sd : 0.0f;
+        a.min[i] = lo;
+        a.max[i] = hi;
+    }
+}
+
+LinkFeatureTable::LinkFeatureTable(std::size_t maxLinks, std::size_t window, FeatureKernel kernel)
+    : kernel_(featureKernelSupported(kernel) ? kernel : FeatureKernel::Scalar),
+      window_(std::max<std::size_t>(window, 1)),
+      stride_((std::max<std::size_t>(maxLinks, 1) + kFeatureLanes - 1) / kFeatureLanes * kFeatureLanes)
+{
+    samples_.assign(window_ * stride_, 0.0f);
+    last_.assign(stride_, 0.0f);
+    pos_.assign(stride_, 0);
+    seen_.assign(stride_, 0);
+    for (std::vector<float>* out : { &mean_, &variance_, &mad_, &zscore_, &min_, &max_ })
+    {
+        out->assign(stride_, 0.0f);
+    }
+}
+
+void LinkFeatureTable::first(std::size_t slot, float x)
+{
+    seen_[slot] = 1;
+    for (std::size_t w = 0; w < window_; ++w)
+    {
+        samples_[w * stride_ + slot] = x;
+    }
+    links_ = std::max(links_, slot + 1);
+}
+
+void LinkFeatureTable::push(const float* x, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        add(i, x[i]);
+    }
+}
+
+void LinkFeatureTable::compute(FeatureKernel kernel)
+{
+    const FeatureArrays a{ samples_.data(), last_.data(), stride_, window_,
+        (links_ + kFeatureLanes - 1) / kFeatureLanes * kFeatureLanes,
+        mean_.data(), variance_.data(), mad_.data(), zscore_.data(), min_.data(), max_.data() };
+    switch (featureKernelSupported(kernel) ? kernel : FeatureKernel::Scalar)
+    {
+#if MOTION_HAVE_AVX2
+    case FeatureKernel::Avx2:
+        computeFeaturesAvx2(a);
+        break;
+#endif
+#if MOTION_HAVE_NEON
+    case FeatureKernel::Neon:
+        computeFeaturesNeon(a);
+        break;
+#endif
+    default:
+        computeFeaturesScalar(a);
+        break;
+    }
+}
@@ -0,0 +1,121 @@
+// LinkFeatures.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Instruction set a feature kernel is written for
+enum class FeatureKernel
+{
+    Scalar,   ///< plain C++, the reference
+    Avx2,     ///< x86-64, 8 links per instruction
+    Neon,     ///< AArch64 (Raspberry Pi 3/4/5 on a 64-bit OS), 4 links per instruction
+};
+
+const char* featureKernelName(FeatureKernel kernel);
+
+/// True if this build contains the kernel and this CPU can run it
+bool featureKernelSupported(FeatureKernel kernel);
+
+/// The fastest supported kernel, picked once at run time
+FeatureKernel bestFeatureKernel();
+
+/// Inputs and outputs of one kernel call, one array per field (structure of
+/// arrays). Link i's window is samples[w * stride + i] for w < window; links
+/// is a multiple of kFeatureLanes, so kernels never need a scalar tail.
+struct FeatureArrays
+{
+    const float* samples;
+    const float* last;       ///< newest sample of each link
+    std::size_t  stride;
+    std::size_t  window;
+    std::size_t  links;
+    float*       mean;
+    float*       variance;   ///< population variance over the window
+    float*       mad;        ///< mean absolute deviation from the window mean
+    float*       zscore;     ///< (last - mean) / stddev, 0 if the window is flat
+    float*       min;
+    float*       max;
+};
+
+constexpr std::size_t kFeatureLanes = 8;
+
+/// The kernels. All of them give bit-for-bit the same results: each lane does
+/// the same IEEE operations in the same order as computeFeaturesScalar, with no
+/// FMA contraction and correctly rounded sqrt and division.
+void computeFeaturesScalar(const FeatureArrays& a);
+void computeFeaturesAvx2(const FeatureArrays& a);   // only if featureKernelSupported(Avx2)
+void computeFeaturesNeon(const FeatureArrays& a);   // only if featureKernelSupported(Neon)
+
+/// Windowed RSSI features of up to maxLinks links, kept as a structure of
+/// arrays so one compute() evaluates every link in a single vectorized pass.
+///
+/// Each link has a ring of `window` samples. The window statistics do not
+/// depend on sample order, so a link's first sample is copied into its whole
+/// ring and each later sample overwrites the oldest one.
+class LinkFeatureTable
+{
+public:
+    explicit LinkFeatureTable(std::size_t maxLinks = 1024, std::size_t window = 16,
+        FeatureKernel kernel = bestFeatureKernel());
+
+    /// Add sample x to link `slot` (slot < maxLinks)
+    void push(std::size_t slot, float x) { add(slot, x); }
+
+    /// Add x[i] to link i for every i < count (one tick of a dense table)
+    void push(const float* x, std::size_t count);
+
+    /// Forget link `slot`'s samples: its next push() starts a fresh window
+    void reset(std::size_t slot)
+    {
+        seen_[slot] = 0;
+        pos_[slot] = 0;
+    }
+
+    /// Evaluate every link with the table's kernel, or the one given
+    void compute() { compute(kernel_); }
+    void compute(FeatureKernel kernel);
+
+    FeatureKernel kernel() const { return kernel_; }
+    std::size_t window() const { return window_; }
+    /// One past the highest slot pushed so far
+    std::size_t links() const { return links_; }
+
+    /// Results of the last compute(), indexed by slot
+    const float* mean() const { return mean_.data(); }
+    const float* variance() const { return variance_.data(); }
+    const float* mad() const { return mad_.data(); }
+    const float* zscore() const { return zscore_.data(); }
+    const float* min() const { return min_.data(); }
+    const float* max() const { return max_.data(); }
+    float range(std::size_t slot) const { return max_[slot] - min_[slot]; }
+
+private:
+    void add(std::size_t slot, float x)
+    {
+        if (!seen_[slot])
+        {
+            first(slot, x);
+        }
+        else
+        {
+            samples_[pos_[slot] * stride_ + slot] = x;
+        }
+        if (++pos_[slot] == window_)
+        {
+            pos_[slot] = 0;
+        }
+        last_[slot] = x;
+    }
+    void first(std::size_t slot, float x);
+
+    FeatureKernel             kernel_;
+    std::size_t               window_;
+    std::size_t               stride_;
+    std::size_t               links_ = 0;
+    std::vector<float>        samples_;   ///< window rows of stride floats
+    std::vector<float>        last_;
+    std::vector<std::uint32_t> pos_;      ///< next ring row per link
+    std::vector<std::uint8_t> seen_;
+    std::vector<float>        mean_, variance_, mad_, zscore_, min_, max_;
+};
@@ -0,0 +1,43 @@
+// LinkFeaturesAvx2.cpp
+// Built with -mavx2 on x86-64 only; called after featureKernelSupported(Avx2).
+// Every step mirrors computeFeaturesScalar lane by lane (see LinkFeatures.h).
+#include "LinkFeatures.h"
+#include <immintrin.h>
+
+void computeFeaturesAvx2(const FeatureArrays& a)
+{
+    const __m256 invWindow = _mm256_set1_ps(1.0f / float(a.window));
+    const __m256 signBit = _mm256_set1_ps(-0.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    for (std::size_t i = 0; i < a.links; i += kFeatureLanes)
+    {
+        const __m256 base = _mm256_loadu_ps(a.samples + i);
+        __m256 sum = zero;
+        for (std::size_t w = 0; w < a.window; ++w)
+        {
+            sum = _mm256_add_ps(sum, _mm256_sub_ps(_mm256_loadu_ps(a.samples + w * a.stride + i), base));
+        }
+        const __m256 mean = _mm256_add_ps(base, _mm256_mul_ps(sum, invWindow));
+
+        __m256 sq = zero, abs = zero;
+        __m256 lo = base, hi = lo;
+        for (std::size_t w = 0; w < a.window; ++w)
+        {
+            const __m256 x = _mm256_loadu_ps(a.samples + w * a.stride + i);
+            const __m256 d = _mm256_sub_ps(x, mean);
+            sq = _mm256_add_ps(sq, _mm256_mul_ps(d, d));
+            abs = _mm256_add_ps(abs, _mm256_andnot_ps(signBit, d));
+            lo = _mm256_min_ps(x, lo);
+            hi = _mm256_max_ps(x, hi);
+        }
+        const __m256 variance = _mm256_mul_ps(sq, invWindow);
+        const __m256 sd = _mm256_sqrt_ps(variance);
+        const __m256 z = _mm256_div_ps(_mm256_sub_ps(_mm256_loadu_ps(a.last + i), mean), sd);
+        _mm256_storeu_ps(a.mean + i, mean);
+        _mm256_storeu_ps(a.variance + i, variance);
+        _mm256_storeu_ps(a.mad + i, _mm256_mul_ps(abs, invWindow));
+        _mm256_storeu_ps(a.zscore + i, _mm256_and_ps(_mm256_cmp_ps(sd, zero, _CMP_GT_OQ), z));
+        _mm256_storeu_ps(a.min + i, lo);
+        _mm256_storeu_ps(a.max + i, hi);
+    }
+}
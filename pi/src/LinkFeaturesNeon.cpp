@@ -0,0 +1,44 @@
+// LinkFeaturesNeon.cpp
+// Built on AArch64 only, where Advanced SIMD (with vsqrtq/vdivq) is always
+// present. Every step mirrors computeFeaturesScalar lane by lane (see
+// LinkFeatures.h); min/max are compare-and-select because FMIN/FMAX order
+// -0 below +0 and the scalar reference does not.
+#include "LinkFeatures.h"
+#include <arm_neon.h>
+
+void computeFeaturesNeon(const FeatureArrays& a)
+{
+    const float32x4_t invWindow = vdupq_n_f32(1.0f / float(a.window));
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    for (std::size_t i = 0; i < a.links; i += 4)
+    {
+        const float32x4_t base = vld1q_f32(a.samples + i);
+        float32x4_t sum = zero;
+        for (std::size_t w = 0; w < a.window; ++w)
+        {
+            sum = vaddq_f32(sum, vsubq_f32(vld1q_f32(a.samples + w * a.stride + i), base));
+        }
+        const float32x4_t mean = vaddq_f32(base, vmulq_f32(sum, invWindow));
+
+        float32x4_t sq = zero, abs = zero;
+        float32x4_t lo = base, hi = lo;
+        for (std::size_t w = 0; w < a.window; ++w)
+        {
+            const float32x4_t x = vld1q_f32(a.samples + w * a.stride + i);
+            const float32x4_t d = vsubq_f32(x, mean);
+            sq = vaddq_f32(sq, vmulq_f32(d, d));
+            abs = vaddq_f32(abs, vabsq_f32(d));
+            lo = vbslq_f32(vcltq_f32(x, lo), x, lo);
+            hi = vbslq_f32(vcgtq_f32(x, hi), x, hi);
+        }
+        const float32x4_t variance = vmulq_f32(sq, invWindow);
+        const float32x4_t sd = vsqrtq_f32(variance);
+        const float32x4_t z = vdivq_f32(vsubq_f32(vld1q_f32(a.last + i), mean), sd);
+        vst1q_f32(a.mean + i, mean);
+        vst1q_f32(a.variance + i, variance);
+        vst1q_f32(a.mad + i, vmulq_f32(abs, invWindow));
+        vst1q_f32(a.zscore + i, vbslq_f32(vcgtq_f32(sd, zero), z, zero));
+        vst1q_f32(a.min + i, lo);
+        vst1q_f32(a.max + i, hi);
+    }
+}
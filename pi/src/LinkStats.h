@@ -0,0 +1,219 @@
+// LinkStats.h
+#pragma once
+
+#include "SymbolTable.h"
+#include "Baseline.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/// Running statistics of one (source, SSID) link, updated in O(1) per sample
+/// with Welford's algorithm.
+struct LinkStats
+{
+    std::uint64_t count = 0;
+    double        mean = 0.0;
+    double        m2 = 0.0;         ///< sum of squared deviations from the mean
+    BaselineState base;             ///< seeded by calibration, then adapted
+    std::int64_t  lastSeenUs = 0;
+    std::uint32_t slot = 0;         ///< dense index in [0, capacity), stable while tracked
+
+    void add(double x)
+    {
+        ++count;
+        double delta = x - mean;
+        mean += delta / static_cast<double>(count);
+        m2 += delta * (x - mean);
+    }
+
+    /// Sample variance (0 until two samples have been seen)
+    double variance() const { return count > 1 ? m2 / static_cast<double>(count - 1) : 0.0; }
+};
+
+/// Fixed-capacity flat hash table LinkId -> LinkStats.
+///
+/// All memory is allocated up front for `maxLinks` entries: an open-addressing
+/// index (linear probing, backward-shift deletion) over a node pool that is
+/// threaded on an intrusive LRU list. When the table is full, the link seen
+/// least recently is evicted to make room, so memory never depends on uptime.
+class LinkStatsTable
+{
+public:
+    explicit LinkStatsTable(std::size_t maxLinks = 4096)
+    {
+        if (maxLinks == 0)
+        {
+            maxLinks = 1;
+        }
+        std::size_t slots = 2;
+        while (slots < maxLinks * 2)   // keep the load factor <= 0.5
+        {
+            slots <<= 1;
+        }
+        index_.assign(slots, kNone);
+        mask_ = slots - 1;
+        nodes_.resize(maxLinks);
+        for (std::uint32_t i = 0; i < maxLinks; ++i)
+        {
+            nodes_[i].next = i + 1 < maxLinks ? i + 1 : kNone;  // free list
+        }
+        free_ = 0;
+    }
+
+    std::size_t size() const { return size_; }
+    std::size_t capacity() const { return nodes_.size(); }
+    std::uint64_t evictions() const { return evictions_; }
+
+    /// Stats of `link`, or nullptr if it is not tracked
+    const LinkStats* find(LinkId link) const
+    {
+        std::uint32_t slot = lookup(link);
+        return slot == kNone ? nullptr : &nodes_[index_[slot]].stats;
+    }
+
+    /// Stats of `link`, creating them (and evicting the least recently seen
+    /// link if the table is full) if needed; marks the link as most recently seen.
+    LinkStats& touch(LinkId link, std::int64_t nowUs)
+    {
+        std::uint32_t node;
+        std::uint32_t slot = lookup(link);
+        if (slot != kNone)
+        {
+            node = index_[slot];
+            unlink(node);
+        }
+        else
+        {
+            if (free_ == kNone)
+            {
+                evict(tail_);
+            }
+            node = free_;
+            free_ = nodes_[node].next;
+            nodes_[node].link = link;
+            nodes_[node].stats = LinkStats();
+            nodes_[node].stats.slot = node;
+            insertIndex(link, node);
+            ++size_;
+        }
+        pushFront(node);
+        nodes_[node].stats.lastSeenUs = nowUs;
+        return nodes_[node].stats;
+    }
+
+    /// Call fn(LinkId, LinkStats&) for every tracked link, most recently seen first
+    template <typename Fn>
+    void forEach(Fn&& fn)
+    {
+        for (std::uint32_t n = head_; n != kNone; n = nodes_[n].next)
+        {
+            fn(nodes_[n].link, nodes_[n].stats);
+        }
+    }
+
+    template <typename Fn>
+    void forEach(Fn&& fn) const
+    {
+        for (std::uint32_t n = head_; n != kNone; n = nodes_[n].next)
+        {
+            fn(nodes_[n].link, static_cast<const LinkStats&>(nodes_[n].stats));
+        }
+    }
+
+private:
+    static constexpr std::uint32_t kNone = std::numeric_limits<std::uint32_t>::max();
+
+    struct Node
+    {
+        LinkId        link = 0;
+        std::uint32_t prev = kNone;
+        std::uint32_t next = kNone;
+        LinkStats     stats;
+    };
+
+    std::size_t home(LinkId link) const
+    {
+        // Fibonacci hashing spreads the dense ids over the whole index
+        return (static_cast<std::uint64_t>(link) * 0x9E3779B97F4A7C15ull >> 32) & mask_;
+    }
+
+    std::uint32_t lookup(LinkId link) const
+    {
+        for (std::size_t s = home(link);; s = (s + 1) & mask_)
+        {
+            if (index_[s] == kNone)
+            {
+                return kNone;
+            }
+            if (nodes_[index_[s]].link == link)
+            {
+                return static_cast<std::uint32_t>(s);
+            }
+        }
+    }
+
+    void insertIndex(LinkId link, std::uint32_t node)
+    {
+        std::size_t s = home(link);
+        while (index_[s] != kNone)
+        {
+            s = (s + 1) & mask_;
+        }
+        index_[s] = node;
+    }
+
+    void eraseIndex(std::size_t s)
+    {
+        // backward-shift deletion keeps probe sequences intact without tombstones
+        index_[s] = kNone;
+        for (std::size_t j = (s + 1) & mask_; index_[j] != kNone; j = (j + 1) & mask_)
+        {
+            std::size_t h = home(nodes_[index_[j]].link);
+            // move j back into the hole unless its home lies cyclically in (s, j]
+            bool stays = s <= j ? (s < h && h <= j) : (s < h || h <= j);
+            if (!stays)
+            {
+                index_[s] = index_[j];
+                index_[j] = kNone;
+                s = j;
+            }
+        }
+    }
+
+    void evict(std::uint32_t node)
+    {
+        eraseIndex(lookup(nodes_[node].link));
+        unlink(node);
+        nodes_[node].next = free_;
+        free_ = node;
+        --size_;
+        ++evictions_;
+    }
+
+    void unlink(std::uint32_t node)
+    {
+        Node& n = nodes_[node];
+        (n.prev == kNone ? head_ : nodes_[n.prev].next) = n.next;
+        (n.next == kNone ? tail_ : nodes_[n.next].prev) = n.prev;
+        n.prev = n.next = kNone;
+    }
+
+    void pushFront(std::uint32_t node)
+    {
+        Node& n = nodes_[node];
+        n.prev = kNone;
+        n.next = head_;
+        (head_ == kNone ? tail_ : nodes_[head_].prev) = node;
+        head_ = node;
+    }
+
+    std::vector<std::uint32_t> index_;   ///< open-addressing slots -> node, kNone if empty
+    std::size_t                mask_ = 0;
+    std::vector<Node>          nodes_;
+    std::uint32_t              head_ = kNone;  ///< most recently seen
+    std::uint32_t              tail_ = kNone;  ///< least recently seen
+    std::uint32_t              free_ = kNone;
+    std::size_t                size_ = 0;
+    std::uint64_t              evictions_ = 0;
+};
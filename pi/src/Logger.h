@@ -1,11 +1,16 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
+#include <cstdio>
 #include <mutex>
 #include <fstream>
 #include <string>
+#include <string_view>
 #include <iostream>
-#include "Scanner.h"
+#include <vector>
+#include "Instrument.h"
+#include "Measurement.h"
+#include "SegmentLog.h"
 
 #include "SQLiteDB.h"
 
@@ -15,40 +20,103 @@ class FileLogger
 {
     std::mutex mu;
     std::ofstream ofs;
+    SegmentLogWriter segments;      // optional binary sink, guarded by mu
 
 public:
+    /// Lines and samples of one thread, formatted outside the lock by add() and
+    /// handed to the sinks in one go by write(). Each worker keeps its own.
+    struct Batch
+    {
+        std::string         csv;
+        std::string         console;
+        std::vector<Sample> samples;
+        TimestampFormatter  formatter;
+    };
+
     explicit FileLogger(const std::string& fname)
     {
         ofs.open(fname, std::ios::out);
         ofs << "timestamp,source,ssid,rssi\n";
     }
 
-    void log(const Measurement& m)
+    /// Also append every sample to the binary segment log in `dir`
+    bool openSegmentLog(const std::string& dir, std::size_t segmentBytes)
+    {
+        std::lock_guard<std::mutex> lk(mu);
+        return segments.open(dir, segmentBytes);
+    }
+
+    /// Write out and close the binary segment log (if open)
+    void closeSegmentLog()
     {
         std::lock_guard<std::mutex> lk(mu);
+        segments.close();
+    }
+
+    /// Format m into `batch` (no lock, no I/O)
+    void add(Batch& batch, const Sample& m)
+    {
+        // Strings are only materialized here, at the output sinks
+        const std::string_view source = symbols.source(m.link);
+        const std::string_view ssid = symbols.ssid(m.link);
+
+        char buf[TimestampFormatter::kLength + 1];
+        const std::string_view timeStamp(buf, batch.formatter.format(m.tsUs, buf));
+        char rssi[32];
+        const std::string_view value(rssi, std::snprintf(rssi, sizeof(rssi), "%g", m.rssi));
+
+        // 1) CSV line
+        batch.csv.append(timeStamp).append(1, ',').append(source).append(1, ',')
+            .append(ssid).append(1, ',').append(value).append(1, '\n');
+
+        // 2) Console line
+        batch.console.append(timeStamp).append(" | ").append(source).append(" | ")
+            .append(ssid).append(" | ").append(value).append(" dBm\n");
 
-        // 1) Append a line to the CSV file
-        ofs << m.timeStamp << ","
-            << m.source << ","
-            << m.ssid << ","
-            << m.rssi << "\n";
-        ofs.flush();
-
-        // 2) Print to console
-        std::cout << m.timeStamp
-            << " | " << m.source
-            << " | " << m.ssid
-            << " | " << m.rssi << " dBm\n";
-
-        // 3) Insert into the measurements table (via the global db object).
-        //    If the insertion fails, print an error to stderr.
-        if (!db.saveSignal(m.timeStamp, m.source, m.ssid, m.rssi))
+        // 3) Binary segment log and measurements table
+        batch.samples.push_back(m);
+    }
+
+    /// Hand everything in `batch` to the sinks and empty it
+    void write(Batch& batch)
+    {
+        MOTION_TIME_STAGE(Stage::Log);
+        if (batch.samples.empty())
         {
-            std::cerr << "DB insert error (saveSignal): "
-                << m.timeStamp << ", "
-                << m.source << ", "
-                << m.ssid << ", RSSI=" << m.rssi << "\n";
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lk(mu);
+            ofs.write(batch.csv.data(), static_cast<std::streamsize>(batch.csv.size()));
+            ofs.flush();
+            std::cout.write(batch.console.data(), static_cast<std::streamsize>(batch.console.size()));
+
+            // Fixed-size records for the binary segment log, if enabled
+            if (segments.isOpen())
+            {
+                for (const Sample& m : batch.samples)
+                {
+                    segments.append(m);
+                }
+            }
         }
+
+        // Queue the rows for the measurements table (via the global db object).
+        // The DB writer thread batches them into a transaction and reports
+        // insert errors to stderr, so this never waits for the disk.
+        db.enqueueSignals(batch.samples.data(), batch.samples.size());
+
+        batch.csv.clear();
+        batch.console.clear();
+        batch.samples.clear();
+    }
+
+    /// add() and write() for a single sample
+    void log(const Sample& m)
+    {
+        thread_local Batch batch;
+        add(batch, m);
+        write(batch);
     }
 };
 
@@ -1,7 +1,11 @@
 // Measurement.h
 #pragma once
+#include "SymbolTable.h"
+#include "WallClock.h"
+#include <cstdint>
 #include <string>
 
+/// Text form of a sample, as read back from the database
 struct Measurement
 {
     std::string timeStamp;
@@ -9,3 +13,41 @@ struct Measurement
     std::string ssid;
     double      rssi;
 };
+
+/// Compact sample carried from the scanner/MQTT decoders through detection.
+/// Strings are only looked up (in the global SymbolTable) by the output sinks.
+struct Sample
+{
+    std::int64_t tsUs;   ///< capture time, microseconds since the Unix epoch
+    LinkId       link;   ///< interned (source, SSID)
+    float        rssi;   ///< dBm
+};
+static_assert(sizeof(Sample) == 16, "Sample is copied through every queue: keep it 16 bytes");
+
+/// A run of movement on one link (see EpisodeTracker), from the sample that
+/// crossed the threshold to the last one past the exit level
+struct Episode
+{
+    LinkId        link;
+    std::int64_t  startUs;         ///< microseconds since the Unix epoch
+    std::int64_t  endUs;
+    float         peakDeviation;   ///< RSSI minus baseline at the largest |deviation|, dB
+    float         peakRssi;        ///< RSSI of that sample, dBm
+    std::uint32_t samples;         ///< samples past the exit level
+};
+
+/// Current wall-clock time in microseconds since the Unix epoch. Taken once at
+/// ingest from a process-wide WallClock: monotonic, microsecond resolution.
+inline std::int64_t epochMicros()
+{
+    static WallClock clock;
+    return clock.nowUs();
+}
+
+/// "YYYY-MM-DD HH:MM:SS.mmm" local time of an epoch-microsecond timestamp (for output sinks)
+inline std::string formatTimestamp(std::int64_t tsUs)
+{
+    thread_local TimestampFormatter formatter;
+    char buf[TimestampFormatter::kLength + 1];
+    return std::string(buf, formatter.format(tsUs, buf));
+}
@@ -0,0 +1,278 @@
+// Metrics.cpp
+#include "Metrics.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+// Define the global Metrics instance
+Metrics metrics;
+
+SymbolCounters::SymbolCounters()
+    : chunks_(new std::atomic<std::atomic<std::uint64_t>*>[kChunks])
+{
+    for (std::size_t c = 0; c < kChunks; ++c)
+    {
+        chunks_[c].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+SymbolCounters::~SymbolCounters()
+{
+    for (std::size_t c = 0; c < kChunks; ++c)
+    {
+        delete[] chunks_[c].load(std::memory_order_relaxed);
+    }
+}
+
+std::atomic<std::uint64_t>* SymbolCounters::allocate(std::size_t chunk)
+{
+    std::lock_guard<std::mutex> lk(allocMu_);
+    std::atomic<std::uint64_t>* counters = chunks_[chunk].load(std::memory_order_acquire);
+    if (!counters)
+    {
+        counters = new std::atomic<std::uint64_t>[kChunkSize];
+        for (std::size_t i = 0; i < kChunkSize; ++i)
+        {
+            counters[i].store(0, std::memory_order_relaxed);
+        }
+        chunks_[chunk].store(counters, std::memory_order_release);
+    }
+    return counters;
+}
+
+// ---------------------------------------------------------------------------
+// Text format
+// ---------------------------------------------------------------------------
+
+void PrometheusText::family(std::string_view name, std::string_view type, std::string_view help)
+{
+    out_.append("# HELP ").append(name).append(" ").append(help).append("\n");
+    out_.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+}
+
+void PrometheusText::sample(std::string_view name, double value, std::string_view labels)
+{
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.15g", value);
+    out_.append(name);
+    if (!labels.empty())
+    {
+        out_.append("{").append(labels).append("}");
+    }
+    out_.append(" ").append(buf).append("\n");
+}
+
+void PrometheusText::histogram(std::string_view name, std::string_view help, const Histogram& h,
+    double unit, std::initializer_list<double> bounds)
+{
+    family(name, "histogram", help);
+    const std::string bucket = std::string(name) + "_bucket";
+    std::size_t i = 0;
+    std::uint64_t below = 0;
+    double sum = 0.0;
+    for (double bound : bounds)
+    {
+        // whole log-linear buckets whose largest value is within the bound
+        for (; i + 1 < HistogramBuckets::kCount && double(HistogramBuckets::lowOf(i + 1) - 1) * unit <= bound; ++i)
+        {
+            below += h.bucket(i);
+            sum += double(h.bucket(i)) * double(HistogramBuckets::midOf(i));
+        }
+        char le[32];
+        std::snprintf(le, sizeof(le), "%g", bound);
+        sample(bucket, double(below), label("le", le));
+    }
+    for (; i < HistogramBuckets::kCount; ++i)
+    {
+        sum += double(h.bucket(i)) * double(HistogramBuckets::midOf(i));
+    }
+    sample(bucket, double(h.total()), "le=\"+Inf\"");
+    sample(std::string(name) + "_sum", sum * unit);
+    sample(std::string(name) + "_count", double(h.total()));
+}
+
+std::string PrometheusText::label(std::string_view key, std::string_view value)
+{
+    std::string out(key);
+    out += "=\"";
+    for (char c : value)
+    {
+        if (c == '\\' || c == '"')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if (c == '\n')
+        {
+            out += "\\n";
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+std::uint64_t processRssBytes()
+{
+    FILE* f = std::fopen("/proc/self/statm", "r");
+    if (!f)
+    {
+        return 0;
+    }
+    unsigned long long size = 0, resident = 0;
+    const int n = std::fscanf(f, "%llu %llu", &size, &resident);
+    std::fclose(f);
+    return n == 2 ? resident * static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE)) : 0;
+}
+
+// ---------------------------------------------------------------------------
+// HTTP listener
+// ---------------------------------------------------------------------------
+
+MetricsServer::~MetricsServer()
+{
+    stop();
+}
+
+bool MetricsServer::start(const std::string& addr, int port, RenderFn render)
+{
+    if (port <= 0 || port > 65535)
+    {
+        std::cerr << "Metrics: bad port " << port << "\n";
+        return false;
+    }
+    sockaddr_in sa{};
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(static_cast<std::uint16_t>(port));
+    if (inet_pton(AF_INET, addr.c_str(), &sa.sin_addr) != 1)
+    {
+        std::cerr << "Metrics: bad listen address " << addr << "\n";
+        return false;
+    }
+
+    listenFd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd_ < 0)
+    {
+        std::cerr << "Metrics: socket() failed: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    int one = 1;
+    setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(listenFd_, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) != 0 || listen(listenFd_, 8) != 0)
+    {
+        std::cerr << "Metrics: cannot listen on " << addr << ":" << port << ": " << std::strerror(errno) << "\n";
+        close(listenFd_);
+        listenFd_ = -1;
+        return false;
+    }
+
+    render_ = std::move(render);
+    stopping_.store(false);
+    thread_ = std::thread([this]() { serve(); });
+    return true;
+}
+
+void MetricsServer::stop()
+{
+    stopping_.store(true);
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+    if (listenFd_ >= 0)
+    {
+        close(listenFd_);
+        listenFd_ = -1;
+    }
+}
+
+void MetricsServer::serve()
+{
+    while (!stopping_.load())
+    {
+        // wake up regularly to notice stop()
+        pollfd p{ listenFd_, POLLIN, 0 };
+        if (poll(&p, 1, 250) <= 0)
+        {
+            continue;
+        }
+        const int fd = accept4(listenFd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            continue;
+        }
+        handle(fd);
+        close(fd);
+    }
+}
+
+void MetricsServer::handle(int fd)
+{
+    // a slow or idle client must not stall the listener for long
+    timeval tv{ 2, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    char req[2048];
+    std::size_t len = 0;
+    while (len < sizeof(req) - 1)
+    {
+        const ssize_t n = recv(fd, req + len, sizeof(req) - 1 - len, 0);
+        if (n <= 0)
+        {
+            break;
+        }
+        len += static_cast<std::size_t>(n);
+        req[len] = '\0';
+        if (std::strstr(req, "\r\n\r\n") || std::strstr(req, "\n\n"))
+        {
+            break;
+        }
+    }
+    req[len] = '\0';
+
+    std::string_view request(req, len);
+    std::string_view status = "200 OK";
+    std::string body;
+    if (request.substr(0, 4) != "GET ")
+    {
+        status = "405 Method Not Allowed";
+    }
+    else
+    {
+        std::string_view path = request.substr(4, request.find_first_of(" \r\n", 4) - 4);
+        path = path.substr(0, path.find('?'));
+        if (path == "/metrics" || path == "/")
+        {
+            body = render_();
+        }
+        else
+        {
+            status = "404 Not Found";
+        }
+    }
+
+    std::string response = "HTTP/1.0 ";
+    response.append(status).append("\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n");
+    response.append("Content-Length: ").append(std::to_string(body.size())).append("\r\nConnection: close\r\n\r\n");
+    response.append(body);
+
+    std::size_t sent = 0;
+    while (sent < response.size())
+    {
+        const ssize_t n = send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0)
+        {
+            break;
+        }
+        sent += static_cast<std::size_t>(n);
+    }
+}
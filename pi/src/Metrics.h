@@ -0,0 +1,135 @@
+// Metrics.h
+#pragma once
+#include "Histogram.h"
+#include "SymbolTable.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+/// One counter per interned symbol (e.g. per source), without a map lookup:
+/// counters live in lazily allocated chunks indexed by SymbolId, and add() is a
+/// relaxed fetch_add once the symbol's chunk exists.
+class SymbolCounters
+{
+public:
+    SymbolCounters();
+    ~SymbolCounters();
+    SymbolCounters(const SymbolCounters&) = delete;
+    SymbolCounters& operator=(const SymbolCounters&) = delete;
+
+    void add(SymbolId id, std::uint64_t n = 1)
+    {
+        std::atomic<std::uint64_t>* chunk = chunks_[id >> kChunkBits].load(std::memory_order_acquire);
+        if (!chunk)
+        {
+            chunk = allocate(id >> kChunkBits);
+        }
+        chunk[id & (kChunkSize - 1)].fetch_add(n, std::memory_order_relaxed);
+    }
+
+    /// Call fn(SymbolId, count) for every non-zero counter
+    template <typename Fn>
+    void forEach(Fn&& fn) const
+    {
+        for (std::size_t c = 0; c < kChunks; ++c)
+        {
+            const std::atomic<std::uint64_t>* chunk = chunks_[c].load(std::memory_order_acquire);
+            for (std::size_t i = 0; chunk && i < kChunkSize; ++i)
+            {
+                const std::uint64_t n = chunk[i].load(std::memory_order_relaxed);
+                if (n)
+                {
+                    fn(static_cast<SymbolId>((c << kChunkBits) | i), n);
+                }
+            }
+        }
+    }
+
+private:
+    static constexpr std::size_t kChunkBits = 10;
+    static constexpr std::size_t kChunkSize = std::size_t(1) << kChunkBits;
+    static constexpr std::size_t kChunks = SymbolTable::kMaxSymbols / kChunkSize;
+
+    std::atomic<std::uint64_t>* allocate(std::size_t chunk);
+
+    std::mutex                                                allocMu_;
+    std::unique_ptr<std::atomic<std::atomic<std::uint64_t>*>[]> chunks_;
+};
+
+/// Process-wide counters served on /metrics. The hot paths only bump relaxed
+/// atomics; everything else (queue depths, RSS, histograms) is read when scraped.
+struct Metrics
+{
+    SymbolCounters             samples;        ///< ingested samples, by source
+    SymbolCounters             motions;        ///< movement events, by source
+    std::atomic<std::uint64_t> mqttMessages{ 0 };
+    std::atomic<std::uint64_t> badPayloads{ 0 };   ///< MQTT payloads that could not be decoded
+    std::atomic<std::uint64_t> scansCompleted{ 0 };   ///< mirrored from the ScanEngine by its thread
+    std::atomic<std::uint64_t> scansFailed{ 0 };
+    std::atomic<std::int64_t>  lastScanUs{ 0 };
+};
+
+/// Defined in Metrics.cpp
+extern Metrics metrics;
+
+/// Builds a Prometheus text-format (0.0.4) exposition
+class PrometheusText
+{
+public:
+    /// "# HELP" and "# TYPE" lines of one metric family
+    void family(std::string_view name, std::string_view type, std::string_view help);
+
+    /// One sample; `labels` is the text between the braces (e.g. source="pi"), or empty
+    void sample(std::string_view name, double value, std::string_view labels = {});
+
+    /// A histogram family from log-linear counts: `unit` is the value of 1 in
+    /// `h` (1e-6 for µs counts reported in seconds); bucket bounds are in the
+    /// reported unit, and _sum uses bucket midpoints.
+    void histogram(std::string_view name, std::string_view help, const Histogram& h, double unit,
+        std::initializer_list<double> bounds);
+
+    /// `value` as a label value: backslash, quote and newline escaped
+    static std::string label(std::string_view key, std::string_view value);
+
+    const std::string& str() const { return out_; }
+
+private:
+    std::string out_;
+};
+
+/// Resident set size of this process in bytes (from /proc/self/statm), 0 if unknown
+std::uint64_t processRssBytes();
+
+/// Minimal HTTP/1.0 listener for Prometheus scrapes: one thread, one request per
+/// connection, GET /metrics (or /) answered with whatever render() produces.
+class MetricsServer
+{
+public:
+    using RenderFn = std::function<std::string()>;
+
+    MetricsServer() = default;
+    ~MetricsServer();
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    /// Listen on addr:port and start serving. Returns false (after printing why) on error.
+    bool start(const std::string& addr, int port, RenderFn render);
+
+    /// Close the listener and join the thread
+    void stop();
+
+private:
+    void serve();
+    void handle(int fd);
+
+    RenderFn          render_;
+    int               listenFd_ = -1;
+    std::atomic<bool> stopping_{ false };
+    std::thread       thread_;
+};
@@ -1,78 +1,147 @@
 // MotionDetector.h
 #pragma once
 
+#include "Instrument.h"
 #include "Measurement.h"
-#include "Scanner.h"
+#include "LinkStats.h"
+#include "Baseline.h"
+#include <cstddef>
 #include <vector>
-#include <map>
-#include <string>
 #include <cmath>
 
-/// MotionDetector collects RSSI samples from both the Raspberry (via Wi-Fi scans)
-/// and ESP (via MQTT), computes per-(source,SSID) averages during calibration,
-/// and then lets you test individual measurements against those averages to detect movement.
+/// MotionDetector keeps running per-link (source,SSID) statistics of the RSSI samples
+/// from both the Raspberry (via Wi-Fi scans) and ESP (via MQTT), seeds each link's
+/// baseline from them at the end of calibration, and then tests measurements against
+/// that baseline to detect movement. Depending on BaselineConfig the baseline stays
+/// frozen or keeps tracking slow drift (EWMA or sliding window) from the samples that
+/// are not movement, and jumps to a new level once a link has sat there, steadily,
+/// for BaselineConfig::relearn samples. Every sample costs O(1) and memory is
+/// bounded by maxLinks.
 class MotionDetector
 {
 public:
     /// @param collectionDurationSec  calibration duration (in seconds)
     /// @param threshold              minimum RSSI deviation to count as movement (in dBm)
-    MotionDetector(int collectionDurationSec = 30, double threshold = 10.0)
-        : durationSec_(collectionDurationSec), threshold_(threshold)
+    /// @param maxLinks               links tracked at once; the least recently seen is evicted
+    /// @param baseline               how baselines adapt after calibration
+    MotionDetector(int collectionDurationSec = 30, double threshold = 10.0, std::size_t maxLinks = 4096,
+        BaselineConfig baseline = BaselineConfig())
+        : durationSec_(collectionDurationSec), threshold_(threshold), baseline_(baseline), links_(maxLinks)
     {
+        if (baseline_.window == 0)
+        {
+            baseline_.window = 1;
+        }
+        if (baseline_.mode == BaselineMode::Window)
+        {
+            // one ring slice per link slot, allocated once
+            windows_.assign(links_.capacity() * baseline_.window, 0.0f);
+        }
     }
 
     /// Returns how many seconds the calibration phase lasts
     int getDuration() const { return durationSec_; }
 
-    /// Add a single RSSI measurement (from Wi-Fi scan or MQTT) to the buffer
-    void addSample(const Measurement& m)
+    const BaselineConfig& getBaselineConfig() const { return baseline_; }
+
+    /// Fold a single RSSI measurement (from Wi-Fi scan or MQTT) into its link's statistics
+    void addSample(const Sample& m)
     {
-        samples_.push_back(m);
+        links_.touch(m.link, m.tsUs).add(m.rssi);
     }
 
-    /// Compute the average RSSI for each unique (source, SSID) pair
+    /// Seed every tracked link's baseline from its running mean and variance
     void computeAverages()
     {
-        // Temporary accumulation: map (source,SSID) ? (sumRSSI, count)
-        std::map<std::pair<std::string, std::string>, std::pair<double, int>> acc;
-        for (auto& m : samples_)
+        links_.forEach([](LinkId, LinkStats& st)
         {
-            auto key = std::make_pair(m.source, m.ssid);
-            auto& entry = acc[key];
-            entry.first += m.rssi;
-            entry.second += 1;
-        }
-
-        // Build the final averages_ map: (source,SSID) ? avgRSSI
-        averages_.clear();
-        for (auto& [key, pair] : acc)
-        {
-            averages_[key] = pair.first / pair.second;
-        }
+            st.base.seed(st.mean, st.variance());
+        });
+        calibrated_ = true;
     }
 
-    /// Return the map of (source, SSID) ? average RSSI
-    const std::map<std::pair<std::string, std::string>, double>& getAverages() const
+    /// Per-link statistics (count, mean, variance, baseline); iterate with forEach()
+    const LinkStatsTable& getLinks() const
     {
-        return averages_;
+        return links_;
     }
 
     /// Return true if this measurements RSSI is more than threshold_ away from its own average
-    bool isMovement(const Measurement& m) const
+    bool isMovement(const Sample& m) const
     {
-        auto key = std::make_pair(m.source, m.ssid);
-        auto it = averages_.find(key);
-        if (it == averages_.end())
+        MOTION_TIME_STAGE(Stage::Detect);
+        const LinkStats* st = links_.find(m.link);
+        if (!st || !st->base.valid())
         {
             // If no average is computed for this (source, SSID), treat as no movement
             return false;
         }
-        return std::fabs(m.rssi - it->second) > threshold_;
+        return std::fabs(m.rssi - st->base.mean) > threshold_;
+    }
+
+    /// Online step after calibration: add the sample to its link's statistics, test
+    /// it against the baseline, and (unless it is movement) fold it into the baseline.
+    /// A link first seen after calibration, or evicted and seen again, is
+    /// warmed up: its first BaselineConfig::warmup samples seed its baseline
+    /// (in every mode, so frozen links keep being tested after an eviction).
+    /// Returns true if the sample is movement; its RSSI minus the baseline it was
+    /// tested against goes to *deviation (0 if the link had no baseline yet).
+    bool observe(const Sample& m, double* deviation = nullptr)
+    {
+        MOTION_TIME_STAGE(Stage::Detect);
+        LinkStats& st = links_.touch(m.link, m.tsUs);
+        st.add(m.rssi);
+        if (!st.base.valid())
+        {
+            if (calibrated_ && st.count >= baseline_.warmup)
+            {
+                st.base.seed(st.mean, st.variance());
+            }
+            if (deviation)
+            {
+                *deviation = 0.0;
+            }
+            return false;
+        }
+
+        const double dev = m.rssi - st.base.mean;
+        if (deviation)
+        {
+            *deviation = dev;
+        }
+        bool movement = std::fabs(dev) > threshold_;
+        if (movement)
+        {
+            // a steady offset that persists is the new normal (moved AP, furniture)
+            if (baseline_.mode != BaselineMode::Frozen && baseline_.relearn
+                && st.base.shifted(m.rssi, baseline_.relearn))
+            {
+                st.base.seed(st.base.runMean, st.base.runVariance());
+            }
+        }
+        else
+        {
+            st.base.quiet();
+            switch (baseline_.mode)
+            {
+            case BaselineMode::Frozen:
+                break;
+            case BaselineMode::Ewma:
+                st.base.updateEwma(m.rssi, baseline_.alpha);
+                break;
+            case BaselineMode::Window:
+                st.base.updateWindow(m.rssi, &windows_[std::size_t(st.slot) * baseline_.window], baseline_.window);
+                break;
+            }
+        }
+        return movement;
     }
 
 private:
     int durationSec_;   ///< Calibration duration in seconds
     double threshold_;  ///< RSSI deviation threshold
-    std::vector<Measurement> samples_;
-    std::map<std::pair<std::string, std::string>, double> averages_;
+    BaselineConfig baseline_;
+    bool calibrated_ = false;
+    LinkStatsTable links_;
+    std::vector<float> windows_;   ///< BaselineMode::Window rings, `window` floats per link slot
 };
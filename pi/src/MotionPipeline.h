@@ -0,0 +1,72 @@
+// MotionPipeline.h
+#pragma once
+#include "MotionDetector.h"
+#include "TimeSource.h"
+#include <cstdint>
+
+/// Calibration followed by online detection over one MotionDetector. This is the
+/// path every sample takes, both in motion_detector (one pipeline per
+/// ShardedDetector worker) and in motion_replay (recorded samples under a VirtualTime).
+///
+/// start() opens the calibration window on the TimeSource's monotonic clock
+/// (so wall-clock steps cannot shorten or stretch it); until tick() sees it
+/// elapse, process() only folds samples into the per-link statistics. The tick()
+/// that ends the window seeds the baselines, and from then on process() tests
+/// each sample (and adapts its link's baseline).
+///
+/// Not thread-safe: a pipeline belongs to exactly one thread.
+class MotionPipeline
+{
+public:
+    MotionPipeline(TimeSource& time, int calibrationSec = 30, double threshold = 10.0,
+        std::size_t maxLinks = 4096, BaselineConfig baseline = BaselineConfig())
+        : time_(time), detector_(calibrationSec, threshold, maxLinks, baseline)
+    {
+    }
+
+    /// Open the calibration window at the current time
+    void start()
+    {
+        calibrationEndUs_ = time_.monotonicUs() + std::int64_t(detector_.getDuration()) * 1000000;
+    }
+
+    /// End calibration once its window has elapsed. Returns true only on the call that ended it.
+    bool tick()
+    {
+        if (calibrated_ || time_.monotonicUs() < calibrationEndUs_)
+        {
+            return false;
+        }
+        detector_.computeAverages();
+        calibrated_ = true;
+        return true;
+    }
+
+    bool calibrated() const { return calibrated_; }
+
+    /// Feed one sample; returns true if it is movement (never during calibration).
+    /// Its deviation from the baseline goes to *deviation (0 during calibration).
+    bool process(const Sample& m, double* deviation = nullptr)
+    {
+        if (!calibrated_)
+        {
+            detector_.addSample(m);
+            if (deviation)
+            {
+                *deviation = 0.0;
+            }
+            return false;
+        }
+        return detector_.observe(m, deviation);
+    }
+
+    const MotionDetector& detector() const { return detector_; }
+
+    int calibrationSec() const { return detector_.getDuration(); }
+
+private:
+    TimeSource&    time_;
+    MotionDetector detector_;
+    bool           calibrated_ = false;
+    std::int64_t   calibrationEndUs_ = 0;   ///< on time_.monotonicUs()
+};
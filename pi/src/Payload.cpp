@@ -0,0 +1,147 @@
+// Payload.cpp
+#include "Payload.h"
+#include <charconv>
+
+bool decodeTextPayload(std::string_view topic, std::string_view payload, Sample& out,
+    std::uint32_t* sendLagUs)
+{
+    // SSIDs may contain commas, the RSSI never does: split on the last one
+    auto comma = payload.rfind(',');
+    if (comma == std::string_view::npos || comma == 0)
+    {
+        return false;
+    }
+
+    // optional send timestamp: "SSID,RSSI,@sendUs" (an RSSI never starts with '@')
+    std::uint32_t lagUs = 0;
+    if (comma + 1 < payload.size() && payload[comma + 1] == '@')
+    {
+        std::string_view field = payload.substr(comma + 2);
+        while (!field.empty() && (field.back() == '\r' || field.back() == '\n'))
+        {
+            field.remove_suffix(1);
+        }
+        std::int64_t sendUs = 0;
+        auto res = std::from_chars(field.data(), field.data() + field.size(), sendUs);
+        if (res.ec != std::errc() || res.ptr != field.data() + field.size())
+        {
+            return false;
+        }
+        const std::int64_t lag = out.tsUs - sendUs;
+        lagUs = lag <= 0 ? 1 : lag >= 0xFFFFFFFFll ? 0xFFFFFFFFu : static_cast<std::uint32_t>(lag + 1);
+        payload = payload.substr(0, comma);
+        comma = payload.rfind(',');
+        if (comma == std::string_view::npos || comma == 0)
+        {
+            return false;
+        }
+    }
+
+    std::string_view number = payload.substr(comma + 1);
+    while (!number.empty() && (number.front() == ' ' || number.front() == '\t'))
+    {
+        number.remove_prefix(1);
+    }
+    while (!number.empty() && (number.back() == ' ' || number.back() == '\r' || number.back() == '\n'))
+    {
+        number.remove_suffix(1);
+    }
+
+    double rssi = 0.0;
+    auto res = std::from_chars(number.data(), number.data() + number.size(), rssi);
+    if (res.ec != std::errc() || res.ptr != number.data() + number.size())
+    {
+        return false;
+    }
+
+    if (sendLagUs)
+    {
+        *sendLagUs = lagUs;
+    }
+    out.link = symbols.link(topic, payload.substr(0, comma));
+    out.rssi = static_cast<float>(rssi);
+    return out.link != SymbolTable::kNoLink;   // SymbolTable full: reject like a malformed message
+}
+
+namespace
+{
+    std::uint32_t loadU32(const unsigned char* p)
+    {
+        return std::uint32_t(p[0]) | std::uint32_t(p[1]) << 8 | std::uint32_t(p[2]) << 16 | std::uint32_t(p[3]) << 24;
+    }
+
+    std::uint16_t loadU16(const unsigned char* p)
+    {
+        return static_cast<std::uint16_t>(p[0] | p[1] << 8);
+    }
+}
+
+bool isBinaryPayload(std::string_view payload)
+{
+    return payload.size() >= 3 && payload[0] == 'M' && payload[1] == 'D'
+        && static_cast<unsigned char>(payload[2]) < 0x20;
+}
+
+std::size_t decodeBinaryPayload(std::string_view topic, std::string_view payload, std::int64_t nowUs,
+    Sample* out, std::size_t capacity, BinaryPayloadHeader* header)
+{
+    if (payload.size() < kBinaryPayloadHeader || !isBinaryPayload(payload)
+        || static_cast<unsigned char>(payload[2]) != kBinaryPayloadVersion)
+    {
+        return 0;
+    }
+    const auto* p = reinterpret_cast<const unsigned char*>(payload.data());
+    const std::size_t count = p[3];
+    if (count == 0 || count > capacity || payload.size() != kBinaryPayloadHeader + count * kBinaryPayloadEntry)
+    {
+        return 0;
+    }
+    if (header)
+    {
+        header->deviceId = loadU32(p + 4);
+        header->seq = loadU32(p + 8);
+        header->uptimeMs = loadU32(p + 12);
+        header->count = count;
+    }
+
+    const SymbolId source = symbols.intern(topic);
+    char name[10] = { '#' };
+    static const char kHex[] = "0123456789abcdef";
+    p += kBinaryPayloadHeader;
+    for (std::size_t i = 0; i < count; ++i, p += kBinaryPayloadEntry)
+    {
+        const std::uint32_t key = loadU32(p);
+        for (int d = 0; d < 8; ++d)
+        {
+            name[1 + d] = kHex[(key >> (28 - 4 * d)) & 0xF];
+        }
+        Sample& m = out[i];
+        m.tsUs = nowUs - std::int64_t(loadU16(p + 4)) * 1000;
+        m.link = symbols.link(source, symbols.intern(std::string_view(name, 9)));
+        if (m.link == SymbolTable::kNoLink)
+        {
+            return 0;   // SymbolTable full: reject the whole message
+        }
+        m.rssi = static_cast<float>(static_cast<std::int8_t>(p[6]));
+    }
+    return count;
+}
+
+std::size_t decodePayload(std::string_view topic, std::string_view payload, std::int64_t nowUs,
+    Sample* out, std::size_t capacity, std::uint32_t* sendLagUs)
+{
+    if (sendLagUs)
+    {
+        *sendLagUs = 0;
+    }
+    if (isBinaryPayload(payload))
+    {
+        return decodeBinaryPayload(topic, payload, nowUs, out, capacity);
+    }
+    if (capacity == 0)
+    {
+        return 0;
+    }
+    out[0].tsUs = nowUs;
+    return decodeTextPayload(topic, payload, out[0], sendLagUs) ? 1 : 0;
+}
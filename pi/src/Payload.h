@@ -0,0 +1,54 @@
+// Payload.h
+#pragma once
+#include "Measurement.h"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/// Decode an ESP32 "SSID,RSSI" text payload received on `topic` into `out`
+/// (link and rssi, interned in the global SymbolTable; the caller stamps the time).
+/// A trailing ",@<send time in µs since the epoch>" field (added by motion_loadgen)
+/// sets *sendLagUs to out.tsUs minus that time, plus 1 (0: no send time), for
+/// end-to-end latency measurements.
+/// Returns false on a malformed payload instead of throwing, so a bad
+/// message can never take down the MQTT thread.
+bool decodeTextPayload(std::string_view topic, std::string_view payload, Sample& out,
+    std::uint32_t* sendLagUs = nullptr);
+
+/// Binary payload v1 from current ESP32 firmware (esp32/MotionPublisher/MotionPayload.h),
+/// all fields little-endian:
+///   header (16 B): 'M' 'D' version=1 count | deviceId u32 | seq u32 | uptimeMs u32
+///   entry   (8 B): ssid FNV-1a hash u32 | ageMs u16 | rssi i8 | flags u8
+struct BinaryPayloadHeader
+{
+    std::uint32_t deviceId = 0;
+    std::uint32_t seq = 0;
+    std::uint32_t uptimeMs = 0;   ///< device millis() when the payload was sent
+    std::size_t   count = 0;
+};
+
+constexpr unsigned char kBinaryPayloadVersion = 1;   ///< the only version decodeBinaryPayload accepts
+constexpr std::size_t kBinaryPayloadHeader = 16;
+constexpr std::size_t kBinaryPayloadEntry = 8;
+constexpr std::size_t kMaxPayloadSamples = 255;   ///< entries per payload (count is one byte)
+
+/// True if `payload` starts like a binary payload of any version: "MD" and a
+/// control byte (< 0x20) as version, which a text "SSID,RSSI" payload never has
+/// at [2]. Payloads of versions this build does not know are rejected by
+/// decodeBinaryPayload rather than read as text.
+bool isBinaryPayload(std::string_view payload);
+
+/// Decode a binary payload received on `topic` at `nowUs` into out[0..n), n <= capacity.
+/// Each entry's link is (topic, "#<hash as 8 hex digits>") and its time nowUs minus
+/// its age. Returns n, or 0 if the payload is malformed or does not fit: wrong
+/// magic or version, size not exactly header + count entries. Allocates nothing
+/// once the links are interned.
+std::size_t decodeBinaryPayload(std::string_view topic, std::string_view payload, std::int64_t nowUs,
+    Sample* out, std::size_t capacity, BinaryPayloadHeader* header = nullptr);
+
+/// Either format: binary payloads are decoded by decodeBinaryPayload, anything else
+/// as one "SSID,RSSI" text sample (old firmware) stamped with nowUs. Returns the
+/// number of samples written to out (0: malformed). *sendLagUs as for
+/// decodeTextPayload (always 0 for binary payloads).
+std::size_t decodePayload(std::string_view topic, std::string_view payload, std::int64_t nowUs,
+    Sample* out, std::size_t capacity, std::uint32_t* sendLagUs = nullptr);
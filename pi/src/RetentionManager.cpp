@@ -0,0 +1,169 @@
+// RetentionManager.cpp
+#include "RetentionManager.h"
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <iostream>
+
+RetentionManager::RetentionManager(SQLiteDB& db, RetentionOptions options)
+    : db_(db), options_(options)
+{
+}
+
+RetentionManager::~RetentionManager()
+{
+    stop();
+}
+
+void RetentionManager::start()
+{
+    if (thread_.joinable() || (options_.rawMaxAge.count() <= 0 && options_.minuteMaxAge.count() <= 0))
+    {
+        return;
+    }
+    if (!db_.incrementalVacuumEnabled())
+    {
+        std::cout << "Retention: the database was created without auto_vacuum=INCREMENTAL, so freed pages\n"
+            << "  are reused but the file does not shrink. To enable it once (takes a while, detector stopped):\n"
+            << "  sqlite3 motion_detector.db 'PRAGMA auto_vacuum=INCREMENTAL; VACUUM;'" << std::endl;
+    }
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        stopping_ = false;
+    }
+    thread_ = std::thread([this]() { run(); });
+}
+
+void RetentionManager::stop()
+{
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+}
+
+bool RetentionManager::sleep(std::chrono::milliseconds d)
+{
+    std::unique_lock<std::mutex> lk(mu_);
+    return !cv_.wait_for(lk, d, [this]() { return stopping_; });
+}
+
+void RetentionManager::run()
+{
+    // nice 19: pruning only gets the CPU that ingest and detection leave over
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);
+
+    // let start-up (schema migration, calibration) finish before the first pass
+    if (!sleep(std::min(options_.interval, std::chrono::milliseconds(10000))))
+    {
+        return;
+    }
+    do
+    {
+        pass();
+    } while (sleep(options_.interval));
+}
+
+void RetentionManager::pass()
+{
+    const Clock::time_point start = Clock::now();
+    const std::uint64_t busy0 = busyUs_.load(std::memory_order_relaxed);
+    const std::int64_t nowUs = epochMicros();
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+
+    std::uint64_t raw = 0, minutes = 0;
+    if (options_.rawMaxAge.count() > 0)
+    {
+        raw = expire(RetentionTable::Measurements, nowUs - duration_cast<microseconds>(options_.rawMaxAge).count());
+    }
+    if (options_.minuteMaxAge.count() > 0)
+    {
+        minutes = expire(RetentionTable::Rollup1m, nowUs - duration_cast<microseconds>(options_.minuteMaxAge).count());
+    }
+    const std::uint64_t bytes = vacuum();
+
+    if (raw || minutes || bytes)
+    {
+        const double busyMs = double(busyUs_.load(std::memory_order_relaxed) - busy0) / 1000.0;
+        const double wallS = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cout << "Retention: deleted " << raw << " measurements and " << minutes << " minute rollups, reclaimed "
+            << double(bytes) / (1024.0 * 1024.0) << " MB; " << busyMs << " ms in the database over "
+            << wallS << " s" << std::endl;
+    }
+}
+
+template <typename Step>
+bool RetentionManager::timedStep(std::size_t& size, Step&& step)
+{
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (stopping_)
+        {
+            return false;
+        }
+    }
+    const Clock::time_point t0 = Clock::now();
+    step();
+    const std::int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - t0).count();
+    stepLatency_.record(static_cast<std::uint64_t>(us));
+    busyUs_.fetch_add(static_cast<std::uint64_t>(us), std::memory_order_relaxed);
+
+    // steer the next step towards the budget: shrink in proportion when over
+    // it, grow at most 2x per step when under
+    const double scale = us > 0 ? std::min(2.0, double(options_.stepBudget.count()) / double(us)) : 2.0;
+    size = std::clamp<std::size_t>(static_cast<std::size_t>(double(size) * scale), 16, std::size_t(1) << 20);
+    return true;
+}
+
+std::uint64_t RetentionManager::expire(RetentionTable table, std::int64_t cutoffUs)
+{
+    std::uint64_t total = 0;
+    for (;;)
+    {
+        const std::size_t chunk = deleteChunk_;
+        std::int64_t n = 0;
+        if (!timedStep(deleteChunk_, [&]() { n = db_.deleteOldest(table, cutoffUs, chunk); }) || n <= 0)
+        {
+            break;
+        }
+        total += static_cast<std::uint64_t>(n);
+        deleted_[static_cast<std::size_t>(table)].fetch_add(static_cast<std::uint64_t>(n), std::memory_order_relaxed);
+        if (static_cast<std::size_t>(n) < chunk || !sleep(options_.pause))
+        {
+            break;
+        }
+    }
+    return total;
+}
+
+std::uint64_t RetentionManager::vacuum()
+{
+    if (!db_.incrementalVacuumEnabled())
+    {
+        return 0;
+    }
+    std::uint64_t total = 0;
+    for (;;)
+    {
+        const std::size_t pages = vacuumChunk_;
+        std::int64_t freed = 0;
+        if (!timedStep(vacuumChunk_, [&]() { freed = db_.incrementalVacuum(pages); }) || freed <= 0)
+        {
+            break;
+        }
+        total += static_cast<std::uint64_t>(freed);
+        reclaimed_.fetch_add(static_cast<std::uint64_t>(freed), std::memory_order_relaxed);
+        if (!sleep(options_.pause))
+        {
+            break;
+        }
+    }
+    return total;
+}
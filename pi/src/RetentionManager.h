@@ -0,0 +1,96 @@
+// RetentionManager.h
+#pragma once
+#include "Histogram.h"
+#include "SQLiteDB.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+/// What to prune and how gently
+struct RetentionOptions
+{
+    /// Raw measurements older than this are deleted (0: kept forever). Their
+    /// per-minute and per-hour aggregates stay in the rollup tables.
+    std::chrono::hours rawMaxAge{ 0 };
+
+    /// Minute rollups older than this are deleted, leaving the hourly ones (0: kept forever)
+    std::chrono::hours minuteMaxAge{ 0 };
+
+    /// Time between passes (the first runs shortly after start())
+    std::chrono::milliseconds interval = std::chrono::minutes(10);
+
+    /// Target length of one delete or vacuum step: the ingest writer waits at most about this long
+    std::chrono::microseconds stepBudget = std::chrono::milliseconds(5);
+
+    /// Pause between steps, so the writer gets the database in between
+    std::chrono::milliseconds pause = std::chrono::milliseconds(50);
+};
+
+/// Background pruning of motion_detector.db on one low-priority thread. Each
+/// pass deletes rows past their age in chunks sized to finish within
+/// stepBudget, then returns the freed pages to the file system with
+/// incremental vacuum, again in budgeted steps.
+class RetentionManager
+{
+public:
+    RetentionManager(SQLiteDB& db, RetentionOptions options);
+    ~RetentionManager();
+
+    RetentionManager(const RetentionManager&) = delete;
+    RetentionManager& operator=(const RetentionManager&) = delete;
+
+    /// Start the thread (no-op if nothing is configured to expire)
+    void start();
+
+    /// Finish the current step and join the thread
+    void stop();
+
+    /// Totals since start (read by the metrics endpoint)
+    std::uint64_t deletedRows(RetentionTable table) const
+    {
+        return deleted_[static_cast<std::size_t>(table)].load(std::memory_order_relaxed);
+    }
+    std::uint64_t reclaimedBytes() const { return reclaimed_.load(std::memory_order_relaxed); }
+    /// time spent inside delete/vacuum steps, i.e. holding the database
+    std::chrono::microseconds busyTime() const
+    {
+        return std::chrono::microseconds(busyUs_.load(std::memory_order_relaxed));
+    }
+    /// add the duration of every step so far (µs) to `out`
+    void stepLatencySnapshot(Histogram& out) const { stepLatency_.snapshot(out); }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void run();
+    void pass();
+    /// delete everything in `table` older than cutoffUs; returns rows deleted
+    std::uint64_t expire(RetentionTable table, std::int64_t cutoffUs);
+    /// incremental vacuum until no free pages are left; returns bytes released
+    std::uint64_t vacuum();
+    /// time one step and adapt `size` towards stepBudget; false once stopping
+    template <typename Step>
+    bool timedStep(std::size_t& size, Step&& step);
+    /// wait `d` unless stop() is called first; false if stopping
+    bool sleep(std::chrono::milliseconds d);
+
+    SQLiteDB&        db_;
+    RetentionOptions options_;
+
+    std::mutex              mu_;
+    std::condition_variable cv_;
+    bool                    stopping_ = false;
+    std::thread             thread_;
+
+    std::size_t deleteChunk_ = 1000;   ///< rows per delete, adapted to stepBudget
+    std::size_t vacuumChunk_ = 256;    ///< pages per incremental_vacuum, adapted likewise
+
+    std::atomic<std::uint64_t> deleted_[2] = {};
+    std::atomic<std::uint64_t> reclaimed_{ 0 };
+    std::atomic<std::uint64_t> busyUs_{ 0 };
+    ConcurrentHistogram        stepLatency_;   ///< µs per step; retention thread only
+};
@@ -1,7 +1,99 @@
 // src/SQLiteDB.cpp
 #include "SQLiteDB.h"
+#include "Instrument.h"
+#include <algorithm>
 #include <iostream>
 
+// The text API takes local "YYYY-MM-DD HH:MM:SS" strings; this SQL fragment
+// turns such a value (bound as ?N) into integer microseconds since the epoch.
+#define LOCAL_TEXT_TO_US(N) "CAST(strftime('%s', ?" #N ", 'utc') AS INTEGER) * 1000000"
+
+namespace
+{
+    bool exec(sqlite3* db, const char* sql, const char* what)
+    {
+        char* err = nullptr;
+        if (sqlite3_exec(db, sql, nullptr, nullptr, &err) != SQLITE_OK)
+        {
+            std::cerr << what << ": " << (err ? err : sqlite3_errmsg(db)) << "\n";
+            sqlite3_free(err);
+            return false;
+        }
+        return true;
+    }
+
+    int queryInt(sqlite3* db, const char* sql, int fallback)
+    {
+        sqlite3_stmt* stmt = nullptr;
+        int value = fallback;
+        if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK
+            && sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            value = sqlite3_column_int(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+        return value;
+    }
+
+    constexpr std::int64_t kMinuteUs = 60 * std::int64_t(1000000);
+    constexpr std::int64_t kHourUs = 60 * kMinuteUs;
+
+    // start of the bucket of width `width` that holds t
+    std::int64_t floorUs(std::int64_t t, std::int64_t width)
+    {
+        const std::int64_t r = t % width;
+        return r < 0 ? t - r - width : t - r;
+    }
+
+    // running count/min/max/mean/m2 of one bucket (Welford; merge() after Chan et al.)
+    struct RollupAcc
+    {
+        LinkId        link = 0;
+        std::int64_t  bucketUs = 0;
+        std::uint64_t count = 0;
+        double        min = 0.0;
+        double        max = 0.0;
+        double        mean = 0.0;
+        double        m2 = 0.0;
+
+        void start(LinkId l, std::int64_t bucket, double x)
+        {
+            *this = RollupAcc{ l, bucket, 1, x, x, x, 0.0 };
+        }
+
+        void add(double x)
+        {
+            ++count;
+            min = std::min(min, x);
+            max = std::max(max, x);
+            const double delta = x - mean;
+            mean += delta / double(count);
+            m2 += delta * (x - mean);
+        }
+
+        void merge(const RollupAcc& o)
+        {
+            const double n = double(count + o.count);
+            const double delta = o.mean - mean;
+            mean += delta * double(o.count) / n;
+            m2 += o.m2 + delta * delta * double(count) * double(o.count) / n;
+            min = std::min(min, o.min);
+            max = std::max(max, o.max);
+            count += o.count;
+        }
+    };
+
+    const char* const kRollupTable[2] = { "rollup_1m", "rollup_1h" };
+}
+
+SQLiteDB::~SQLiteDB()
+{
+    stopWriter();
+    finalizeStatements();
+    if (rdb_) sqlite3_close(rdb_);
+    if (db_) sqlite3_close(db_);
+}
+
 bool SQLiteDB::open(const std::string& filename)
 {
     if (sqlite3_open(filename.c_str(), &db_) != SQLITE_OK)
@@ -9,15 +101,65 @@ bool SQLiteDB::open(const std::string& filename)
         std::cerr << "Cannot open DB: " << sqlite3_errmsg(db_) << "\n";
         return false;
     }
+    filename_ = filename;
+    sqlite3_busy_timeout(db_, 5000);
+
+    // Incremental auto-vacuum lets RetentionManager shrink the file in small
+    // steps (it only takes effect on a new file, so it goes first).
+    // WAL lets the read-only connection query while the writer commits;
+    // NORMAL sync is durable across app crashes and only fsyncs at checkpoints.
+    return exec(db_, "PRAGMA auto_vacuum=INCREMENTAL; PRAGMA journal_mode=WAL; PRAGMA synchronous=NORMAL;",
+        "Cannot enable WAL");
+}
+
+bool SQLiteDB::openReadOnly(const std::string& filename)
+{
+    if (sqlite3_open_v2(filename.c_str(), &rdb_, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK)
+    {
+        std::cerr << "Cannot open DB: " << sqlite3_errmsg(rdb_) << "\n";
+        sqlite3_close(rdb_);
+        rdb_ = nullptr;
+        return false;
+    }
+    filename_ = filename;
+    sqlite3_busy_timeout(rdb_, 5000);
+
+    const int version = queryInt(rdb_, "PRAGMA user_version;", 0);
+    if (version != kSchemaVersion)
+    {
+        std::cerr << "DB schema version " << version << " is not " << kSchemaVersion
+            << " (open it once with motion_detector to migrate)\n";
+        return false;
+    }
     return true;
 }
 
 bool SQLiteDB::initSchema()
 {
+    const int version = queryInt(db_, "PRAGMA user_version;", 0);
+    if (version > kSchemaVersion)
+    {
+        std::cerr << "DB schema version " << version
+            << " is newer than supported (" << kSchemaVersion << ")\n";
+        return false;
+    }
+    if (version < 1 && !migrateTextTimestamps())
+    {
+        return false;
+    }
+    // version 3 puts id right after the timestamp in the measurement indexes,
+    // so cursor reads in (timestamp, id) order never need a sort
+    if (version < 3 && !exec(db_, "DROP INDEX IF EXISTS measurements_ts; DROP INDEX IF EXISTS measurements_link_ts;",
+            "Cannot drop old indexes"))
+    {
+        return false;
+    }
+    // version 4 adds the episodes table, nothing to migrate
+
     const char* sql = R"sql(
         CREATE TABLE IF NOT EXISTS measurements (
           id        INTEGER PRIMARY KEY AUTOINCREMENT,
-          timestamp TEXT    NOT NULL,
+          timestamp INTEGER NOT NULL,   -- microseconds since the Unix epoch (UTC)
           source    TEXT    NOT NULL,
           ssid      TEXT    NOT NULL,
           rssi      REAL    NOT NULL
@@ -25,11 +167,58 @@ bool SQLiteDB::initSchema()
         CREATE TABLE IF NOT EXISTS motions (
           id        INTEGER PRIMARY KEY AUTOINCREMENT,
           note      TEXT    NOT NULL,
-          timestamp TEXT    NOT NULL,
+          timestamp INTEGER NOT NULL,   -- microseconds since the Unix epoch (UTC)
           source    TEXT    NOT NULL,
-          ssid    TEXT    NOT NULL,
+          ssid      TEXT    NOT NULL,
           rssi      REAL    NOT NULL
         );
+        -- covering indexes: range reads never touch the table b-tree; all four
+        -- are ordered by (timestamp, id) within their leading columns
+        CREATE INDEX IF NOT EXISTS measurements_ts
+          ON measurements(timestamp, id, source, ssid, rssi);
+        CREATE INDEX IF NOT EXISTS measurements_link_ts
+          ON measurements(source, ssid, timestamp, id, rssi);
+        CREATE INDEX IF NOT EXISTS motions_ts
+          ON motions(timestamp);
+        CREATE INDEX IF NOT EXISTS motions_link_ts
+          ON motions(source, ssid, timestamp);
+        -- one row per movement episode of a link (EpisodeTracker)
+        CREATE TABLE IF NOT EXISTS episodes (
+          id             INTEGER PRIMARY KEY AUTOINCREMENT,
+          started        INTEGER NOT NULL,   -- sample that crossed the threshold, microseconds since the epoch
+          ended          INTEGER NOT NULL,   -- last sample past the exit level
+          source         TEXT    NOT NULL,
+          ssid           TEXT    NOT NULL,
+          peak_deviation REAL    NOT NULL,   -- RSSI minus baseline at the largest |deviation|, dB
+          peak_rssi      REAL    NOT NULL,
+          samples        INTEGER NOT NULL
+        );
+        CREATE INDEX IF NOT EXISTS episodes_started
+          ON episodes(started);
+        -- per-minute / per-hour RSSI aggregates of each link, kept up to date
+        -- by the writer (m2: sum of squared deviations from the mean)
+        CREATE TABLE IF NOT EXISTS rollup_1m (
+          bucket    INTEGER NOT NULL,   -- start of the minute, microseconds since the epoch
+          source    TEXT    NOT NULL,
+          ssid      TEXT    NOT NULL,
+          n         INTEGER NOT NULL,
+          rssi_min  REAL    NOT NULL,
+          rssi_max  REAL    NOT NULL,
+          rssi_mean REAL    NOT NULL,
+          rssi_m2   REAL    NOT NULL,
+          PRIMARY KEY (bucket, source, ssid)
+        ) WITHOUT ROWID;
+        CREATE TABLE IF NOT EXISTS rollup_1h (
+          bucket    INTEGER NOT NULL,   -- start of the hour
+          source    TEXT    NOT NULL,
+          ssid      TEXT    NOT NULL,
+          n         INTEGER NOT NULL,
+          rssi_min  REAL    NOT NULL,
+          rssi_max  REAL    NOT NULL,
+          rssi_mean REAL    NOT NULL,
+          rssi_m2   REAL    NOT NULL,
+          PRIMARY KEY (bucket, source, ssid)
+        ) WITHOUT ROWID;
     )sql";
 
     char* err = nullptr;
@@ -40,36 +229,385 @@ bool SQLiteDB::initSchema()
         sqlite3_free(err);
         return false;
     }
+    if (version < 2 && !backfillRollups())
+    {
+        return false;
+    }
+    const std::string setVersion = "PRAGMA user_version = " + std::to_string(kSchemaVersion) + ";";
+    if (!exec(db_, setVersion.c_str(), "Cannot set schema version"))
+    {
+        return false;
+    }
+
+    // Separate read-only connection: range queries run on their own WAL
+    // snapshot and never wait for (or hold up) the writer thread.
+    if (!rdb_)
+    {
+        if (sqlite3_open_v2(filename_.c_str(), &rdb_, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK)
+        {
+            std::cerr << "Cannot open read-only DB: " << sqlite3_errmsg(rdb_) << "\n";
+            sqlite3_close(rdb_);
+            rdb_ = nullptr;
+            return false;
+        }
+        sqlite3_busy_timeout(rdb_, 5000);
+    }
+    return prepareStatements();
+}
+
+bool SQLiteDB::migrateTextTimestamps()
+{
+    // Nothing to migrate on a fresh file, or if the tables already hold integers.
+    const int legacy = queryInt(db_,
+        "SELECT COUNT(*) FROM pragma_table_info('measurements') "
+        "WHERE name = 'timestamp' AND type = 'TEXT';", 0);
+    if (!legacy)
+    {
+        return true;
+    }
+
+    std::cout << "Migrating motion_detector.db to integer timestamps..." << std::endl;
+
+    // Rebuild both tables inside one transaction; ids are preserved and
+    // unparsable timestamps end up as 0 rather than aborting the upgrade.
+    const char* sql = R"sql(
+        BEGIN IMMEDIATE;
+        ALTER TABLE measurements RENAME TO measurements_v0;
+        ALTER TABLE motions      RENAME TO motions_v0;
+        CREATE TABLE measurements (
+          id        INTEGER PRIMARY KEY AUTOINCREMENT,
+          timestamp INTEGER NOT NULL,
+          source    TEXT    NOT NULL,
+          ssid      TEXT    NOT NULL,
+          rssi      REAL    NOT NULL
+        );
+        CREATE TABLE motions (
+          id        INTEGER PRIMARY KEY AUTOINCREMENT,
+          note      TEXT    NOT NULL,
+          timestamp INTEGER NOT NULL,
+          source    TEXT    NOT NULL,
+          ssid      TEXT    NOT NULL,
+          rssi      REAL    NOT NULL
+        );
+        INSERT INTO measurements(id, timestamp, source, ssid, rssi)
+          SELECT id, COALESCE(CAST(strftime('%s', timestamp, 'utc') AS INTEGER), 0) * 1000000,
+                 source, ssid, rssi
+          FROM measurements_v0;
+        INSERT INTO motions(id, note, timestamp, source, ssid, rssi)
+          SELECT id, note, COALESCE(CAST(strftime('%s', timestamp, 'utc') AS INTEGER), 0) * 1000000,
+                 source, ssid, rssi
+          FROM motions_v0;
+        DROP TABLE measurements_v0;
+        DROP TABLE motions_v0;
+        COMMIT;
+    )sql";
+    if (!exec(db_, sql, "Timestamp migration failed"))
+    {
+        exec(db_, "ROLLBACK;", "Rollback failed");
+        return false;
+    }
     return true;
 }
 
-bool SQLiteDB::insertMeasurement(const std::string& timestamp,
-    const std::string& source,
-    const std::string& ssid,
-    double              rssi)
+bool SQLiteDB::backfillRollups()
 {
-    const char* sql =
+    if (!queryInt(db_, "SELECT EXISTS (SELECT 1 FROM measurements);", 0))
+    {
+        return true;
+    }
+    std::cout << "Building the rollup tables from the existing measurements..." << std::endl;
+
+    // one pass per table; m2 from the sums is less exact than the writer's
+    // running update, but this only runs once
+    const char* sql = R"sql(
+        BEGIN IMMEDIATE;
+        DELETE FROM rollup_1m;
+        DELETE FROM rollup_1h;
+        INSERT INTO rollup_1m(bucket, source, ssid, n, rssi_min, rssi_max, rssi_mean, rssi_m2)
+          SELECT timestamp / 60000000 * 60000000 AS b, source, ssid, COUNT(*), MIN(rssi), MAX(rssi),
+                 AVG(rssi), MAX(0.0, SUM(rssi * rssi) - SUM(rssi) * SUM(rssi) / COUNT(*))
+          FROM measurements GROUP BY b, source, ssid;
+        INSERT INTO rollup_1h(bucket, source, ssid, n, rssi_min, rssi_max, rssi_mean, rssi_m2)
+          SELECT timestamp / 3600000000 * 3600000000 AS b, source, ssid, COUNT(*), MIN(rssi), MAX(rssi),
+                 AVG(rssi), MAX(0.0, SUM(rssi * rssi) - SUM(rssi) * SUM(rssi) / COUNT(*))
+          FROM measurements GROUP BY b, source, ssid;
+        COMMIT;
+    )sql";
+    if (!exec(db_, sql, "Rollup backfill failed"))
+    {
+        exec(db_, "ROLLBACK;", "Rollback failed");
+        return false;
+    }
+    return true;
+}
+
+bool SQLiteDB::prepareStatements()
+{
+    finalizeStatements();
+
+    const char* signalSql =
         "INSERT INTO measurements(timestamp, source, ssid, rssi) "
         "VALUES (?, ?, ?, ?);";
-    sqlite3_stmt* stmt = nullptr;
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK)
+    if (sqlite3_prepare_v2(db_, signalSql, -1, &insertSignalStmt_, nullptr) != SQLITE_OK)
     {
         std::cerr << "Prepare failed: " << sqlite3_errmsg(db_) << "\n";
         return false;
     }
-    sqlite3_bind_text(stmt, 1, timestamp.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, source.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 3, ssid.c_str(), -1, SQLITE_TRANSIENT);
+
+    const char* motionSql =
+        "INSERT INTO motions(note, timestamp, source, ssid, rssi) "
+        "VALUES (?, ?, ?, ?, ?);";
+    if (sqlite3_prepare_v2(db_, motionSql, -1, &insertMotionStmt_, nullptr) != SQLITE_OK)
+    {
+        std::cerr << "Prepare motion failed: " << sqlite3_errmsg(db_) << "\n";
+        return false;
+    }
+
+    const char* episodeSql =
+        "INSERT INTO episodes(started, ended, source, ssid, peak_deviation, peak_rssi, samples) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?);";
+    if (sqlite3_prepare_v2(db_, episodeSql, -1, &insertEpisodeStmt_, nullptr) != SQLITE_OK)
+    {
+        std::cerr << "Prepare episode failed: " << sqlite3_errmsg(db_) << "\n";
+        return false;
+    }
+
+    // merge an aggregate into a bucket: all SET expressions see the old row
+    for (int r = 0; r < 2; ++r)
+    {
+        const std::string rollupSql = std::string("INSERT INTO ") + kRollupTable[r] +
+            "(bucket, source, ssid, n, rssi_min, rssi_max, rssi_mean, rssi_m2) "
+            "VALUES (?, ?, ?, ?, ?, ?, ?, ?) "
+            "ON CONFLICT(bucket, source, ssid) DO UPDATE SET "
+            "  n = n + excluded.n, "
+            "  rssi_min = MIN(rssi_min, excluded.rssi_min), "
+            "  rssi_max = MAX(rssi_max, excluded.rssi_max), "
+            "  rssi_mean = rssi_mean + (excluded.rssi_mean - rssi_mean) * excluded.n / (n + excluded.n), "
+            "  rssi_m2 = rssi_m2 + excluded.rssi_m2 + (excluded.rssi_mean - rssi_mean) * (excluded.rssi_mean - rssi_mean)"
+            "            * n * excluded.n / (n + excluded.n);";
+        if (sqlite3_prepare_v2(db_, rollupSql.c_str(), -1, &upsertRollupStmt_[r], nullptr) != SQLITE_OK)
+        {
+            std::cerr << "Prepare rollup failed: " << sqlite3_errmsg(db_) << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+void SQLiteDB::finalizeStatements()
+{
+    sqlite3_finalize(insertSignalStmt_);
+    sqlite3_finalize(insertMotionStmt_);
+    sqlite3_finalize(insertEpisodeStmt_);
+    insertSignalStmt_ = nullptr;
+    insertMotionStmt_ = nullptr;
+    insertEpisodeStmt_ = nullptr;
+    for (sqlite3_stmt*& stmt : upsertRollupStmt_)
+    {
+        sqlite3_finalize(stmt);
+        stmt = nullptr;
+    }
+}
+
+bool SQLiteDB::stepSignal(std::int64_t tsUs,
+    std::string_view source,
+    std::string_view ssid,
+    double rssi)
+{
+    MOTION_TIME_STAGE(Stage::DbInsert);
+    sqlite3_stmt* stmt = insertSignalStmt_;
+    if (!stmt)
+    {
+        std::cerr << "Insert failed: schema not initialized\n";
+        return false;
+    }
+    // the strings outlive the step, so SQLite does not need its own copy
+    sqlite3_bind_int64(stmt, 1, tsUs);
+    sqlite3_bind_text(stmt, 2, source.data(), static_cast<int>(source.size()), SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, ssid.data(), static_cast<int>(ssid.size()), SQLITE_STATIC);
     sqlite3_bind_double(stmt, 4, rssi);
 
-    if (sqlite3_step(stmt) != SQLITE_DONE)
+    bool ok = sqlite3_step(stmt) == SQLITE_DONE;
+    if (!ok)
     {
         std::cerr << "Insert failed: " << sqlite3_errmsg(db_) << "\n";
-        sqlite3_finalize(stmt);
+    }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    return ok;
+}
+
+bool SQLiteDB::stepMotion(std::string_view note,
+    std::int64_t tsUs,
+    std::string_view source,
+    std::string_view ssid,
+    double rssi)
+{
+    MOTION_TIME_STAGE(Stage::DbInsert);
+    sqlite3_stmt* stmt = insertMotionStmt_;
+    if (!stmt)
+    {
+        std::cerr << "Motion insert failed: schema not initialized\n";
         return false;
     }
-    sqlite3_finalize(stmt);
-    return true;
+    sqlite3_bind_text(stmt, 1, note.data(), static_cast<int>(note.size()), SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 2, tsUs);
+    sqlite3_bind_text(stmt, 3, source.data(), static_cast<int>(source.size()), SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 4, ssid.data(), static_cast<int>(ssid.size()), SQLITE_STATIC);
+    sqlite3_bind_double(stmt, 5, rssi);
+
+    bool ok = sqlite3_step(stmt) == SQLITE_DONE;
+    if (!ok)
+    {
+        std::cerr << "Motion insert failed: " << sqlite3_errmsg(db_) << "\n";
+    }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    return ok;
+}
+
+bool SQLiteDB::stepEpisode(const Episode& e)
+{
+    sqlite3_stmt* stmt = insertEpisodeStmt_;
+    if (!stmt)
+    {
+        std::cerr << "Episode insert failed: schema not initialized\n";
+        return false;
+    }
+    const std::string_view source = symbols.source(e.link);
+    const std::string_view ssid = symbols.ssid(e.link);
+    sqlite3_bind_int64(stmt, 1, e.startUs);
+    sqlite3_bind_int64(stmt, 2, e.endUs);
+    sqlite3_bind_text(stmt, 3, source.data(), static_cast<int>(source.size()), SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 4, ssid.data(), static_cast<int>(ssid.size()), SQLITE_STATIC);
+    sqlite3_bind_double(stmt, 5, e.peakDeviation);
+    sqlite3_bind_double(stmt, 6, e.peakRssi);
+    sqlite3_bind_int64(stmt, 7, e.samples);
+
+    bool ok = sqlite3_step(stmt) == SQLITE_DONE;
+    if (!ok)
+    {
+        std::cerr << "Episode insert failed: " << sqlite3_errmsg(db_) << "\n";
+    }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    return ok;
+}
+
+bool SQLiteDB::stepRollup(RollupResolution res,
+    std::int64_t bucketUs,
+    std::string_view source,
+    std::string_view ssid,
+    std::uint64_t count,
+    double min,
+    double max,
+    double mean,
+    double m2)
+{
+    sqlite3_stmt* stmt = upsertRollupStmt_[static_cast<int>(res)];
+    if (!stmt)
+    {
+        std::cerr << "Rollup update failed: schema not initialized\n";
+        return false;
+    }
+    sqlite3_bind_int64(stmt, 1, bucketUs);
+    sqlite3_bind_text(stmt, 2, source.data(), static_cast<int>(source.size()), SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, ssid.data(), static_cast<int>(ssid.size()), SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 4, static_cast<sqlite3_int64>(count));
+    sqlite3_bind_double(stmt, 5, min);
+    sqlite3_bind_double(stmt, 6, max);
+    sqlite3_bind_double(stmt, 7, mean);
+    sqlite3_bind_double(stmt, 8, m2);
+
+    bool ok = sqlite3_step(stmt) == SQLITE_DONE;
+    if (!ok)
+    {
+        std::cerr << "Rollup update failed: " << sqlite3_errmsg(db_) << "\n";
+    }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    return ok;
+}
+
+bool SQLiteDB::writeRollups()
+{
+    // sorted by link and time, every minute and hour bucket is one run of rows,
+    // so each is upserted once per batch however many samples it got
+    std::sort(rollupRows_.begin(), rollupRows_.end(), [](const Sample& a, const Sample& b)
+    {
+        return a.link != b.link ? a.link < b.link : a.tsUs < b.tsUs;
+    });
+
+    bool ok = true;
+    auto step = [&](RollupResolution res, const RollupAcc& acc)
+    {
+        ok = stepRollup(res, acc.bucketUs, symbols.source(acc.link), symbols.ssid(acc.link),
+            acc.count, acc.min, acc.max, acc.mean, acc.m2) && ok;
+    };
+    RollupAcc minute, hour;
+    auto closeMinute = [&]()
+    {
+        step(RollupResolution::Minute, minute);
+        const std::int64_t hourUs = floorUs(minute.bucketUs, kHourUs);
+        if (hour.count && (hour.link != minute.link || hour.bucketUs != hourUs))
+        {
+            step(RollupResolution::Hour, hour);
+            hour.count = 0;
+        }
+        if (hour.count)
+        {
+            hour.merge(minute);
+        }
+        else
+        {
+            hour = minute;
+            hour.bucketUs = hourUs;
+        }
+    };
+    for (const Sample& s : rollupRows_)
+    {
+        const std::int64_t minuteUs = floorUs(s.tsUs, kMinuteUs);
+        if (minute.count && (minute.link != s.link || minute.bucketUs != minuteUs))
+        {
+            closeMinute();
+            minute.count = 0;
+        }
+        if (minute.count)
+        {
+            minute.add(s.rssi);
+        }
+        else
+        {
+            minute.start(s.link, minuteUs, s.rssi);
+        }
+    }
+    if (minute.count)
+    {
+        closeMinute();
+        step(RollupResolution::Hour, hour);
+    }
+    rollupRows_.clear();
+    return ok;
+}
+
+bool SQLiteDB::insertMeasurement(const std::string& timestamp,
+    const std::string& source,
+    const std::string& ssid,
+    double              rssi)
+{
+    std::int64_t tsUs = 0;
+    {
+        std::lock_guard<std::mutex> lk(readMu_);
+        if (!rdb_ || !toEpochUs(timestamp, tsUs))
+        {
+            std::cerr << "Insert failed: bad timestamp " << timestamp << "\n";
+            return false;
+        }
+    }
+    std::lock_guard<std::mutex> lk(dbMu_);
+    return stepSignal(tsUs, source, ssid, rssi)
+        && stepRollup(RollupResolution::Minute, floorUs(tsUs, kMinuteUs), source, ssid, 1, rssi, rssi, rssi, 0.0)
+        && stepRollup(RollupResolution::Hour, floorUs(tsUs, kHourUs), source, ssid, 1, rssi, rssi, rssi, 0.0);
 }
 
 bool SQLiteDB::saveMotion(const std::string& note,
@@ -78,52 +616,357 @@ bool SQLiteDB::saveMotion(const std::string& note,
     const std::string& ssid,
     double rssi)
 {
-    const char* sql =
-        "INSERT INTO motions(note, timestamp, source, ssid, rssi) "
-        "VALUES (?, ?, ?, ?, ?);";
+    std::int64_t tsUs = 0;
+    {
+        std::lock_guard<std::mutex> lk(readMu_);
+        if (!rdb_ || !toEpochUs(timestamp, tsUs))
+        {
+            std::cerr << "Motion insert failed: bad timestamp " << timestamp << "\n";
+            return false;
+        }
+    }
+    std::lock_guard<std::mutex> lk(dbMu_);
+    return stepMotion(note, tsUs, source, ssid, rssi);
+}
 
-    sqlite3_stmt* stmt = nullptr;
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK)
+// ---------------------------------------------------------------------------
+// Writer thread
+// ---------------------------------------------------------------------------
+
+bool SQLiteDB::startWriter(std::size_t maxBatchRows,
+    std::chrono::milliseconds maxBatchDelay,
+    std::size_t maxQueuedRows)
+{
+    std::lock_guard<std::mutex> lk(queueMu_);
+    if (writer_.joinable())
     {
-        std::cerr << "Prepare motion failed: " << sqlite3_errmsg(db_) << "\n";
+        return true;
+    }
+    if (!insertSignalStmt_ || !insertMotionStmt_ || !insertEpisodeStmt_)
+    {
+        std::cerr << "Cannot start DB writer: schema not initialized\n";
         return false;
     }
+    maxBatchRows_ = maxBatchRows ? maxBatchRows : 1;
+    maxBatchDelay_ = maxBatchDelay;
+    maxQueuedRows_ = maxQueuedRows;
+    queue_.reserve(maxBatchRows_);
+    stopping_ = false;
+    writer_ = std::thread(&SQLiteDB::writerLoop, this);
+    return true;
+}
 
-    sqlite3_bind_text(stmt, 1, note.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, timestamp.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 3, source.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 4, ssid.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_double(stmt, 5, rssi);
+void SQLiteDB::flush()
+{
+    std::unique_lock<std::mutex> lk(queueMu_);
+    if (!writer_.joinable())
+    {
+        return;
+    }
+    const std::uint64_t target = enqueued_;
+    flushRequested_ = true;
+    queueCv_.notify_one();
+    drainedCv_.wait(lk, [&] { return written_ >= target; });
+}
 
-    if (sqlite3_step(stmt) != SQLITE_DONE)
+void SQLiteDB::stopWriter()
+{
     {
-        std::cerr << "Motion insert failed: " << sqlite3_errmsg(db_) << "\n";
-        sqlite3_finalize(stmt);
-        return false;
+        std::lock_guard<std::mutex> lk(queueMu_);
+        if (!writer_.joinable())
+        {
+            return;
+        }
+        stopping_ = true;
     }
+    queueCv_.notify_one();
+    // the writer drains whatever is still queued before it exits
+    writer_.join();
+}
 
-    sqlite3_finalize(stmt);
-    return true;
+void SQLiteDB::enqueueSignal(const Sample& s)
+{
+    enqueue(PendingRow{ s, nullptr });
+}
+
+void SQLiteDB::enqueueSignals(const Sample* s, std::size_t n)
+{
+    std::unique_lock<std::mutex> lk(queueMu_);
+    if (!writer_.joinable() || stopping_)
+    {
+        lk.unlock();
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            enqueue(PendingRow{ s[i], nullptr });
+        }
+        return;
+    }
+    const bool wasEmpty = queue_.empty() && episodeQueue_.empty();
+    if (wasEmpty)
+    {
+        oldestQueued_ = std::chrono::steady_clock::now();
+    }
+    const std::size_t room = maxQueuedRows_ > queue_.size() ? maxQueuedRows_ - queue_.size() : 0;
+    const std::size_t accepted = std::min(n, room);
+    for (std::size_t i = 0; i < accepted; ++i)
+    {
+        queue_.push_back(PendingRow{ s[i], nullptr });
+    }
+    enqueued_ += accepted;
+    if (accepted < n)
+    {
+        droppedRows_.fetch_add(n - accepted, std::memory_order_relaxed);
+    }
+    if (accepted && (wasEmpty || queue_.size() >= maxBatchRows_))
+    {
+        queueCv_.notify_one();
+    }
+}
+
+void SQLiteDB::enqueueMotion(const char* note, const Sample& s)
+{
+    enqueue(PendingRow{ s, note });
+}
+
+void SQLiteDB::enqueueEpisode(const Episode& e)
+{
+    std::unique_lock<std::mutex> lk(queueMu_);
+    if (!writer_.joinable() || stopping_)
+    {
+        lk.unlock();
+        std::lock_guard<std::mutex> dbLock(dbMu_);
+        if (!stepEpisode(e))
+        {
+            failedRows_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return;
+    }
+    if (queue_.size() + episodeQueue_.size() >= maxQueuedRows_)
+    {
+        droppedRows_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    const bool wasEmpty = queue_.empty() && episodeQueue_.empty();
+    if (wasEmpty)
+    {
+        oldestQueued_ = std::chrono::steady_clock::now();
+    }
+    episodeQueue_.push_back(e);
+    ++enqueued_;
+    if (wasEmpty)
+    {
+        // the writer sleeps until the first row arrives, then waits out maxBatchDelay
+        queueCv_.notify_one();
+    }
 }
 
+bool SQLiteDB::writeRow(const PendingRow& row)
+{
+    const Sample& s = row.sample;
+    return row.note
+        ? stepMotion(row.note, s.tsUs, symbols.source(s.link), symbols.ssid(s.link), s.rssi)
+        : stepSignal(s.tsUs, symbols.source(s.link), symbols.ssid(s.link), s.rssi);
+}
+
+void SQLiteDB::enqueue(const PendingRow& row)
+{
+    std::unique_lock<std::mutex> lk(queueMu_);
+    if (!writer_.joinable() || stopping_)
+    {
+        // no writer running: fall back to a synchronous insert
+        lk.unlock();
+        std::lock_guard<std::mutex> dbLock(dbMu_);
+        if (!writeRow(row))
+        {
+            failedRows_.fetch_add(1, std::memory_order_relaxed);
+        }
+        else if (!row.note)
+        {
+            rollupRows_.push_back(row.sample);
+            writeRollups();
+        }
+        return;
+    }
+    if (queue_.size() >= maxQueuedRows_)
+    {
+        droppedRows_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    const bool wasEmpty = queue_.empty() && episodeQueue_.empty();
+    if (wasEmpty)
+    {
+        oldestQueued_ = std::chrono::steady_clock::now();
+    }
+    queue_.push_back(row);
+    ++enqueued_;
+    if (wasEmpty || queue_.size() >= maxBatchRows_)
+    {
+        // wake the writer on the first row (to start the maxBatchDelay clock) and on a full batch
+        queueCv_.notify_one();
+    }
+}
+
+void SQLiteDB::writerLoop()
+{
+    std::vector<PendingRow> batch;
+    batch.reserve(maxBatchRows_);
+    std::vector<Episode> episodes;
+
+    std::unique_lock<std::mutex> lk(queueMu_);
+    for (;;)
+    {
+        queueCv_.wait(lk, [&] { return stopping_ || !queue_.empty() || !episodeQueue_.empty(); });
+        if (queue_.empty() && episodeQueue_.empty())
+        {
+            break; // stopping and nothing left to write
+        }
+
+        // Give the batch time to fill up, unless it is already full,
+        // somebody is waiting in flush() or we are shutting down.
+        queueCv_.wait_until(lk, oldestQueued_ + maxBatchDelay_, [&] {
+            return stopping_ || flushRequested_ || queue_.size() >= maxBatchRows_;
+        });
+
+        batch.swap(queue_);
+        episodes.swap(episodeQueue_);
+        flushRequested_ = false;
+        lk.unlock();
+
+        writeBatch(batch, episodes);
+        const std::size_t n = batch.size() + episodes.size();
+        batch.clear();
+        episodes.clear();
+
+        lk.lock();
+        written_ += n;
+        drainedCv_.notify_all();
+    }
+}
+
+void SQLiteDB::writeBatch(std::vector<PendingRow>& batch, const std::vector<Episode>& episodes)
+{
+    std::lock_guard<std::mutex> lk(dbMu_);
+    const auto start = std::chrono::steady_clock::now();
+
+    char* err = nullptr;
+    if (sqlite3_exec(db_, "BEGIN IMMEDIATE;", nullptr, nullptr, &err) != SQLITE_OK)
+    {
+        std::cerr << "DB writer BEGIN failed: " << (err ? err : "?") << "\n";
+        sqlite3_free(err);
+        failedRows_.fetch_add(batch.size() + episodes.size(), std::memory_order_relaxed);
+        return;
+    }
+
+    for (const auto& row : batch)
+    {
+        if (!writeRow(row))
+        {
+            failedRows_.fetch_add(1, std::memory_order_relaxed);
+            std::cerr << (row.note ? "DB insert error (saveMotion): "
+                                   : "DB insert error (saveSignal): ")
+                << formatTimestamp(row.sample.tsUs) << ", "
+                << symbols.source(row.sample.link) << ", "
+                << symbols.ssid(row.sample.link) << ", RSSI=" << row.sample.rssi << "\n";
+        }
+        else if (!row.note)
+        {
+            rollupRows_.push_back(row.sample);
+        }
+    }
+    // the raw rows are kept even if a rollup update fails (it has printed why)
+    writeRollups();
+    for (const Episode& e : episodes)
+    {
+        if (!stepEpisode(e))
+        {
+            failedRows_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    bool committed = false;
+    {
+        MOTION_TIME_STAGE(Stage::DbCommit);
+        committed = sqlite3_exec(db_, "COMMIT;", nullptr, nullptr, &err) == SQLITE_OK;
+    }
+    if (!committed)
+    {
+        std::cerr << "DB writer COMMIT failed: " << (err ? err : "?") << "\n";
+        sqlite3_free(err);
+        sqlite3_exec(db_, "ROLLBACK;", nullptr, nullptr, nullptr);
+        failedRows_.fetch_add(batch.size() + episodes.size(), std::memory_order_relaxed);
+        return;
+    }
+    batchLatency_.record(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count()));
+}
+
+std::size_t SQLiteDB::queuedRows()
+{
+    std::lock_guard<std::mutex> lk(queueMu_);
+    return queue_.size();
+}
+
+std::uint64_t SQLiteDB::writtenRows()
+{
+    std::lock_guard<std::mutex> lk(queueMu_);
+    return written_;
+}
+
+
+bool SQLiteDB::toEpochUs(const std::string& text, std::int64_t& us)
+{
+    const char* sql = "SELECT " LOCAL_TEXT_TO_US(1) ";";
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(rdb_, sql, -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, text.c_str(), -1, SQLITE_STATIC);
+    bool ok = sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_type(stmt, 0) != SQLITE_NULL;
+    if (ok)
+    {
+        us = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return ok;
+}
 
 bool SQLiteDB::readSignal(const std::string& from,
     const std::string& to,
     std::vector<Measurement>& out)
+{
+    std::int64_t fromUs = 0, toUs = 0;
+    {
+        std::lock_guard<std::mutex> lk(readMu_);
+        if (!rdb_ || !toEpochUs(from, fromUs) || !toEpochUs(to, toUs))
+        {
+            std::cerr << "readSignal: bad time range " << from << " .. " << to << "\n";
+            return false;
+        }
+    }
+    // "to" names a whole second, include all of it
+    return readSignal(fromUs, toUs + 999999, out);
+}
+
+bool SQLiteDB::readSignal(std::int64_t fromUs,
+    std::int64_t toUs,
+    std::vector<Measurement>& out)
 {
     const char* sql =
-        "SELECT timestamp, source, ssid, rssi "
+        "SELECT strftime('%Y-%m-%d %H:%M:%S', timestamp / 1000000, 'unixepoch', 'localtime'), "
+        "       source, ssid, rssi "
         "FROM measurements "
         "WHERE timestamp BETWEEN ? AND ? "
         "ORDER BY timestamp;";
+    std::lock_guard<std::mutex> lk(readMu_);
     sqlite3_stmt* stmt = nullptr;
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK)
+    if (!rdb_ || sqlite3_prepare_v2(rdb_, sql, -1, &stmt, nullptr) != SQLITE_OK)
     {
-        std::cerr << "Prepare readSignal: " << sqlite3_errmsg(db_) << "\n";
+        std::cerr << "Prepare readSignal: " << (rdb_ ? sqlite3_errmsg(rdb_) : "DB not open") << "\n";
         return false;
     }
-    sqlite3_bind_text(stmt, 1, from.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, to.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 1, fromUs);
+    sqlite3_bind_int64(stmt, 2, toUs);
 
     while (sqlite3_step(stmt) == SQLITE_ROW)
     {
@@ -138,23 +981,352 @@ bool SQLiteDB::readSignal(const std::string& from,
     return true;
 }
 
+bool SQLiteDB::forEachSignal(std::int64_t fromUs, std::int64_t toUs, const SignalFn& fn)
+{
+    // served by the covering index measurements_ts
+    const char* sql =
+        "SELECT timestamp, source, ssid, rssi FROM measurements "
+        "WHERE timestamp >= ? AND timestamp < ? "
+        "ORDER BY timestamp;";
+    std::lock_guard<std::mutex> lk(readMu_);
+    sqlite3_stmt* stmt = nullptr;
+    if (!rdb_ || sqlite3_prepare_v2(rdb_, sql, -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        std::cerr << "Prepare forEachSignal: " << (rdb_ ? sqlite3_errmsg(rdb_) : "DB not open") << "\n";
+        return false;
+    }
+    sqlite3_bind_int64(stmt, 1, fromUs);
+    sqlite3_bind_int64(stmt, 2, toUs);
+
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        fn(sqlite3_column_int64(stmt, 0),
+            std::string_view(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1)),
+                static_cast<std::size_t>(sqlite3_column_bytes(stmt, 1))),
+            std::string_view(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2)),
+                static_cast<std::size_t>(sqlite3_column_bytes(stmt, 2))),
+            sqlite3_column_double(stmt, 3));
+    }
+    if (rc != SQLITE_DONE)
+    {
+        std::cerr << "forEachSignal: " << sqlite3_errmsg(rdb_) << "\n";
+    }
+    sqlite3_finalize(stmt);
+    return rc == SQLITE_DONE;
+}
+
+std::int64_t SQLiteDB::rollupWidthUs(RollupResolution res)
+{
+    return res == RollupResolution::Minute ? kMinuteUs : kHourUs;
+}
+
+RollupResolution SQLiteDB::chooseRollup(std::int64_t fromUs, std::int64_t toUs, std::size_t maxPoints)
+{
+    const std::int64_t span = toUs > fromUs ? toUs - fromUs : 0;
+    // buckets touched by the range, counting partial ones at both ends
+    const std::int64_t minutes = span / kMinuteUs + 2;
+    return minutes <= static_cast<std::int64_t>(maxPoints) ? RollupResolution::Minute : RollupResolution::Hour;
+}
+
+bool SQLiteDB::forEachRollup(RollupResolution res, std::int64_t fromUs, std::int64_t toUs, const RollupFn& fn)
+{
+    // a range scan of the primary key, already in output order
+    const std::string sql = std::string(
+        "SELECT bucket, source, ssid, n, rssi_min, rssi_max, rssi_mean, rssi_m2 FROM ") +
+        kRollupTable[static_cast<int>(res)] +
+        " WHERE bucket >= ? AND bucket < ? ORDER BY bucket, source, ssid;";
+    std::lock_guard<std::mutex> lk(readMu_);
+    sqlite3_stmt* stmt = nullptr;
+    if (!rdb_ || sqlite3_prepare_v2(rdb_, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        std::cerr << "Prepare forEachRollup: " << (rdb_ ? sqlite3_errmsg(rdb_) : "DB not open") << "\n";
+        return false;
+    }
+    sqlite3_bind_int64(stmt, 1, floorUs(fromUs, rollupWidthUs(res)));
+    sqlite3_bind_int64(stmt, 2, toUs);
+
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        const std::uint64_t count = static_cast<std::uint64_t>(sqlite3_column_int64(stmt, 3));
+        const RollupRow row{ sqlite3_column_int64(stmt, 0),
+            std::string_view(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1)),
+                static_cast<std::size_t>(sqlite3_column_bytes(stmt, 1))),
+            std::string_view(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2)),
+                static_cast<std::size_t>(sqlite3_column_bytes(stmt, 2))),
+            count,
+            sqlite3_column_double(stmt, 4),
+            sqlite3_column_double(stmt, 5),
+            sqlite3_column_double(stmt, 6),
+            count ? sqlite3_column_double(stmt, 7) / double(count) : 0.0 };
+        fn(row);
+    }
+    if (rc != SQLITE_DONE)
+    {
+        std::cerr << "forEachRollup: " << sqlite3_errmsg(rdb_) << "\n";
+    }
+    sqlite3_finalize(stmt);
+    return rc == SQLITE_DONE;
+}
+
+bool SQLiteDB::forEachRollup(std::int64_t fromUs, std::int64_t toUs, std::size_t maxPoints,
+    const RollupFn& fn, RollupResolution* used)
+{
+    const RollupResolution res = chooseRollup(fromUs, toUs, maxPoints);
+    if (used)
+    {
+        *used = res;
+    }
+    return forEachRollup(res, fromUs, toUs, fn);
+}
+
+// ---------------------------------------------------------------------------
+// Retention
+// ---------------------------------------------------------------------------
+
+std::int64_t SQLiteDB::deleteOldest(RetentionTable table, std::int64_t cutoffUs, std::size_t maxRows)
+{
+    // oldest first through the time index, so each chunk is one contiguous
+    // stretch of the b-trees
+    const char* sql = table == RetentionTable::Measurements
+        ? "DELETE FROM measurements WHERE id IN "
+          "(SELECT id FROM measurements INDEXED BY measurements_ts WHERE timestamp < ? ORDER BY timestamp LIMIT ?);"
+        : "DELETE FROM rollup_1m WHERE (bucket, source, ssid) IN "
+          "(SELECT bucket, source, ssid FROM rollup_1m WHERE bucket < ? ORDER BY bucket LIMIT ?);";
+    std::lock_guard<std::mutex> lk(dbMu_);
+    sqlite3_stmt* stmt = nullptr;
+    if (!db_ || sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        std::cerr << "Prepare retention delete: " << (db_ ? sqlite3_errmsg(db_) : "DB not open") << "\n";
+        sqlite3_finalize(stmt);
+        return -1;
+    }
+    sqlite3_bind_int64(stmt, 1, cutoffUs);
+    sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(maxRows));
+    const bool ok = sqlite3_step(stmt) == SQLITE_DONE;
+    if (!ok)
+    {
+        std::cerr << "Retention delete failed: " << sqlite3_errmsg(db_) << "\n";
+    }
+    sqlite3_finalize(stmt);
+    return ok ? sqlite3_changes(db_) : -1;
+}
+
+bool SQLiteDB::incrementalVacuumEnabled()
+{
+    std::lock_guard<std::mutex> lk(dbMu_);
+    return db_ && queryInt(db_, "PRAGMA auto_vacuum;", 0) == 2;
+}
+
+std::uint64_t SQLiteDB::freeBytes()
+{
+    std::lock_guard<std::mutex> lk(dbMu_);
+    if (!db_)
+    {
+        return 0;
+    }
+    return std::uint64_t(queryInt(db_, "PRAGMA freelist_count;", 0)) * std::uint64_t(queryInt(db_, "PRAGMA page_size;", 0));
+}
+
+std::int64_t SQLiteDB::incrementalVacuum(std::size_t pages)
+{
+    std::lock_guard<std::mutex> lk(dbMu_);
+    if (!db_)
+    {
+        return -1;
+    }
+    const std::int64_t pageSize = queryInt(db_, "PRAGMA page_size;", 0);
+    const std::int64_t before = queryInt(db_, "PRAGMA freelist_count;", 0);
+    const std::string sql = "PRAGMA incremental_vacuum(" + std::to_string(pages ? pages : 1) + ");";
+    if (!exec(db_, sql.c_str(), "Incremental vacuum failed"))
+    {
+        return -1;
+    }
+    return (before - queryInt(db_, "PRAGMA freelist_count;", 0)) * pageSize;
+}
+
+// ---------------------------------------------------------------------------
+// Cursors
+// ---------------------------------------------------------------------------
+
+RangeCursor::RangeCursor(std::unique_lock<std::mutex> lock, sqlite3* db, sqlite3_stmt* stmt)
+    : lock_(std::move(lock)), db_(db), stmt_(stmt), ok_(stmt != nullptr)
+{
+}
+
+RangeCursor::RangeCursor(RangeCursor&& other) noexcept
+    : lock_(std::move(other.lock_)), db_(other.db_), stmt_(other.stmt_), last_(other.last_), ok_(other.ok_)
+{
+    other.stmt_ = nullptr;
+    other.ok_ = false;
+}
+
+RangeCursor::~RangeCursor()
+{
+    sqlite3_finalize(stmt_);
+}
+
+bool RangeCursor::step()
+{
+    if (!stmt_)
+    {
+        if (lock_.owns_lock())
+        {
+            lock_.unlock();
+        }
+        return false;
+    }
+    const int rc = sqlite3_step(stmt_);
+    if (rc == SQLITE_ROW)
+    {
+        last_ = RowKey{ sqlite3_column_int64(stmt_, 1), sqlite3_column_int64(stmt_, 0) };
+        return true;
+    }
+    if (rc != SQLITE_DONE)
+    {
+        std::cerr << "Cursor read failed: " << sqlite3_errmsg(db_) << "\n";
+        ok_ = false;
+    }
+    // done: give the statement and the read connection back right away
+    sqlite3_finalize(stmt_);
+    stmt_ = nullptr;
+    if (lock_.owns_lock())
+    {
+        lock_.unlock();
+    }
+    return false;
+}
+
+std::string_view RangeCursor::text(int col) const
+{
+    return std::string_view(reinterpret_cast<const char*>(sqlite3_column_text(stmt_, col)),
+        static_cast<std::size_t>(sqlite3_column_bytes(stmt_, col)));
+}
+
+bool SignalCursor::next(SignalRow& row)
+{
+    if (!step())
+    {
+        return false;
+    }
+    row = SignalRow{ *last_, text(2), text(3), sqlite3_column_double(stmt_, 4) };
+    return true;
+}
+
+bool MotionCursor::next(MotionRow& row)
+{
+    if (!step())
+    {
+        return false;
+    }
+    row = MotionRow{ *last_, text(2), text(3), text(4), sqlite3_column_double(stmt_, 5) };
+    return true;
+}
+
+sqlite3_stmt* SQLiteDB::prepareRange(const char* columns, const char* table,
+    const char* tsIndex, const char* linkIndex, const RangeQuery& q)
+{
+    // Pin the index whose order is (timestamp, id) for the given filters: the
+    // rows then come straight off the b-tree, never through a sorter
+    const bool link = !q.source.empty() && !q.ssid.empty();
+    std::string sql = std::string("SELECT ") + columns + " FROM " + table +
+        " INDEXED BY " + (link ? linkIndex : tsIndex) +
+        " WHERE timestamp >= ?1 AND timestamp < ?2 AND (timestamp, id) > (?3, ?4)";
+    if (!q.source.empty())
+    {
+        sql += " AND source = ?5";
+    }
+    if (!q.ssid.empty())
+    {
+        sql += " AND ssid = ?6";
+    }
+    sql += " ORDER BY timestamp, id";
+    if (q.limit)
+    {
+        sql += " LIMIT ?7";
+    }
+
+    sqlite3_stmt* stmt = nullptr;
+    if (!rdb_ || sqlite3_prepare_v2(rdb_, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        std::cerr << "Prepare cursor on " << table << ": " << (rdb_ ? sqlite3_errmsg(rdb_) : "DB not open") << "\n";
+        sqlite3_finalize(stmt);
+        return nullptr;
+    }
+    const RowKey after = q.after ? *q.after
+        : RowKey{ std::numeric_limits<std::int64_t>::min(), std::numeric_limits<std::int64_t>::min() };
+    sqlite3_bind_int64(stmt, 1, std::max(q.fromUs, after.tsUs));
+    sqlite3_bind_int64(stmt, 2, q.toUs);
+    sqlite3_bind_int64(stmt, 3, after.tsUs);
+    sqlite3_bind_int64(stmt, 4, after.id);
+    if (!q.source.empty())
+    {
+        sqlite3_bind_text(stmt, 5, q.source.data(), static_cast<int>(q.source.size()), SQLITE_TRANSIENT);
+    }
+    if (!q.ssid.empty())
+    {
+        sqlite3_bind_text(stmt, 6, q.ssid.data(), static_cast<int>(q.ssid.size()), SQLITE_TRANSIENT);
+    }
+    if (q.limit)
+    {
+        sqlite3_bind_int64(stmt, 7, static_cast<sqlite3_int64>(q.limit));
+    }
+    return stmt;
+}
+
+SignalCursor SQLiteDB::openSignals(const RangeQuery& q)
+{
+    std::unique_lock<std::mutex> lk(readMu_);
+    sqlite3_stmt* stmt = prepareRange("id, timestamp, source, ssid, rssi", "measurements",
+        "measurements_ts", "measurements_link_ts", q);
+    return SignalCursor(std::move(lk), rdb_, stmt);
+}
+
+MotionCursor SQLiteDB::openMotions(const RangeQuery& q)
+{
+    std::unique_lock<std::mutex> lk(readMu_);
+    sqlite3_stmt* stmt = prepareRange("id, timestamp, note, source, ssid, rssi", "motions",
+        "motions_ts", "motions_link_ts", q);
+    return MotionCursor(std::move(lk), rdb_, stmt);
+}
+
 bool SQLiteDB::readMotion(const std::string& from,
     const std::string& to,
     std::vector<Motion>& out)
+{
+    std::int64_t fromUs = 0, toUs = 0;
+    {
+        std::lock_guard<std::mutex> lk(readMu_);
+        if (!rdb_ || !toEpochUs(from, fromUs) || !toEpochUs(to, toUs))
+        {
+            std::cerr << "readMotion: bad time range " << from << " .. " << to << "\n";
+            return false;
+        }
+    }
+    return readMotion(fromUs, toUs + 999999, out);
+}
+
+bool SQLiteDB::readMotion(std::int64_t fromUs,
+    std::int64_t toUs,
+    std::vector<Motion>& out)
 {
     const char* sql =
-        "SELECT note, timestamp, source, rssi "
+        "SELECT note, "
+        "       strftime('%Y-%m-%d %H:%M:%S', timestamp / 1000000, 'unixepoch', 'localtime'), "
+        "       source, rssi "
         "FROM motions "
         "WHERE timestamp BETWEEN ? AND ? "
         "ORDER BY timestamp;";
+    std::lock_guard<std::mutex> lk(readMu_);
     sqlite3_stmt* stmt = nullptr;
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK)
+    if (!rdb_ || sqlite3_prepare_v2(rdb_, sql, -1, &stmt, nullptr) != SQLITE_OK)
     {
-        std::cerr << "Prepare readMotion: " << sqlite3_errmsg(db_) << "\n";
+        std::cerr << "Prepare readMotion: " << (rdb_ ? sqlite3_errmsg(rdb_) : "DB not open") << "\n";
         return false;
     }
-    sqlite3_bind_text(stmt, 1, from.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, to.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 1, fromUs);
+    sqlite3_bind_int64(stmt, 2, toUs);
 
     while (sqlite3_step(stmt) == SQLITE_ROW)
     {
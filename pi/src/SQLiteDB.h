@@ -1,11 +1,23 @@
 // src/SQLiteDB.h
 #pragma once
+#include "Histogram.h"
 #include "Measurement.h"
 #include <sqlite3.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
-// new struct for motion records
+// new struct for "motion" records
 struct Motion
 {
     std::string note;
@@ -14,20 +26,212 @@ struct Motion
     double      rssi;
 };
 
+// bucket width of the rollup_1m / rollup_1h tables
+enum class RollupResolution
+{
+    Minute,
+    Hour
+};
+
+// one rollup bucket of one link, as handed out by forEachRollup()
+struct RollupRow
+{
+    std::int64_t     bucketUs;   // bucket start, microseconds since the Unix epoch
+    std::string_view source;
+    std::string_view ssid;
+    std::uint64_t    count;
+    double           min;
+    double           max;
+    double           mean;
+    double           variance;   // population variance of the RSSI values
+};
+
+// position of a row in (timestamp, id) order, for keyset pagination
+struct RowKey
+{
+    std::int64_t tsUs;
+    std::int64_t id;
+};
+
+// filters of a cursor read; all of them are evaluated by SQLite
+struct RangeQuery
+{
+    std::int64_t           fromUs = std::numeric_limits<std::int64_t>::min();   // timestamp >= fromUs
+    std::int64_t           toUs = std::numeric_limits<std::int64_t>::max();     // timestamp < toUs
+    std::string_view       source;   // empty: any source
+    std::string_view       ssid;     // empty: any SSID
+    std::optional<RowKey>  after;    // only rows after this one (lastKey() of the previous page)
+    std::size_t            limit = 0;   // at most this many rows, 0: no limit
+};
+
+// rows handed out by the cursors: the strings are views into SQLite's column
+// memory, valid until the cursor moves on
+struct SignalRow
+{
+    RowKey           key;
+    std::string_view source;
+    std::string_view ssid;
+    double           rssi;
+};
+
+struct MotionRow
+{
+    RowKey           key;
+    std::string_view note;
+    std::string_view source;
+    std::string_view ssid;
+    double           rssi;
+};
+
+// tables the retention manager prunes by age
+enum class RetentionTable
+{
+    Measurements,   // raw rows (their minute/hour aggregates stay in the rollups)
+    Rollup1m        // minute buckets (the hour buckets stay)
+};
+
+class SQLiteDB;
+
+// One range read in (timestamp, id) order, stepped a row at a time straight off
+// an index, so memory use does not depend on the size of the range. A cursor
+// holds the read connection until it is destroyed: finish with it before the
+// same thread starts another read.
+class RangeCursor
+{
+public:
+    RangeCursor(RangeCursor&& other) noexcept;
+    RangeCursor& operator=(RangeCursor&&) = delete;
+    ~RangeCursor();
+
+    // false if the query could not be prepared or a step failed (reported on std::cerr)
+    bool ok() const { return ok_; }
+
+    // key of the last row handed out, to continue from with RangeQuery::after
+    std::optional<RowKey> lastKey() const { return last_; }
+
+protected:
+    friend class SQLiteDB;
+    RangeCursor(std::unique_lock<std::mutex> lock, sqlite3* db, sqlite3_stmt* stmt);
+
+    // step to the next row; false at the end or on error
+    bool step();
+    std::string_view text(int col) const;
+
+    std::unique_lock<std::mutex> lock_;
+    sqlite3*                     db_ = nullptr;
+    sqlite3_stmt*                stmt_ = nullptr;
+    std::optional<RowKey>        last_;
+    bool                         ok_ = false;
+};
+
+class SignalCursor : public RangeCursor
+{
+public:
+    using RangeCursor::RangeCursor;
+    friend class SQLiteDB;
+    bool next(SignalRow& row);
+};
+
+class MotionCursor : public RangeCursor
+{
+public:
+    using RangeCursor::RangeCursor;
+    friend class SQLiteDB;
+    bool next(MotionRow& row);
+};
+
 class SQLiteDB
 {
-    sqlite3* db_ = nullptr;
+    // bumped whenever initSchema() learns a new migration step
+    static constexpr int kSchemaVersion = 4;
+
+    sqlite3*    db_ = nullptr;      // read/write connection (ingest)
+    sqlite3*    rdb_ = nullptr;     // read-only connection (range queries)
+    std::string filename_;
+    std::mutex  readMu_;            // serializes use of rdb_
+
+    // statements prepared once in initSchema() and reused for every row
+    sqlite3_stmt* insertSignalStmt_ = nullptr;
+    sqlite3_stmt* insertMotionStmt_ = nullptr;
+    sqlite3_stmt* insertEpisodeStmt_ = nullptr;
+    sqlite3_stmt* upsertRollupStmt_[2] = { nullptr, nullptr };   // by RollupResolution
+
+    // serializes use of db_ and the cached statements
+    std::mutex dbMu_;
+
+    // one queued row for the writer thread; strings are looked up in the
+    // global SymbolTable only when the row is bound
+    struct PendingRow
+    {
+        Sample      sample;
+        const char* note;   // nullptr: measurements row, else motions row (static text)
+    };
+
+    // === writer thread state (guarded by queueMu_) ===
+    std::mutex              queueMu_;
+    std::condition_variable queueCv_;   // wakes the writer
+    std::condition_variable drainedCv_; // wakes flush() callers
+    std::vector<PendingRow> queue_;
+    std::vector<Episode>    episodeQueue_;   // episodes rows, committed with the same batches
+    std::chrono::steady_clock::time_point oldestQueued_;
+    std::uint64_t enqueued_ = 0;        // rows (of both queues) accepted by enqueue*()
+    std::uint64_t written_ = 0;         // rows handled by the writer (ok or failed)
+    bool          flushRequested_ = false;
+    bool          stopping_ = false;
+    std::thread   writer_;
+
+    std::size_t               maxBatchRows_ = 512;
+    std::chrono::milliseconds maxBatchDelay_{ 250 };
+    std::size_t               maxQueuedRows_ = 100000;
+
+    // measurements of the batch being written, grouped into rollup buckets at
+    // the end of the batch; writer thread only (under dbMu_)
+    std::vector<Sample> rollupRows_;
+
+    std::atomic<std::uint64_t> droppedRows_{ 0 };
+    std::atomic<std::uint64_t> failedRows_{ 0 };
+    ConcurrentHistogram        batchLatency_;   // s from BEGIN to COMMIT; writer thread only
 
 public:
-    ~SQLiteDB() { if (db_) sqlite3_close(db_); }
+    ~SQLiteDB();
 
-    // open (or create) the file
+    // open (or create) the file and switch it to WAL mode
     bool open(const std::string& filename);
 
-    // create both tables if missing
+    // open an existing database for reading only (no writer, no migration);
+    // the read* / forEach* methods work, enqueue*/save* do not
+    bool openReadOnly(const std::string& filename);
+
+    // create (or migrate) both tables and their indexes, open the read-only
+    // connection and prepare the insert statements
     bool initSchema();
 
+    // === WRITER thread ===
+    // Start the background writer. Queued rows are committed in one transaction
+    // once maxBatchRows are waiting or the oldest row is maxBatchDelay old.
+    // Rows beyond maxQueuedRows are dropped instead of blocking the caller.
+    bool startWriter(std::size_t maxBatchRows = 512,
+        std::chrono::milliseconds maxBatchDelay = std::chrono::milliseconds(250),
+        std::size_t maxQueuedRows = 100000);
+
+    // block until every row enqueued before this call has been committed
+    void flush();
+
+    // flush and join the writer; later enqueue*() calls write synchronously
+    void stopWriter();
+
+    std::uint64_t droppedRows() const { return droppedRows_.load(std::memory_order_relaxed); }
+    std::uint64_t failedRows() const { return failedRows_.load(std::memory_order_relaxed); }
+
+    // rows waiting for the writer, and rows it has handled so far (ok or failed)
+    std::size_t queuedRows();
+    std::uint64_t writtenRows();
+
+    // add the writer's per-batch write times (s, BEGIN to COMMIT) to `out`
+    void batchLatencySnapshot(Histogram& out) const { batchLatency_.snapshot(out); }
+
     // === SIGNAL methods ===
+    // synchronous insert (its own implicit transaction)
     bool saveSignal(const std::string& timestamp,
         const std::string& source,
         const std::string& ssid,
@@ -37,11 +241,85 @@ public:
         return insertMeasurement(timestamp, source, ssid, rssi);
     }
 
-    // read all measurements whose timestamp is BETWEEN fromto
+    // non-blocking insert through the writer thread
+    void enqueueSignal(const Sample& s);
+    // the same for n samples, taking the queue lock once
+    void enqueueSignals(const Sample* s, std::size_t n);
+
+    // read all measurements whose timestamp is BETWEEN from..to
+    // (local "YYYY-MM-DD HH:MM:SS" text, both ends inclusive)
     bool readSignal(const std::string& from,
         const std::string& to,
         std::vector<Measurement>& out);
 
+    // same, with bounds in microseconds since the Unix epoch
+    bool readSignal(std::int64_t fromUs,
+        std::int64_t toUs,
+        std::vector<Measurement>& out);
+
+    // stream measurements with from <= timestamp < to (microseconds) in timestamp
+    // order, without building Measurement rows; the views are valid during the call
+    using SignalFn = std::function<void(std::int64_t tsUs, std::string_view source,
+        std::string_view ssid, double rssi)>;
+    bool forEachSignal(std::int64_t fromUs, std::int64_t toUs, const SignalFn& fn);
+
+    // cursor over the measurements matching q, in (timestamp, id) order
+    SignalCursor openSignals(const RangeQuery& q);
+
+    // call fn(const SignalRow&) for each row matching q until it returns false;
+    // false if the read failed
+    template <typename Fn>
+    bool visitSignals(const RangeQuery& q, Fn&& fn)
+    {
+        SignalCursor cursor = openSignals(q);
+        SignalRow row;
+        while (cursor.next(row) && fn(static_cast<const SignalRow&>(row)))
+        {
+        }
+        return cursor.ok();
+    }
+
+    // === ROLLUP methods ===
+    // rollup_1m and rollup_1h hold count/min/max/mean/variance of the RSSI per
+    // (source, ssid) and minute or hour. Every measurements insert updates both
+    // in the same transaction, so they never need recomputing.
+
+    // bucket width in microseconds
+    static std::int64_t rollupWidthUs(RollupResolution res);
+
+    // the finest resolution that yields at most maxPoints buckets per link over
+    // fromUs..toUs, i.e. the coarsest one the budget requires (Hour if even
+    // that yields more)
+    static RollupResolution chooseRollup(std::int64_t fromUs, std::int64_t toUs, std::size_t maxPoints);
+
+    // stream the buckets overlapping fromUs <= t < toUs in (bucket, source, ssid)
+    // order; the views are valid during the call
+    using RollupFn = std::function<void(const RollupRow& row)>;
+    bool forEachRollup(RollupResolution res, std::int64_t fromUs, std::int64_t toUs, const RollupFn& fn);
+
+    // same, at chooseRollup(fromUs, toUs, maxPoints); the resolution read goes to *used
+    bool forEachRollup(std::int64_t fromUs, std::int64_t toUs, std::size_t maxPoints,
+        const RollupFn& fn, RollupResolution* used = nullptr);
+
+    // === RETENTION (RetentionManager) ===
+    // Each call is one short write transaction under the writer's lock, so the
+    // ingest writer waits at most that long.
+
+    // delete up to maxRows of the oldest rows of `table` older than cutoffUs;
+    // returns the number deleted, -1 on error
+    std::int64_t deleteOldest(RetentionTable table, std::int64_t cutoffUs, std::size_t maxRows);
+
+    // true if the file was created with auto_vacuum=INCREMENTAL (open() asks for
+    // it, but SQLite only applies it to a new, empty file)
+    bool incrementalVacuumEnabled();
+
+    // bytes held by free pages
+    std::uint64_t freeBytes();
+
+    // give up to `pages` free pages back to the file system; returns the bytes
+    // released, -1 on error
+    std::int64_t incrementalVacuum(std::size_t pages);
+
     // === MOTION methods ===
     bool saveMotion(const std::string& note,
         const std::string& timestamp,
@@ -49,14 +327,86 @@ public:
         const std::string& ssid,
         double             rssi);
 
+    // `note` must outlive the write (a string literal)
+    void enqueueMotion(const char* note, const Sample& s);
+
     bool readMotion(const std::string& from,
         const std::string& to,
         std::vector<Motion>& out);
 
+    bool readMotion(std::int64_t fromUs,
+        std::int64_t toUs,
+        std::vector<Motion>& out);
+
+    // === EPISODE methods ===
+    // one row per movement episode (EpisodeTracker), written by the writer thread
+    void enqueueEpisode(const Episode& e);
+
+    // cursor over the motions matching q, in (timestamp, id) order
+    MotionCursor openMotions(const RangeQuery& q);
+
+    template <typename Fn>
+    bool visitMotions(const RangeQuery& q, Fn&& fn)
+    {
+        MotionCursor cursor = openMotions(q);
+        MotionRow row;
+        while (cursor.next(row) && fn(static_cast<const MotionRow&>(row)))
+        {
+        }
+        return cursor.ok();
+    }
+
 private:
     // your existing implementation
     bool insertMeasurement(const std::string& timestamp,
         const std::string& source,
         const std::string& ssid,
         double              rssi);
+
+    // schema version 0 -> 1: TEXT timestamps become integer microseconds
+    bool migrateTextTimestamps();
+
+    // schema version 1 -> 2: fill the rollup tables from the existing measurements
+    bool backfillRollups();
+
+    // prepare and bind a cursor read of `table` on rdb_, nullptr on error;
+    // caller holds readMu_
+    sqlite3_stmt* prepareRange(const char* columns, const char* table,
+        const char* tsIndex, const char* linkIndex, const RangeQuery& q);
+
+    // local timestamp text -> microseconds since the epoch; caller holds readMu_
+    bool toEpochUs(const std::string& text, std::int64_t& us);
+
+    bool prepareStatements();
+    void finalizeStatements();
+
+    void enqueue(const PendingRow& row);
+    bool writeRow(const PendingRow& row);   // caller holds dbMu_
+    void writerLoop();
+    void writeBatch(std::vector<PendingRow>& batch, const std::vector<Episode>& episodes);
+
+    // bind + step one row on a cached statement; caller holds dbMu_
+    bool stepSignal(std::int64_t tsUs,
+        std::string_view source,
+        std::string_view ssid,
+        double rssi);
+    // merge one aggregate (count values with the given min/max/mean and sum of
+    // squared deviations m2) into a rollup bucket; caller holds dbMu_
+    bool stepRollup(RollupResolution res,
+        std::int64_t bucketUs,
+        std::string_view source,
+        std::string_view ssid,
+        std::uint64_t count,
+        double min,
+        double max,
+        double mean,
+        double m2);
+    // group rollupRows_ into minute and hour buckets and merge them; caller holds dbMu_
+    bool writeRollups();
+    bool stepMotion(std::string_view note,
+        std::int64_t tsUs,
+        std::string_view source,
+        std::string_view ssid,
+        double rssi);
+    bool stepEpisode(const Episode& e);
 };
@@ -0,0 +1,193 @@
+// ScanEngine.cpp
+#include "ScanEngine.h"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+ScanEngine::ScanEngine(std::string command,
+    std::chrono::milliseconds interval,
+    std::chrono::milliseconds timeout)
+    : command_(std::move(command)), interval_(interval), timeout_(timeout),
+    nextStart_(Clock::now())
+{
+}
+
+ScanEngine::~ScanEngine()
+{
+    if (pid_ > 0)
+    {
+        kill(-pid_, SIGTERM);
+        waitpid(pid_, nullptr, 0);
+    }
+    if (fd_ >= 0)
+    {
+        close(fd_);
+    }
+}
+
+bool ScanEngine::startScan()
+{
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0)
+    {
+        std::cerr << "Scan pipe failed: " << std::strerror(errno) << "\n";
+        return false;
+    }
+
+    // child: sh -c "<command>" with stdout redirected into the pipe, in a
+    // process group of its own so that a kill also reaches iw under sh/sudo
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attr, 0);
+
+    const char* argv[] = { "sh", "-c", command_.c_str(), nullptr };
+    pid_t pid = -1;
+    int rc = posix_spawn(&pid, "/bin/sh", &actions, &attr, const_cast<char**>(argv), environ);
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+    if (rc != 0)
+    {
+        std::cerr << "Cannot start scan command: " << std::strerror(rc) << "\n";
+        close(fds[0]);
+        return false;
+    }
+
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    pid_ = pid;
+    fd_ = fds[0];
+    scanStart_ = Clock::now();
+#if MOTION_INSTRUMENT
+    scanStartTicks_ = stageTicks();
+#endif
+    delivered_ = 0;
+
+    // one timestamp per scan: all BSSes of a scan are reported together
+    parser_.begin(epochMicros(), symbols.intern("pi"));
+    return true;
+}
+
+std::size_t ScanEngine::poll(std::chrono::milliseconds wait, const RecordFn& onRecord)
+{
+    auto now = Clock::now();
+    if (pid_ < 0 && now >= nextStart_ && !startScan())
+    {
+        nextStart_ = now + std::max<Clock::duration>(interval_, failed());
+    }
+
+    if (pid_ < 0)
+    {
+        // idle until the next scan is due (or `wait` runs out)
+        auto idle = std::min<Clock::duration>(wait, nextStart_ - now);
+        if (idle > Clock::duration::zero())
+        {
+            ::poll(nullptr, 0, static_cast<int>(
+                std::chrono::ceil<std::chrono::milliseconds>(idle).count()));
+        }
+        return 0;
+    }
+
+    if (now - scanStart_ > timeout_)
+    {
+        std::cerr << "Scan command timed out, killing it\n";
+        kill(-pid_, SIGKILL);
+        return finishScan(onRecord);
+    }
+
+    pollfd pfd{ fd_, POLLIN, 0 };
+    int ready = ::poll(&pfd, 1, static_cast<int>(wait.count()));
+    if (ready <= 0)
+    {
+        return 0;
+    }
+    return readAvailable(onRecord);
+}
+
+std::size_t ScanEngine::readAvailable(const RecordFn& onRecord)
+{
+    std::size_t delivered = 0;
+    char chunk[4096];
+    for (;;)
+    {
+        ssize_t n = read(fd_, chunk, sizeof(chunk));
+        if (n > 0)
+        {
+            parser_.feed(chunk, static_cast<std::size_t>(n), records_);
+            delivered += deliver(onRecord);
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            return delivered;   // drained for now, come back on the next poll()
+        }
+        // EOF (or a read error): the scan is over
+        return delivered + finishScan(onRecord);
+    }
+}
+
+std::size_t ScanEngine::finishScan(const RecordFn& onRecord)
+{
+    close(fd_);
+    fd_ = -1;
+
+    parser_.finish(records_);
+    std::size_t delivered = deliver(onRecord);
+
+    int status = 0;
+    waitpid(pid_, &status, 0);
+    pid_ = -1;
+
+    auto end = Clock::now();
+#if MOTION_INSTRUMENT
+    recordStage(Stage::Scan, stageTicks() - scanStartTicks_);
+#endif
+    lastDuration_ = std::chrono::duration_cast<std::chrono::microseconds>(end - scanStart_);
+    nextStart_ = std::max(end, scanStart_ + interval_);
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+    {
+        ++scansCompleted_;
+        failStreak_ = 0;
+    }
+    else
+    {
+        std::cerr << "Scan command failed ("
+            << (WIFEXITED(status) ? "exit code " : "signal ")
+            << (WIFEXITED(status) ? WEXITSTATUS(status) : WTERMSIG(status)) << ")\n";
+        nextStart_ = std::max<Clock::time_point>(nextStart_, end + failed());
+    }
+    return delivered;
+}
+
+std::chrono::milliseconds ScanEngine::failed()
+{
+    ++scansFailed_;
+    const unsigned shift = std::min(failStreak_++, 6u);
+    return std::min<std::chrono::milliseconds>(std::chrono::milliseconds(1000 << shift), std::chrono::minutes(1));
+}
+
+std::size_t ScanEngine::deliver(const RecordFn& onRecord)
+{
+    std::size_t n = parser_.size();
+    std::size_t count = n - delivered_;
+    for (; delivered_ < n; ++delivered_)
+    {
+        onRecord(records_[delivered_]);
+    }
+    return count;
+}
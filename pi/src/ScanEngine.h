@@ -0,0 +1,79 @@
+// ScanEngine.h
+#pragma once
+#include "Measurement.h"
+#include "Instrument.h"
+#include "IwParser.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+/// Runs the Wi-Fi scan command as a child process without blocking the caller.
+/// The child's stdout is read through a non-blocking pipe from poll(), parsed
+/// incrementally, and each BSS record is handed out as soon as its lines have
+/// arrived. When a scan ends the next one starts back-to-back, or `interval`
+/// after the previous start if that is later. After a failed scan the next one
+/// waits at least 1 s, doubling with every further failure up to 1 min.
+class ScanEngine
+{
+public:
+    using RecordFn = std::function<void(const Sample&)>;
+
+    /// @param command   shell command printing `iw ... scan` output (a script can stand in for iw)
+    /// @param interval  minimum time between scan starts (0 = back-to-back)
+    /// @param timeout   a scan still running after this long is killed
+    explicit ScanEngine(std::string command = "sudo iw dev wlan0 scan",
+        std::chrono::milliseconds interval = std::chrono::milliseconds(0),
+        std::chrono::milliseconds timeout = std::chrono::seconds(30));
+    ~ScanEngine();
+
+    ScanEngine(const ScanEngine&) = delete;
+    ScanEngine& operator=(const ScanEngine&) = delete;
+
+    /// One turn of the event loop: start a scan if one is due, wait up to
+    /// `wait` for output, and call onRecord for every record that completed.
+    /// Returns the number of records delivered.
+    std::size_t poll(std::chrono::milliseconds wait, const RecordFn& onRecord);
+
+    /// true while a scan child is running
+    bool scanning() const { return pid_ > 0; }
+
+    std::uint64_t scansCompleted() const { return scansCompleted_; }
+    std::uint64_t scansFailed() const { return scansFailed_; }
+    /// wall time of the last completed scan
+    std::chrono::microseconds lastScanDuration() const { return lastDuration_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    bool startScan();
+    std::size_t readAvailable(const RecordFn& onRecord);
+    std::size_t finishScan(const RecordFn& onRecord);
+    std::size_t deliver(const RecordFn& onRecord);
+    /// count a failed scan and return how long to wait before the next one
+    std::chrono::milliseconds failed();
+
+    std::string               command_;
+    std::chrono::milliseconds interval_;
+    std::chrono::milliseconds timeout_;
+
+    pid_t             pid_ = -1;    ///< running scan child, or -1
+    int               fd_ = -1;     ///< read end of its stdout pipe
+    Clock::time_point scanStart_;
+#if MOTION_INSTRUMENT
+    std::uint64_t     scanStartTicks_ = 0;   ///< stageTicks() at spawn, for Stage::Scan
+#endif
+    Clock::time_point nextStart_;
+
+    IwScanParser             parser_;
+    std::vector<Sample> records_;    ///< records of the current scan (reused)
+    std::size_t              delivered_ = 0;
+
+    std::uint64_t             scansCompleted_ = 0;
+    std::uint64_t             scansFailed_ = 0;
+    unsigned                  failStreak_ = 0;   ///< consecutive failed scans
+    std::chrono::microseconds lastDuration_{ 0 };
+};
@@ -1,10 +1,36 @@
 #pragma once
 #include "Measurement.h"
+#include "IwParser.h"
+#include <cstddef>
 #include <vector>
 #include <string>
 
 class Scanner
 {
 public:
-    std::vector<Measurement> scan();
+    /// @param command  shell command whose stdout is `iw ... scan` output
+    explicit Scanner(std::string command = "sudo iw dev wlan0 scan")
+        : command_(std::move(command))
+    {
+    }
+
+    /// Scanner that re-parses a recorded `iw` dump on every scan() instead of
+    /// running a command (replay, benchmarks, machines without a Wi-Fi card)
+    static Scanner fromDump(std::string path)
+    {
+        Scanner s;
+        s.dumpPath_ = std::move(path);
+        return s;
+    }
+
+    std::vector<Sample> scan();
+
+    /// Same as scan(), but refills `out` in place so a caller that keeps the
+    /// vector around does not allocate on every scan. Returns out.size().
+    std::size_t scan(std::vector<Sample>& out);
+
+private:
+    std::string  command_;
+    std::string  dumpPath_;
+    IwScanParser parser_;
 };
@@ -0,0 +1,401 @@
+// SegmentLog.cpp
+#include "SegmentLog.h"
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <iostream>
+#include <limits>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+constexpr char SegmentHeader::kMagic[8];
+
+namespace
+{
+    constexpr std::uint64_t kPage = 4096;
+    constexpr std::int64_t  kFlushIntervalUs = 1000000;
+
+    bool writeAt(int fd, const void* data, std::size_t n, std::uint64_t offset)
+    {
+        const char* p = static_cast<const char*>(data);
+        while (n > 0)
+        {
+            ssize_t w = pwrite(fd, p, n, static_cast<off_t>(offset));
+            if (w < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return false;
+            }
+            p += w;
+            n -= static_cast<std::size_t>(w);
+            offset += static_cast<std::uint64_t>(w);
+        }
+        return true;
+    }
+
+    bool endsWith(const std::string& s, const char* suffix)
+    {
+        std::size_t n = std::strlen(suffix);
+        return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+    }
+}
+
+// ===================== SegmentLogWriter =====================
+
+bool SegmentLogWriter::open(const std::string& dir, std::size_t segmentBytes, std::uint32_t indexStride)
+{
+    close();
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+        std::cerr << "Cannot create segment log directory " << dir << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    dir_ = dir;
+    segmentBytes_ = std::max<std::size_t>(segmentBytes, 2 * kPage);
+    stride_ = std::max<std::uint32_t>(indexStride, 1);
+    pending_.reserve(stride_);
+    return startSegment(epochMicros());
+}
+
+bool SegmentLogWriter::startSegment(std::int64_t createdUs)
+{
+    // capacity so that header + index + records fit in segmentBytes_
+    const std::uint64_t perBlock = std::uint64_t(stride_) * sizeof(SegmentRecord) + sizeof(SegmentIndexEntry);
+    std::uint64_t blocks = (segmentBytes_ - kPage) / perBlock;
+    if (blocks == 0)
+    {
+        blocks = 1;
+    }
+    const std::uint64_t capacity = std::min<std::uint64_t>(blocks * stride_, std::numeric_limits<std::uint32_t>::max());
+    indexOffset_ = sizeof(SegmentHeader);
+    const std::uint64_t recordsOffset =
+        (indexOffset_ + blocks * sizeof(SegmentIndexEntry) + kPage - 1) / kPage * kPage;
+
+    char name[48];
+    std::snprintf(name, sizeof(name), "/seg-%020lld.bin", static_cast<long long>(createdUs));
+    const std::string path = dir_ + name;
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd_ < 0)
+    {
+        std::cerr << "Cannot create segment " << path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    if (ftruncate(fd_, static_cast<off_t>(recordsOffset + capacity * sizeof(SegmentRecord))) != 0)
+    {
+        std::cerr << "Cannot size segment " << path << ": " << std::strerror(errno) << "\n";
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    sym_ = std::fopen((path + ".sym").c_str(), "w");
+    if (!sym_)
+    {
+        std::cerr << "Cannot create " << path << ".sym: " << std::strerror(errno) << "\n";
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    header_ = SegmentHeader{};
+    std::memcpy(header_.magic, SegmentHeader::kMagic, sizeof(header_.magic));
+    header_.version = SegmentHeader::kVersion;
+    header_.recordSize = sizeof(SegmentRecord);
+    header_.indexStride = stride_;
+    header_.capacity = static_cast<std::uint32_t>(capacity);
+    header_.recordsOffset = recordsOffset;
+    header_.minTs = std::numeric_limits<std::int64_t>::max();
+    header_.maxTs = std::numeric_limits<std::int64_t>::min();
+    header_.createdUs = createdUs;
+    pending_.clear();
+    linkSeen_.assign(linkSeen_.size(), 0);
+    lastFlushUs_ = createdUs;
+    return writeAt(fd_, &header_, sizeof(header_), 0);
+}
+
+bool SegmentLogWriter::writeSymbol(LinkId link)
+{
+    if (link >= linkSeen_.size())
+    {
+        linkSeen_.resize(std::max<std::size_t>(link + 1, linkSeen_.size() * 2), 0);
+    }
+    if (linkSeen_[link])
+    {
+        return true;
+    }
+    linkSeen_[link] = 1;
+    const std::string_view source = symbols.source(link);
+    const std::string_view ssid = symbols.ssid(link);
+    return std::fprintf(sym_, "%u\t%.*s\t%.*s\n", link,
+        static_cast<int>(source.size()), source.data(),
+        static_cast<int>(ssid.size()), ssid.data()) > 0;
+}
+
+bool SegmentLogWriter::append(const Sample& m)
+{
+    if (fd_ < 0)
+    {
+        return false;
+    }
+    if (header_.count + pending_.size() == header_.capacity)
+    {
+        // segment full: rotate
+        if (!flush())
+        {
+            return false;
+        }
+        close();
+        if (!startSegment(std::max(m.tsUs, header_.createdUs + 1)))
+        {
+            return false;
+        }
+    }
+    if (!writeSymbol(m.link))
+    {
+        return false;
+    }
+
+    const std::uint64_t pos = header_.count + pending_.size();
+    if (pos % stride_ == 0)
+    {
+        block_ = SegmentIndexEntry{ m.tsUs, m.tsUs };
+    }
+    else
+    {
+        block_.minTs = std::min(block_.minTs, m.tsUs);
+        block_.maxTs = std::max(block_.maxTs, m.tsUs);
+    }
+    pending_.push_back(SegmentRecord{ m.tsUs, m.link, m.rssi });
+
+    if ((pos + 1) % stride_ == 0 || m.tsUs - lastFlushUs_ >= kFlushIntervalUs)
+    {
+        return flush();
+    }
+    return true;
+}
+
+bool SegmentLogWriter::flush()
+{
+    if (fd_ < 0 || pending_.empty())
+    {
+        return fd_ >= 0;
+    }
+    const std::uint64_t first = header_.count;
+    bool ok = writeAt(fd_, pending_.data(), pending_.size() * sizeof(SegmentRecord),
+        header_.recordsOffset + first * sizeof(SegmentRecord));
+
+    // the last pending record belongs to the current block; earlier complete
+    // blocks were written by the flush that completed them
+    const std::uint64_t count = first + pending_.size();
+    ok = ok && writeAt(fd_, &block_, sizeof(block_),
+        indexOffset_ + (count - 1) / stride_ * sizeof(SegmentIndexEntry));
+
+    // records and symbols must be in place before the header announces them
+    ok = ok && std::fflush(sym_) == 0;
+    for (const SegmentRecord& r : pending_)
+    {
+        header_.minTs = std::min(header_.minTs, r.tsUs);
+        header_.maxTs = std::max(header_.maxTs, r.tsUs);
+    }
+    header_.count = count;
+    ok = ok && writeAt(fd_, &header_, sizeof(header_), 0);
+    if (!ok)
+    {
+        std::cerr << "Segment log write failed: " << std::strerror(errno) << "\n";
+    }
+    pending_.clear();
+    lastFlushUs_ = epochMicros();
+    return ok;
+}
+
+void SegmentLogWriter::close()
+{
+    if (fd_ >= 0)
+    {
+        flush();
+        ::close(fd_);
+        fd_ = -1;
+    }
+    if (sym_)
+    {
+        std::fclose(sym_);
+        sym_ = nullptr;
+    }
+}
+
+// ===================== SegmentReader =====================
+
+SegmentReader& SegmentReader::operator=(SegmentReader&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        base_ = other.base_;
+        mapped_ = other.mapped_;
+        records_ = other.records_;
+        count_ = other.count_;
+        prefixMax_ = std::move(other.prefixMax_);
+        suffixMin_ = std::move(other.suffixMin_);
+        symPath_ = std::move(other.symPath_);
+        names_ = std::move(other.names_);
+        other.base_ = nullptr;
+        other.mapped_ = 0;
+        other.records_ = nullptr;
+        other.count_ = 0;
+    }
+    return *this;
+}
+
+bool SegmentReader::open(const std::string& path)
+{
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        std::cerr << "Cannot open segment " << path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(SegmentHeader))
+    {
+        std::cerr << "Not a segment file: " << path << "\n";
+        ::close(fd);
+        return false;
+    }
+    void* p = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED)
+    {
+        std::cerr << "Cannot map segment " << path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    base_ = static_cast<const std::uint8_t*>(p);
+    mapped_ = static_cast<std::size_t>(st.st_size);
+
+    const SegmentHeader* h = header();
+    if (std::memcmp(h->magic, SegmentHeader::kMagic, sizeof(h->magic)) != 0
+        || h->version != SegmentHeader::kVersion
+        || h->recordSize != sizeof(SegmentRecord)
+        || h->indexStride == 0
+        || h->recordsOffset + std::uint64_t(h->capacity) * sizeof(SegmentRecord) > mapped_)
+    {
+        std::cerr << "Not a segment file (or unsupported version): " << path << "\n";
+        close();
+        return false;
+    }
+    madvise(const_cast<std::uint8_t*>(base_), mapped_, MADV_SEQUENTIAL);
+    records_ = reinterpret_cast<const SegmentRecord*>(base_ + h->recordsOffset);
+    symPath_ = path + ".sym";
+    refresh();
+    return true;
+}
+
+void SegmentReader::refresh()
+{
+    if (!base_)
+    {
+        return;
+    }
+    const SegmentHeader* h = header();
+    count_ = static_cast<std::size_t>(std::min<std::uint64_t>(h->count, h->capacity));
+
+    const std::size_t blocks = (count_ + h->indexStride - 1) / h->indexStride;
+    const SegmentIndexEntry* index = reinterpret_cast<const SegmentIndexEntry*>(base_ + sizeof(SegmentHeader));
+    prefixMax_.resize(blocks);
+    suffixMin_.resize(blocks);
+    std::int64_t hi = std::numeric_limits<std::int64_t>::min();
+    for (std::size_t j = 0; j < blocks; ++j)
+    {
+        hi = std::max(hi, index[j].maxTs);
+        prefixMax_[j] = hi;
+    }
+    std::int64_t lo = std::numeric_limits<std::int64_t>::max();
+    for (std::size_t j = blocks; j-- > 0;)
+    {
+        lo = std::min(lo, index[j].minTs);
+        suffixMin_[j] = lo;
+    }
+    loadSymbols(symPath_);
+}
+
+bool SegmentReader::loadSymbols(const std::string& path)
+{
+    std::FILE* f = std::fopen(path.c_str(), "r");
+    if (!f)
+    {
+        return false;
+    }
+    names_.clear();
+    char line[1024];
+    while (std::fgets(line, sizeof(line), f))
+    {
+        char* tab1 = std::strchr(line, '\t');
+        char* tab2 = tab1 ? std::strchr(tab1 + 1, '\t') : nullptr;
+        if (!tab2)
+        {
+            continue;
+        }
+        char* nl = std::strchr(tab2 + 1, '\n');
+        if (nl)
+        {
+            *nl = '\0';
+        }
+        const std::uint32_t link = static_cast<std::uint32_t>(std::strtoul(line, nullptr, 10));
+        names_[link] = { std::string(tab1 + 1, tab2), std::string(tab2 + 1) };
+    }
+    std::fclose(f);
+    return true;
+}
+
+std::string_view SegmentReader::source(std::uint32_t link) const
+{
+    auto it = names_.find(link);
+    return it == names_.end() ? std::string_view() : std::string_view(it->second.first);
+}
+
+std::string_view SegmentReader::ssid(std::uint32_t link) const
+{
+    auto it = names_.find(link);
+    return it == names_.end() ? std::string_view() : std::string_view(it->second.second);
+}
+
+void SegmentReader::close()
+{
+    if (base_)
+    {
+        munmap(const_cast<std::uint8_t*>(base_), mapped_);
+    }
+    base_ = nullptr;
+    mapped_ = 0;
+    records_ = nullptr;
+    count_ = 0;
+    prefixMax_.clear();
+    suffixMin_.clear();
+    names_.clear();
+}
+
+std::vector<std::string> listSegments(const std::string& dir)
+{
+    std::vector<std::string> out;
+    DIR* d = opendir(dir.c_str());
+    if (!d)
+    {
+        return out;
+    }
+    while (dirent* e = readdir(d))
+    {
+        const std::string name = e->d_name;
+        if (name.compare(0, 4, "seg-") == 0 && endsWith(name, ".bin"))
+        {
+            out.push_back(dir + "/" + name);
+        }
+    }
+    closedir(d);
+    // zero-padded creation times: lexical order is age order
+    std::sort(out.begin(), out.end());
+    return out;
+}
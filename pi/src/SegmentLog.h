@@ -0,0 +1,174 @@
+// SegmentLog.h
+#pragma once
+#include "Measurement.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Append-only binary measurement log.
+//
+// A log is a directory of size-capped segment files "seg-<createdUs>.bin", each
+// laid out as
+//
+//   SegmentHeader | SegmentIndexEntry[blocks] | (pad to 4 KiB) | SegmentRecord[capacity]
+//
+// The file is sized once when the segment is created; `count` in the header says
+// how many records are valid. Every `indexStride` records form a block whose
+// min/max timestamp is kept in the index, so a reader can binary-search a time
+// range even though records arrive slightly out of order (ESP and scan samples
+// are stamped on different threads). Link ids are process-local, so every
+// segment has a "<segment>.sym" sidecar with one "link<TAB>source<TAB>ssid" line
+// per link it references.
+
+/// One measurement on disk (same layout as Sample)
+struct SegmentRecord
+{
+    std::int64_t  tsUs;
+    std::uint32_t link;
+    float         rssi;
+};
+static_assert(sizeof(SegmentRecord) == 16, "SegmentRecord must stay 16 bytes");
+
+/// Time range of one block of indexStride records
+struct SegmentIndexEntry
+{
+    std::int64_t minTs;
+    std::int64_t maxTs;
+};
+
+struct SegmentHeader
+{
+    static constexpr char          kMagic[8] = { 'M', 'D', 'S', 'E', 'G', 'L', 'O', 'G' };
+    static constexpr std::uint32_t kVersion = 1;
+
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t recordSize;     ///< sizeof(SegmentRecord)
+    std::uint32_t indexStride;    ///< records per index block
+    std::uint32_t capacity;       ///< records the segment can hold
+    std::uint64_t recordsOffset;  ///< file offset of the first record
+    std::uint64_t count;          ///< records written so far (updated on every flush)
+    std::int64_t  minTs;          ///< over the `count` records
+    std::int64_t  maxTs;
+    std::int64_t  createdUs;
+};
+static_assert(sizeof(SegmentHeader) == 64, "SegmentHeader must stay 64 bytes");
+
+/// Writes Samples into rotating segments of a log directory. Not thread-safe
+/// (FileLogger calls it under its own mutex).
+class SegmentLogWriter
+{
+public:
+    SegmentLogWriter() = default;
+    SegmentLogWriter(const SegmentLogWriter&) = delete;
+    SegmentLogWriter& operator=(const SegmentLogWriter&) = delete;
+    ~SegmentLogWriter() { close(); }
+
+    /// Start a new segment in `dir` (created if missing). Segments are rotated once
+    /// they reach `segmentBytes`; buffered records are written every `indexStride`
+    /// records or once a second, whichever comes first.
+    bool open(const std::string& dir, std::size_t segmentBytes = 64u << 20, std::uint32_t indexStride = 256);
+
+    bool isOpen() const { return fd_ >= 0; }
+
+    bool append(const Sample& m);
+
+    /// Write buffered records, their index block and the header
+    bool flush();
+
+    void close();
+
+private:
+    bool startSegment(std::int64_t createdUs);
+    bool writeSymbol(LinkId link);
+
+    std::string   dir_;
+    std::size_t   segmentBytes_ = 0;
+    std::uint32_t stride_ = 256;
+
+    int           fd_ = -1;
+    std::FILE*    sym_ = nullptr;
+    SegmentHeader header_{};
+    std::uint64_t indexOffset_ = 0;
+    std::vector<SegmentRecord> pending_;   ///< records not yet written
+    SegmentIndexEntry block_{};            ///< range of the (partial) current block
+    std::int64_t  lastFlushUs_ = 0;
+    std::vector<std::uint8_t> linkSeen_;   ///< link id -> already in this segment's .sym
+};
+
+/// Read-only view of one segment through mmap. Range lookups cost
+/// O(log blocks) plus the records actually in range.
+class SegmentReader
+{
+public:
+    SegmentReader() = default;
+    SegmentReader(const SegmentReader&) = delete;
+    SegmentReader& operator=(const SegmentReader&) = delete;
+    SegmentReader(SegmentReader&& other) noexcept { *this = std::move(other); }
+    SegmentReader& operator=(SegmentReader&& other) noexcept;
+    ~SegmentReader() { close(); }
+
+    bool open(const std::string& path);
+    void close();
+
+    /// Pick up records appended by a live writer since open()/refresh()
+    void refresh();
+
+    std::size_t size() const { return count_; }
+    const SegmentRecord* records() const { return records_; }
+    std::int64_t minTs() const { return header()->minTs; }
+    std::int64_t maxTs() const { return header()->maxTs; }
+
+    std::string_view source(std::uint32_t link) const;
+    std::string_view ssid(std::uint32_t link) const;
+
+    /// Call fn(const SegmentRecord&) for every record with from <= tsUs < to,
+    /// in file order. Returns the number of records passed to fn.
+    template <typename Fn>
+    std::size_t scan(std::int64_t from, std::int64_t to, Fn&& fn) const
+    {
+        std::size_t n = 0;
+        if (count_ == 0 || from >= to || to <= minTs() || from > maxTs())
+        {
+            return 0;
+        }
+        // blocks before `first` end before `from`; blocks from `last` on start at or after `to`
+        const std::size_t blocks = prefixMax_.size();
+        const std::size_t first = std::lower_bound(prefixMax_.begin(), prefixMax_.end(), from) - prefixMax_.begin();
+        const std::size_t last = std::lower_bound(suffixMin_.begin(), suffixMin_.end(), to) - suffixMin_.begin();
+        const std::size_t stride = header()->indexStride;
+        const std::size_t begin = first * stride;
+        const std::size_t end = last < blocks ? last * stride : count_;
+        for (std::size_t i = begin; i < end && i < count_; ++i)
+        {
+            const SegmentRecord& r = records_[i];
+            if (r.tsUs >= from && r.tsUs < to)
+            {
+                fn(r);
+                ++n;
+            }
+        }
+        return n;
+    }
+
+private:
+    const SegmentHeader* header() const { return reinterpret_cast<const SegmentHeader*>(base_); }
+    bool loadSymbols(const std::string& path);
+
+    const std::uint8_t*  base_ = nullptr;
+    std::size_t          mapped_ = 0;
+    const SegmentRecord* records_ = nullptr;
+    std::size_t          count_ = 0;
+    std::vector<std::int64_t> prefixMax_;   ///< max timestamp of blocks [0, j]
+    std::vector<std::int64_t> suffixMin_;   ///< min timestamp of blocks [j, end)
+    std::string          symPath_;
+    std::unordered_map<std::uint32_t, std::pair<std::string, std::string>> names_;
+};
+
+/// Segment files of a log directory, oldest first
+std::vector<std::string> listSegments(const std::string& dir);
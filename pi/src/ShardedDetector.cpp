@@ -0,0 +1,174 @@
+// ShardedDetector.cpp
+#include "ShardedDetector.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+ShardedDetector::ShardedDetector(TimeSource& time, const Options& options, SampleFn onSample,
+    EpisodeFn onEpisode, BatchFn onBatch)
+    : time_(time), onSample_(std::move(onSample)), onEpisode_(std::move(onEpisode)),
+    onBatch_(std::move(onBatch)), fusion_(options.fusion)
+{
+    const std::size_t workers = std::max<std::size_t>(options.workers, 1);
+    const std::size_t producers = std::max<std::size_t>(options.producers, 1);
+    for (std::size_t i = 0; i < workers; ++i)
+    {
+        std::unique_ptr<Shard> shard(new Shard);
+        shard->pipeline.reset(new MotionPipeline(time_, options.calibrationSec, options.threshold,
+            options.maxLinks, options.baseline));
+        shard->episodes = EpisodeTracker(options.episodes);
+        shard->index = i;
+        for (std::size_t p = 0; p < producers; ++p)
+        {
+            shard->queues.emplace_back(new SpscQueue<Queued>(options.queueCapacity));
+        }
+        shards_.push_back(std::move(shard));
+    }
+}
+
+ShardedDetector::~ShardedDetector()
+{
+    stop();
+}
+
+void ShardedDetector::start()
+{
+    for (auto& shard : shards_)
+    {
+        shard->pipeline->start();
+    }
+    for (auto& shard : shards_)
+    {
+        Shard* s = shard.get();
+        s->worker = std::thread([this, s]() { run(*s); });
+    }
+}
+
+void ShardedDetector::run(Shard& shard)
+{
+    const std::size_t kBatch = 256;
+    MotionPipeline& pipeline = *shard.pipeline;
+    for (;;)
+    {
+        std::size_t n = 0;
+        for (auto& queue : shard.queues)
+        {
+            n += queue->drain(kBatch, [&](Queued& q)
+            {
+                const Sample& m = q.sample;
+                double deviation = 0.0;
+                const bool movement = pipeline.process(m, &deviation);
+                if (q.sendLagUs)
+                {
+                    // detection done: time since ingest, plus publisher-to-ingest lag
+                    shard.latency.record(static_cast<std::uint64_t>(
+                        std::max<std::int64_t>(time_.nowUs() - m.tsUs, 0)) + q.sendLagUs - 1);
+                }
+                onSample_(m, movement);
+                if (onEpisode_)
+                {
+                    shard.episodes.observe(m, movement, deviation, onEpisode_);
+                }
+                if (fusion_ && pipeline.calibrated())
+                {
+                    fusion_->push(shard.index, m, static_cast<float>(deviation));
+                }
+            });
+        }
+
+        if (n && onBatch_)
+        {
+            onBatch_();
+        }
+
+        if (shard.episodes.openEpisodes())
+        {
+            // links that went silent mid-episode end here
+            shard.episodes.expire(time_.nowUs(), onEpisode_);
+        }
+
+        if (n)
+        {
+            shard.links.store(pipeline.detector().getLinks().size(), std::memory_order_relaxed);
+        }
+
+        if (pipeline.tick())
+        {
+            // snapshot for the caller's calibration report; published by the release below
+            pipeline.detector().getLinks().forEach([&](LinkId link, const LinkStats& st)
+            {
+                shard.calibration.push_back(CalibratedLink{ link, st.base.mean, std::sqrt(st.variance()), st.count });
+            });
+            calibratedShards_.fetch_add(1, std::memory_order_release);
+        }
+
+        if (n == 0)
+        {
+            // producers have stopped by the time stopping_ is set, so one more
+            // empty pass means everything was processed
+            if (stopping_.load(std::memory_order_acquire))
+            {
+                bool empty = true;
+                for (auto& queue : shard.queues)
+                {
+                    empty = empty && queue->depth() == 0;
+                }
+                if (empty)
+                {
+                    if (onEpisode_)
+                    {
+                        shard.episodes.closeAll(onEpisode_);
+                    }
+                    break;
+                }
+                continue;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+ShardedDetector::QueueStats ShardedDetector::queueStats(std::size_t producer) const
+{
+    QueueStats stats;
+    for (const auto& shard : shards_)
+    {
+        const SpscQueue<Queued>& queue = *shard->queues[producer];
+        stats.depth += queue.depth();
+        stats.highWater = std::max(stats.highWater, queue.highWater());
+        stats.capacity = queue.capacity();
+        stats.pushed += queue.pushed();
+        stats.drops += queue.drops();
+    }
+    return stats;
+}
+
+std::size_t ShardedDetector::trackedLinks() const
+{
+    std::size_t links = 0;
+    for (const auto& shard : shards_)
+    {
+        links += shard->links.load(std::memory_order_relaxed);
+    }
+    return links;
+}
+
+void ShardedDetector::latencySnapshot(Histogram& out) const
+{
+    for (const auto& shard : shards_)
+    {
+        shard->latency.snapshot(out);
+    }
+}
+
+void ShardedDetector::stop()
+{
+    stopping_.store(true, std::memory_order_release);
+    for (auto& shard : shards_)
+    {
+        if (shard->worker.joinable())
+        {
+            shard->worker.join();
+        }
+    }
+}
@@ -0,0 +1,158 @@
+// ShardedDetector.h
+#pragma once
+#include "EpisodeTracker.h"
+#include "FusionEngine.h"
+#include "Histogram.h"
+#include "MotionPipeline.h"
+#include "SpscQueue.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/// Calibration result of one link, captured by its shard when calibration ends
+struct CalibratedLink
+{
+    LinkId        link;
+    double        mean;
+    double        stddev;
+    std::uint64_t count;
+};
+
+/// MotionPipelines partitioned by source over a pool of worker threads.
+///
+/// Every source (MQTT topic, or "pi") is routed by hash to one shard, and each
+/// shard's pipeline is touched only by its worker thread, so links are owned
+/// without locks. Producers hand samples over through one SpscQueue per
+/// (producer, shard) pair: each producer thread uses its own index, and nothing
+/// on the sample path is shared between shards.
+class ShardedDetector
+{
+public:
+    /// Called on the worker thread for every sample, after detection
+    using SampleFn = std::function<void(const Sample& m, bool movement)>;
+
+    /// Called on the worker thread when a link's episode is confirmed and when it ends
+    using EpisodeFn = std::function<void(const Episode& e, EpisodeTracker::Event event)>;
+
+    /// Called on the worker thread after each batch of samples it drained, so
+    /// the SampleFn can buffer its output per shard and write it out here
+    using BatchFn = std::function<void()>;
+
+    struct Options
+    {
+        std::size_t    workers = 1;
+        std::size_t    producers = 1;       ///< threads calling push(), each with its own index
+        std::size_t    queueCapacity = 8192; ///< per (producer, shard) queue
+        int            calibrationSec = 30;
+        double         threshold = 10.0;
+        std::size_t    maxLinks = 4096;     ///< per shard
+        BaselineConfig baseline;
+        EpisodeConfig  episodes;            ///< used only with an EpisodeFn
+        FusionEngine*  fusion = nullptr;    ///< gets every detected sample's deviation; producer index = shard
+    };
+
+    /// Queue counters of one producer, over all shards
+    struct QueueStats
+    {
+        std::size_t   depth = 0;
+        std::size_t   highWater = 0;   ///< of the fullest queue
+        std::size_t   capacity = 0;    ///< of one queue
+        std::uint64_t pushed = 0;
+        std::uint64_t drops = 0;
+    };
+
+    ShardedDetector(TimeSource& time, const Options& options, SampleFn onSample,
+        EpisodeFn onEpisode = EpisodeFn(), BatchFn onBatch = BatchFn());
+    ~ShardedDetector();
+
+    ShardedDetector(const ShardedDetector&) = delete;
+    ShardedDetector& operator=(const ShardedDetector&) = delete;
+
+    /// Open the calibration window and start the workers
+    void start();
+
+    /// Producer side (thread `producer` only). Returns false if the shard's queue was full.
+    /// sendLagUs: ingest minus publisher send time, plus 1 (0: not sent with one),
+    /// for the publish-to-detection latency histogram.
+    bool push(std::size_t producer, const Sample& m, std::uint32_t sendLagUs = 0)
+    {
+        return shards_[shardOf(m.link)]->queues[producer]->push(Queued{ m, sendLagUs });
+    }
+
+    std::size_t shardOf(LinkId link) const
+    {
+        // Fibonacci hash of the interned source (topic) id
+        const std::uint64_t h = std::uint64_t(symbols.sourceOf(link)) * 0x9E3779B97F4A7C15ull;
+        return static_cast<std::size_t>((h >> 32) % shards_.size());
+    }
+
+    std::size_t workers() const { return shards_.size(); }
+
+    /// True once every shard has finished calibration
+    bool calibrated() const
+    {
+        return calibratedShards_.load(std::memory_order_acquire) == shards_.size();
+    }
+
+    /// Call fn(const CalibratedLink&) for every link seen during calibration.
+    /// Only meaningful once calibrated() is true.
+    template <typename Fn>
+    void forEachCalibratedLink(Fn&& fn) const
+    {
+        for (const auto& shard : shards_)
+        {
+            for (const CalibratedLink& link : shard->calibration)
+            {
+                fn(link);
+            }
+        }
+    }
+
+    QueueStats queueStats(std::size_t producer) const;
+
+    /// Links currently tracked by all shards (as of each worker's last batch)
+    std::size_t trackedLinks() const;
+
+    /// Add every shard's publish-to-detection latencies (µs, counted since start
+    /// for samples that carried a send time) to `out`
+    void latencySnapshot(Histogram& out) const;
+
+    /// Process everything already queued and join the workers. Producers must
+    /// have stopped calling push().
+    void stop();
+
+private:
+    /// Queue element: the sample plus loadgen's latency stamp, which stays out of Sample
+    struct Queued
+    {
+        Sample        sample;
+        std::uint32_t sendLagUs;
+    };
+
+    struct Shard
+    {
+        std::unique_ptr<MotionPipeline> pipeline;
+        std::vector<std::unique_ptr<SpscQueue<Queued>>> queues;   ///< one per producer
+        std::vector<CalibratedLink> calibration;   ///< written by the worker before calibratedShards_++
+        ConcurrentHistogram latency;               ///< written by the worker only
+        EpisodeTracker episodes;                   ///< worker only
+        std::atomic<std::size_t> links{ 0 };       ///< tracked links, stored by the worker
+        std::size_t index = 0;
+        std::thread worker;
+    };
+
+    void run(Shard& shard);
+
+    TimeSource&                         time_;
+    SampleFn                            onSample_;
+    EpisodeFn                           onEpisode_;
+    BatchFn                             onBatch_;
+    FusionEngine*                       fusion_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<std::size_t>            calibratedShards_{ 0 };
+    std::atomic<bool>                   stopping_{ false };
+};
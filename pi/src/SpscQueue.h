@@ -0,0 +1,97 @@
+// SpscQueue.h
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+/// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+/// push() never blocks: when the ring is full the item is dropped and counted.
+/// Depth, drop count and high-water mark can be read from any thread.
+template <typename T>
+class SpscQueue
+{
+public:
+    /// @param capacity  number of slots, rounded up to a power of two
+    explicit SpscQueue(std::size_t capacity)
+    {
+        std::size_t cap = 2;
+        while (cap < capacity)
+        {
+            cap <<= 1;
+        }
+        mask_ = cap - 1;
+        slots_.reset(new T[cap]);
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /// Producer side. Returns false (and counts a drop) if the queue is full.
+    bool push(T&& item)
+    {
+        const std::size_t tail = tail_.load(std::memory_order_relaxed);
+        const std::size_t head = head_.load(std::memory_order_acquire);
+        if (tail - head > mask_)
+        {
+            drops_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        slots_[tail & mask_] = std::move(item);
+        tail_.store(tail + 1, std::memory_order_release);
+
+        // only the producer writes highWater_, so a relaxed load/store pair is enough
+        const std::size_t depth = tail + 1 - head;
+        if (depth > highWater_.load(std::memory_order_relaxed))
+        {
+            highWater_.store(depth, std::memory_order_relaxed);
+        }
+        pushed_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /// Consumer side. Moves up to maxItems items into fn(T&) in FIFO order and
+    /// returns how many were handed out.
+    template <typename Fn>
+    std::size_t drain(std::size_t maxItems, Fn&& fn)
+    {
+        const std::size_t head = head_.load(std::memory_order_relaxed);
+        const std::size_t tail = tail_.load(std::memory_order_acquire);
+        std::size_t n = tail - head;
+        if (n > maxItems)
+        {
+            n = maxItems;
+        }
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            fn(slots_[(head + i) & mask_]);
+        }
+        head_.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    std::size_t capacity() const { return mask_ + 1; }
+
+    /// Items currently waiting (approximate while both sides are running)
+    std::size_t depth() const
+    {
+        return tail_.load(std::memory_order_relaxed) - head_.load(std::memory_order_relaxed);
+    }
+
+    std::size_t highWater() const { return highWater_.load(std::memory_order_relaxed); }
+    std::uint64_t drops() const { return drops_.load(std::memory_order_relaxed); }
+    std::uint64_t pushed() const { return pushed_.load(std::memory_order_relaxed); }
+
+private:
+    std::unique_ptr<T[]> slots_;
+    std::size_t          mask_ = 0;
+
+    // producer and consumer indices live on separate cache lines
+    alignas(64) std::atomic<std::size_t> head_{ 0 };   ///< next slot to read (consumer)
+    alignas(64) std::atomic<std::size_t> tail_{ 0 };   ///< next slot to write (producer)
+    alignas(64) std::atomic<std::size_t> highWater_{ 0 };
+    std::atomic<std::uint64_t>           drops_{ 0 };
+    std::atomic<std::uint64_t>           pushed_{ 0 };
+};
@@ -0,0 +1,84 @@
+// SymbolTable.cpp
+#include "SymbolTable.h"
+#include <mutex>
+
+// Define the global SymbolTable instance
+SymbolTable symbols;
+
+SymbolTable::SymbolTable()
+    : symbolChunks_(new std::unique_ptr<std::string[]>[kMaxSymbols / kChunkSize]),
+    linkChunks_(new std::unique_ptr<LinkSlot[]>[kMaxLinks / kChunkSize])
+{
+}
+
+SymbolId SymbolTable::intern(std::string_view name)
+{
+    {
+        std::shared_lock<std::shared_mutex> lk(mu_);
+        auto it = symbolIds_.find(name);
+        if (it != symbolIds_.end())
+        {
+            return it->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lk(mu_);
+    auto it = symbolIds_.find(name);
+    if (it != symbolIds_.end())
+    {
+        return it->second;   // another thread added it meanwhile
+    }
+    const std::size_t id = symbolCount_.load(std::memory_order_relaxed);
+    if (id >= kMaxSymbols)
+    {
+        return kNoSymbol;
+    }
+    auto& chunk = symbolChunks_[id >> kChunkBits];
+    if (!chunk)
+    {
+        chunk.reset(new std::string[kChunkSize]);
+    }
+    std::string& stored = chunk[id & (kChunkSize - 1)];
+    stored.assign(name.data(), name.size());
+    symbolIds_.emplace(std::string_view(stored), static_cast<SymbolId>(id));
+    symbolCount_.store(id + 1, std::memory_order_release);
+    return static_cast<SymbolId>(id);
+}
+
+LinkId SymbolTable::link(SymbolId source, SymbolId ssid)
+{
+    if (source == kNoSymbol || ssid == kNoSymbol)
+    {
+        return kNoLink;
+    }
+    const std::uint64_t key = (std::uint64_t(source) << 32) | ssid;
+    {
+        std::shared_lock<std::shared_mutex> lk(mu_);
+        auto it = linkIds_.find(key);
+        if (it != linkIds_.end())
+        {
+            return it->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lk(mu_);
+    auto it = linkIds_.find(key);
+    if (it != linkIds_.end())
+    {
+        return it->second;
+    }
+    const std::size_t id = linkCount_.load(std::memory_order_relaxed);
+    if (id >= kMaxLinks)
+    {
+        return kNoLink;
+    }
+    auto& chunk = linkChunks_[id >> kChunkBits];
+    if (!chunk)
+    {
+        chunk.reset(new LinkSlot[kChunkSize]);
+    }
+    chunk[id & (kChunkSize - 1)] = LinkSlot{ source, ssid };
+    linkIds_.emplace(key, static_cast<LinkId>(id));
+    linkCount_.store(id + 1, std::memory_order_release);
+    return static_cast<LinkId>(id);
+}
@@ -0,0 +1,85 @@
+// SymbolTable.h
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+using SymbolId = std::uint32_t;   ///< interned string (source topic or SSID)
+using LinkId = std::uint32_t;     ///< interned (source, SSID) pair
+
+/// Interns sources and SSIDs to dense 32-bit ids, and (source, SSID) pairs to
+/// dense link ids, so the hot path can carry integers instead of strings.
+///
+/// Interning takes a shared lock for the lookup and an exclusive one only the
+/// first time a string is seen. Names are stored in fixed-size chunks that never
+/// move, so name()/source()/ssid() are lock-free for any id the caller obtained
+/// from this table (directly or through a queue with release/acquire ordering),
+/// and the returned views stay valid for the table's lifetime.
+///
+/// The table never shrinks. Once it is full, new names and links are rejected
+/// (kNoSymbol / kNoLink) and callers drop the sample; known ones still resolve.
+class SymbolTable
+{
+public:
+    static constexpr SymbolId kMaxSymbols = 1u << 20;
+    static constexpr LinkId   kMaxLinks = 1u << 20;
+    static constexpr SymbolId kNoSymbol = ~SymbolId(0);   ///< intern() of a new name into a full table
+    static constexpr LinkId   kNoLink = ~LinkId(0);       ///< link() of a new pair into a full table
+
+    SymbolTable();
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+
+    /// Id of `name`, adding it on first use (kNoSymbol if the table is full)
+    SymbolId intern(std::string_view name);
+
+    /// Id of the (source, ssid) link, adding it on first use (kNoLink if the
+    /// table is full or either symbol is kNoSymbol)
+    LinkId link(SymbolId source, SymbolId ssid);
+    LinkId link(std::string_view source, std::string_view ssid) { return link(intern(source), intern(ssid)); }
+
+    std::string_view name(SymbolId id) const { return symbol(id); }
+    SymbolId sourceOf(LinkId id) const { return linkSlot(id).source; }
+    SymbolId ssidOf(LinkId id) const { return linkSlot(id).ssid; }
+    std::string_view source(LinkId id) const { return symbol(sourceOf(id)); }
+    std::string_view ssid(LinkId id) const { return symbol(ssidOf(id)); }
+
+    std::size_t symbolCount() const { return symbolCount_.load(std::memory_order_acquire); }
+    std::size_t linkCount() const { return linkCount_.load(std::memory_order_acquire); }
+
+private:
+    static constexpr std::size_t kChunkBits = 10;
+    static constexpr std::size_t kChunkSize = std::size_t(1) << kChunkBits;
+
+    struct LinkSlot
+    {
+        SymbolId source;
+        SymbolId ssid;
+    };
+
+    const std::string& symbol(SymbolId id) const
+    {
+        return symbolChunks_[id >> kChunkBits][id & (kChunkSize - 1)];
+    }
+    const LinkSlot& linkSlot(LinkId id) const
+    {
+        return linkChunks_[id >> kChunkBits][id & (kChunkSize - 1)];
+    }
+
+    mutable std::shared_mutex mu_;
+    std::unordered_map<std::string_view, SymbolId> symbolIds_;  ///< keys view into symbolChunks_
+    std::unordered_map<std::uint64_t, LinkId>      linkIds_;    ///< (source << 32 | ssid) -> link
+
+    std::unique_ptr<std::unique_ptr<std::string[]>[]> symbolChunks_;
+    std::unique_ptr<std::unique_ptr<LinkSlot[]>[]>    linkChunks_;
+    std::atomic<std::size_t> symbolCount_{ 0 };
+    std::atomic<std::size_t> linkCount_{ 0 };
+};
+
+/// Process-wide table shared by the scanner, the MQTT decoder and the sinks
+extern SymbolTable symbols;
@@ -0,0 +1,61 @@
+// TimeSource.h
+#pragma once
+#include "Measurement.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/// Where the detection pipeline gets "now" from. Live runs use SystemTime;
+/// replays use VirtualTime, advanced by the recorded sample timestamps, so
+/// calibration windows and intervals behave the same at any replay speed.
+class TimeSource
+{
+public:
+    virtual ~TimeSource() = default;
+
+    /// Microseconds since the Unix epoch, comparable with Sample::tsUs
+    virtual std::int64_t nowUs() = 0;
+
+    /// Microseconds on a clock that only moves forward at a steady rate, for
+    /// measuring intervals (calibration, reporting periods)
+    virtual std::int64_t monotonicUs() = 0;
+};
+
+/// The process-wide WallClock (see epochMicros()) and steady_clock. Wall-clock
+/// steps (NTP setting the date on a Pi without an RTC) do not move monotonicUs().
+class SystemTime : public TimeSource
+{
+public:
+    std::int64_t nowUs() override { return epochMicros(); }
+
+    std::int64_t monotonicUs() override
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
+
+/// Time that only moves when told to (and never backwards, so it serves as
+/// both the wall and the monotonic clock)
+class VirtualTime : public TimeSource
+{
+public:
+    explicit VirtualTime(std::int64_t startUs = 0) : now_(startUs) {}
+
+    std::int64_t nowUs() override { return now_.load(std::memory_order_relaxed); }
+    std::int64_t monotonicUs() override { return nowUs(); }
+
+    void set(std::int64_t us) { now_.store(us, std::memory_order_relaxed); }
+
+    /// Move forward to `us`; never moves backwards (recorded samples may be slightly out of order)
+    void advanceTo(std::int64_t us)
+    {
+        if (us > now_.load(std::memory_order_relaxed))
+        {
+            now_.store(us, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    std::atomic<std::int64_t> now_;
+};
@@ -0,0 +1,124 @@
+// WallClock.h
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <limits>
+
+/// Wall-clock timestamps in microseconds since the Unix epoch, derived from the
+/// monotonic clock plus a cached (wall - monotonic) offset.
+///
+/// Reading the time is one steady_clock read and a few atomics. The offset is
+/// re-anchored against system_clock once per `resyncInterval`, so NTP corrections
+/// (a Pi without an RTC boots with a wrong date) are picked up within that
+/// interval. Timestamps never go backwards by less than `maxBackStep`; a larger
+/// backward correction is taken as a real clock change and followed.
+class WallClock
+{
+public:
+    explicit WallClock(std::chrono::seconds resyncInterval = std::chrono::seconds(1),
+        std::chrono::microseconds maxBackStep = std::chrono::seconds(1))
+        : resyncUs_(std::chrono::duration_cast<std::chrono::microseconds>(resyncInterval).count()),
+        maxBackStepUs_(maxBackStep.count())
+    {
+        resync(monoMicros());
+    }
+
+    WallClock(const WallClock&) = delete;
+    WallClock& operator=(const WallClock&) = delete;
+
+    std::int64_t nowUs()
+    {
+        const std::int64_t mono = monoMicros();
+        if (mono >= nextSyncUs_.load(std::memory_order_relaxed))
+        {
+            resync(mono);
+        }
+        std::int64_t t = mono + offsetUs_.load(std::memory_order_relaxed);
+
+        // never hand out a timestamp older than one already handed out,
+        // unless the wall clock was deliberately set back
+        std::int64_t last = lastUs_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            if (t <= last && last - t <= maxBackStepUs_)
+            {
+                return last;
+            }
+            if (lastUs_.compare_exchange_weak(last, t, std::memory_order_relaxed))
+            {
+                return t;
+            }
+        }
+    }
+
+private:
+    static std::int64_t monoMicros()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void resync(std::int64_t mono)
+    {
+        const std::int64_t wall = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        offsetUs_.store(wall - mono, std::memory_order_relaxed);
+        nextSyncUs_.store(mono + resyncUs_, std::memory_order_relaxed);
+    }
+
+    const std::int64_t resyncUs_;
+    const std::int64_t maxBackStepUs_;
+    std::atomic<std::int64_t> offsetUs_{ 0 };     ///< wall - monotonic at the last resync
+    std::atomic<std::int64_t> nextSyncUs_{ 0 };   ///< monotonic time of the next resync
+    std::atomic<std::int64_t> lastUs_{ 0 };       ///< latest timestamp handed out
+};
+
+/// Formats epoch-microsecond timestamps as local "YYYY-MM-DD HH:MM:SS.mmm".
+///
+/// The date/time prefix is cached per second, so localtime_r (which takes the
+/// libc timezone lock) runs at most once per second instead of once per line.
+/// Not thread-safe: give every sink (or thread) its own instance.
+class TimestampFormatter
+{
+public:
+    /// Characters written by format(), excluding the terminating NUL
+    static constexpr std::size_t kLength = 23;
+
+    /// Write the text form of `tsUs` to out[0..kLength] (NUL-terminated); returns kLength
+    std::size_t format(std::int64_t tsUs, char* out)
+    {
+        std::int64_t sec = tsUs / 1000000;
+        std::int64_t us = tsUs % 1000000;
+        if (us < 0)
+        {
+            --sec;
+            us += 1000000;
+        }
+        if (sec != cachedSec_)
+        {
+            std::time_t t = static_cast<std::time_t>(sec);
+            std::tm tm{};
+            localtime_r(&t, &tm);
+            std::strftime(prefix_, sizeof(prefix_), "%Y-%m-%d %H:%M:%S", &tm);
+            cachedSec_ = sec;
+        }
+        for (std::size_t i = 0; i < 19; ++i)
+        {
+            out[i] = prefix_[i];
+        }
+        const int ms = static_cast<int>(us / 1000);
+        out[19] = '.';
+        out[20] = static_cast<char>('0' + ms / 100);
+        out[21] = static_cast<char>('0' + ms / 10 % 10);
+        out[22] = static_cast<char>('0' + ms % 10);
+        out[23] = '\0';
+        return kLength;
+    }
+
+private:
+    std::int64_t cachedSec_ = std::numeric_limits<std::int64_t>::min();
+    char prefix_[32] = {};
+};
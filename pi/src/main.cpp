@@ -1,89 +1,269 @@
 // main.cpp
-#include "Scanner.h"
+#include "Config.h"
+#include "ScanEngine.h"
 #include "Logger.h"
 #include "SQLiteDB.h"
-#include "MotionDetector.h"
+#include "ShardedDetector.h"
+#include "FusionEngine.h"
+#include "Payload.h"
+#include "Instrument.h"
+#include "Metrics.h"
+#include "RetentionManager.h"
 #include <mosquitto.h>
+#include <algorithm>
 #include <iostream>
 #include <atomic>
 #include <thread>
 #include <chrono>
-#include <ctime>
+#include <csignal>
+#include <cstdint>
+#include <string_view>
 
 // Define the global SQLiteDB instance so Logger.cpps extern SQLiteDB db can link correctly.
 SQLiteDB db;
 
 // Atomic flag to control when to stop loops
 static std::atomic<bool> running{ true };
-// Will be set to true once computeAverages() has completed
-static std::atomic<bool> calibrated{ false };
+// "Now" for calibration and reporting intervals (a replay substitutes a VirtualTime)
+static SystemTime systemTime;
 
-/// Return a formatted timestamp string (YYYY-MM-DD HH:MM:SS)
-static std::string nowTimestamp()
+/// SIGINT/SIGTERM: leave the main loop so queued DB rows get flushed on exit
+static void onSignal(int)
 {
-    std::time_t t = std::time(nullptr);
-    char buf[64];
-    std::strftime(buf, sizeof(buf),
-        "%Y-%m-%d %H:%M:%S",
-        std::localtime(&t));
-    return buf;
+    running.store(false);
+}
+
+#if MOTION_INSTRUMENT
+/// SIGUSR1: print the per-stage latency histograms from the main loop
+static std::atomic<bool> dumpStagesRequested{ false };
+static void onDumpSignal(int)
+{
+    dumpStagesRequested.store(true);
 }
+#endif
+
+/// Producer indices of the ShardedDetector: each producer thread has its own queues
+static constexpr std::size_t kMqttProducer = 0;   // mosquitto network thread (on_message)
+static constexpr std::size_t kScanProducer = 1;   // main thread (Wi-Fi scans)
 
 /**
- * MQTT callback: Called whenever a new message arrives on the subscribed topic.
- * 1) Parse payload into a Measurement.
- * 2) Add it to MotionDetector (for calibration or online detection).
- * 3) Call FileLogger.log(m) ? writes to CSV, prints to console, saves to measurements table.
- * 4) If already calibrated, immediately check for movement on this ESP measurement,
- *    and if movement is detected, print and save to motions table.
+ * MQTT callback: Called on the mosquitto network thread whenever a new message arrives.
+ * It only decodes the payload and hands its Samples to the detector shard of their
+ * topic; everything that can touch the disk happens in processSample() on the
+ * worker threads, so socket reads and keepalives are never held up by a slow write.
  */
 void on_message(struct mosquitto*, void* user_data, const struct mosquitto_message* msg)
 {
-    // 1) Parse topic and payload
-    std::string topic(msg->topic);
-    std::string payload((char*)msg->payload, msg->payloadlen);
-    auto comma = payload.find(',');
-    Measurement m{
-        nowTimestamp(),
-        topic,
-        payload.substr(0, comma),
-        std::stod(payload.substr(comma + 1))
-    };
-
-    // 2) Add sample to MotionDetector (whether calibrating or already calibrated)
-    if (user_data)
-    {
-        auto detector = static_cast<MotionDetector*>(user_data);
-        detector->addSample(m);
+    MOTION_TIME_STAGE(Stage::MqttIngest);
+    auto detector = static_cast<ShardedDetector*>(user_data);
+    metrics.mqttMessages.fetch_add(1, std::memory_order_relaxed);
+
+    // binary payloads (current firmware) carry up to kMaxPayloadSamples samples,
+    // text payloads (old firmware) one
+    Sample batch[kMaxPayloadSamples];
+    std::uint32_t sendLagUs = 0;
+    const std::size_t n = decodePayload(msg->topic,
+        std::string_view(static_cast<const char*>(msg->payload), msg->payloadlen),
+        epochMicros(), batch, kMaxPayloadSamples, &sendLagUs);
+    if (n == 0)
+    {
+        // Malformed payload (or SymbolTable full): count and skip it rather than crash the thread
+        metrics.badPayloads.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        metrics.samples.add(symbols.sourceOf(batch[i].link));
+        detector->push(kMqttProducer, batch[i], sendLagUs);
     }
+}
+
+static thread_local FileLogger::Batch logBatch;   // per worker thread, i.e. per shard
+
+/**
+ * Output stage for one measurement (runs on the worker thread of its shard,
+ * after its pipeline has checked it for movement):
+ * Format its CSV and console lines into the shard's batch; flushSamples() writes them.
+ * Movement is reported per episode, by processEpisode().
+ */
+
+static void processSample(const Sample& m, bool)
+{
+    logger.add(logBatch, m);
+}
+
+/**
+ * End of a worker's batch: write the lines processSample() formatted to the
+ * CSV file and console, and queue the rows for the DB, taking the shared
+ * locks once per batch instead of once per sample.
+ */
+static void flushSamples()
+{
+    logger.write(logBatch);
+}
+
+/**
+ * Output stage for movement (worker thread of the link's shard). The shard's
+ * EpisodeTracker groups the flagged samples of a link into episodes:
+ * 1) Started: print one line and save one row to the motions table.
+ * 2) Ended: print its duration and save it to the episodes table.
+ */
+static void processEpisode(const Episode& e, EpisodeTracker::Event event)
+{
+    static const SymbolId pi = symbols.intern("pi");
+    const bool esp = symbols.sourceOf(e.link) != pi;
+    if (event == EpisodeTracker::Event::Started)
+    {
+        std::cout << formatTimestamp(e.startUs)
+            << (esp ? " Movement! (ESP) Source: " : " Movement! Source: ") << symbols.source(e.link)
+            << " SSID: " << symbols.ssid(e.link)
+            << " RSSI = " << e.peakRssi << " (" << e.peakDeviation << " dB)" << std::endl;
 
-    // 3) Log to CSV, console, and measurements table
-    logger.log(m);
+        db.enqueueMotion(esp ? "movement detected (ESP)" : "Movement detected",
+            Sample{ e.startUs, e.link, e.peakRssi });
+        metrics.motions.add(symbols.sourceOf(e.link));
+        return;
+    }
+    std::cout << formatTimestamp(e.endUs) << " Movement ended. Source: " << symbols.source(e.link)
+        << " SSID: " << symbols.ssid(e.link)
+        << " after " << double(e.endUs - e.startUs) / 1e6 << " s, " << e.samples << " samples, peak "
+        << e.peakDeviation << " dB" << std::endl;
+    db.enqueueEpisode(e);
+}
 
-    // 4) If calibration is already done, immediately check for movement:
-    if (calibrated.load())
+/**
+ * Output stage of the fusion engine (its own thread, every --fusion-tick-ms):
+ * print when movement seen across links starts and ends.
+ */
+static void processFusion(const FusionTick& t)
+{
+    static bool moving = false;
+    if (t.movement == moving)
     {
-        auto detector = static_cast<MotionDetector*>(user_data);
-        if (detector->isMovement(m))
-        {
-            // Print to stdout that an ESP-based movement was detected
-            std::cout << nowTimestamp()
-                << " Movement! (ESP) Source: " << m.source
-                << " SSID: " << m.ssid
-                << " RSSI=" << m.rssi << "\n";
-
-            // Save this movement event into the motions table
-            if (!db.saveMotion("movement detected (ESP)", m.timeStamp, m.source, m.rssi))
-            {
-                std::cerr << "DB insert error (motion for ESP)\n";
-            }
-        }
+        return;
     }
+    moving = t.movement;
+    std::cout << formatTimestamp(t.tUs) << (moving ? " Fused movement! " : " Fused movement ended. ")
+        << t.votes << " of " << t.links << " links, vote = " << t.vote
+        << ", score = " << t.score << ", coherence = " << t.coherence << ", peak z = " << t.peakZ << std::endl;
+}
+
+/// Print the MQTT queue counters (depth, high-water mark, drops, malformed payloads)
+static void printQueueStats(const ShardedDetector& detector)
+{
+    const ShardedDetector::QueueStats q = detector.queueStats(kMqttProducer);
+    std::cout << formatTimestamp(epochMicros())
+        << " MQTT queues (" << detector.workers() << " workers): depth=" << q.depth
+        << " high-water=" << q.highWater << "/" << q.capacity
+        << " received=" << q.pushed
+        << " dropped=" << q.drops
+        << " malformed=" << metrics.badPayloads.load(std::memory_order_relaxed) << std::endl;
 }
 
-int main()
+/// Scan counters for the metrics endpoint (the ScanEngine itself is main-thread only)
+static void publishScanMetrics(const ScanEngine& scanner)
 {
-    // 0) Open SQLite database and initialize schema (tables: measurements, motions)
+    metrics.scansCompleted.store(scanner.scansCompleted(), std::memory_order_relaxed);
+    metrics.scansFailed.store(scanner.scansFailed(), std::memory_order_relaxed);
+    metrics.lastScanUs.store(scanner.lastScanDuration().count(), std::memory_order_relaxed);
+}
+
+/// Prometheus exposition for GET /metrics (runs on the metrics thread, per scrape)
+static std::string renderMetrics(const ShardedDetector& detector, const FusionEngine& fusion,
+    const RetentionManager& retention)
+{
+    PrometheusText text;
+
+    text.family("motion_samples_ingested_total", "counter", "Samples handed to the detector, by source");
+    metrics.samples.forEach([&](SymbolId source, std::uint64_t n)
+    {
+        text.sample("motion_samples_ingested_total", double(n), PrometheusText::label("source", symbols.name(source)));
+    });
+    text.family("motion_mqtt_messages_total", "counter", "MQTT messages received on motion/esp32/#");
+    text.sample("motion_mqtt_messages_total", double(metrics.mqttMessages.load(std::memory_order_relaxed)));
+    text.family("motion_mqtt_bad_payloads_total", "counter", "MQTT messages whose payload could not be decoded");
+    text.sample("motion_mqtt_bad_payloads_total", double(metrics.badPayloads.load(std::memory_order_relaxed)));
+
+    text.family("motion_scans_total", "counter", "Wi-Fi scans by result");
+    text.sample("motion_scans_total", double(metrics.scansCompleted.load(std::memory_order_relaxed)), "result=\"ok\"");
+    text.sample("motion_scans_total", double(metrics.scansFailed.load(std::memory_order_relaxed)), "result=\"failed\"");
+    text.family("motion_scan_duration_seconds", "gauge", "Wall time of the last completed Wi-Fi scan");
+    text.sample("motion_scan_duration_seconds", double(metrics.lastScanUs.load(std::memory_order_relaxed)) / 1e6);
+
+    const ShardedDetector::QueueStats mqtt = detector.queueStats(kMqttProducer);
+    const ShardedDetector::QueueStats scan = detector.queueStats(kScanProducer);
+    text.family("motion_queue_depth", "gauge", "Samples waiting for the detector workers, by producer");
+    text.sample("motion_queue_depth", double(mqtt.depth), "producer=\"mqtt\"");
+    text.sample("motion_queue_depth", double(scan.depth), "producer=\"scan\"");
+    text.family("motion_queue_dropped_total", "counter", "Samples dropped because a detector queue was full, by producer");
+    text.sample("motion_queue_dropped_total", double(mqtt.drops), "producer=\"mqtt\"");
+    text.sample("motion_queue_dropped_total", double(scan.drops), "producer=\"scan\"");
+
+    text.family("motion_sqlite_queue_depth", "gauge", "Rows waiting for the SQLite writer");
+    text.sample("motion_sqlite_queue_depth", double(db.queuedRows()));
+    text.family("motion_sqlite_rows_written_total", "counter", "Rows handled by the SQLite writer");
+    text.sample("motion_sqlite_rows_written_total", double(db.writtenRows()));
+    text.family("motion_sqlite_rows_dropped_total", "counter", "Rows dropped because the SQLite writer queue was full");
+    text.sample("motion_sqlite_rows_dropped_total", double(db.droppedRows()));
+    text.family("motion_sqlite_rows_failed_total", "counter", "Rows the SQLite writer failed to insert");
+    text.sample("motion_sqlite_rows_failed_total", double(db.failedRows()));
+    Histogram batches;
+    db.batchLatencySnapshot(batches);
+    text.histogram("motion_sqlite_batch_write_seconds", "Time to insert and commit one batch of rows", batches, 1e-6,
+        { 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0 });
+
+    const FusionTick fused = fusion.lastTick();
+    text.family("motion_fusion_links", "gauge", "Links weighing in on the last fusion tick");
+    text.sample("motion_fusion_links", double(fused.links));
+    text.family("motion_fusion_vote", "gauge", "Weighted share of links past the threshold, last fusion tick");
+    text.sample("motion_fusion_vote", fused.vote);
+    text.family("motion_fusion_score", "gauge", "Weighted mean deviation over the threshold (0..2), last fusion tick");
+    text.sample("motion_fusion_score", fused.score);
+    text.family("motion_fusion_coherence", "gauge", "Mean cross-link correlation of the deviations, last fusion tick");
+    text.sample("motion_fusion_coherence", fused.coherence);
+    text.family("motion_fusion_peak_zscore", "gauge", "Largest per-link z-score against its own window, last fusion tick");
+    text.sample("motion_fusion_peak_zscore", fused.peakZ);
+    Histogram ticks;
+    fusion.tickLatencySnapshot(ticks);
+    text.histogram("motion_fusion_tick_seconds", "Duration of one fusion tick", ticks, 1e-6,
+        { 0.00001, 0.000025, 0.00005, 0.0001, 0.00025, 0.0005, 0.001, 0.0025 });
+
+    text.family("motion_retention_rows_deleted_total", "counter", "Rows deleted by age, by table");
+    text.sample("motion_retention_rows_deleted_total", double(retention.deletedRows(RetentionTable::Measurements)),
+        "table=\"measurements\"");
+    text.sample("motion_retention_rows_deleted_total", double(retention.deletedRows(RetentionTable::Rollup1m)),
+        "table=\"rollup_1m\"");
+    text.family("motion_retention_reclaimed_bytes_total", "counter", "Bytes returned to the file system by incremental vacuum");
+    text.sample("motion_retention_reclaimed_bytes_total", double(retention.reclaimedBytes()));
+    text.family("motion_retention_busy_seconds_total", "counter", "Time the retention thread spent in the database");
+    text.sample("motion_retention_busy_seconds_total", double(retention.busyTime().count()) / 1e6);
+    Histogram steps;
+    retention.stepLatencySnapshot(steps);
+    text.histogram("motion_retention_step_seconds", "Duration of one retention delete or vacuum step", steps, 1e-6,
+        { 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1 });
+
+    text.family("motion_events_total", "counter", "Movement episodes started, by source");
+    metrics.motions.forEach([&](SymbolId source, std::uint64_t n)
+    {
+        text.sample("motion_events_total", double(n), PrometheusText::label("source", symbols.name(source)));
+    });
+    text.family("motion_tracked_links", "gauge", "(source, SSID) links tracked by the detector workers");
+    text.sample("motion_tracked_links", double(detector.trackedLinks()));
+
+    text.family("process_resident_memory_bytes", "gauge", "Resident memory size in bytes");
+    text.sample("process_resident_memory_bytes", double(processRssBytes()));
+    return text.str();
+}
+
+int main(int argc, char** argv)
+{
+    Config cfg;
+    if (!parseArgs(argc, argv, cfg))
+    {
+        return 1;
+    }
+
+    // 0) Open SQLite database and initialize schema (tables: measurements, motions, episodes)
     if (!db.open("motion_detector.db"))
     {
         std::cerr << "Cannot open SQLite DB\n";
@@ -94,16 +274,74 @@ int main()
         std::cerr << "Cannot initialize DB schema\n";
         return 1;
     }
+    // Batch inserts on a dedicated writer thread (up to 512 rows or 250 ms per transaction)
+    if (!db.startWriter(512, std::chrono::milliseconds(250)))
+    {
+        std::cerr << "Cannot start DB writer\n";
+        return 1;
+    }
+    if (!cfg.binlogDir.empty()
+        && !logger.openSegmentLog(cfg.binlogDir, static_cast<std::size_t>(cfg.binlogSegmentMb) << 20))
+    {
+        std::cerr << "Cannot open binary log in " << cfg.binlogDir << "\n";
+        return 1;
+    }
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+#if MOTION_INSTRUMENT
+    std::signal(SIGUSR1, onDumpSignal);
+#endif
+
+    // 1) Detector state is partitioned by source over cfg.workers threads; each
+    //    shard runs calibration + detection and then processSample() on its samples,
+    //    and processEpisode() when a link's movement starts and ends.
+    ShardedDetector::Options options;
+    options.workers = static_cast<std::size_t>(cfg.workerCount());
+    options.producers = 2;   // kMqttProducer, kScanProducer
+    options.calibrationSec = 30;
+    options.threshold = 10.0;   // RSSI threshold
+    options.maxLinks = static_cast<std::size_t>(cfg.maxLinks);
+    options.baseline = cfg.baseline;
+    options.episodes = cfg.episodes;
+    options.episodes.exitThreshold = std::min(options.episodes.exitThreshold, options.threshold);
+
+    // Cross-link fusion (--fusion-tick-ms): the shards push each sample's
+    // deviation, and every tick all links are resampled onto one grid point
+    FusionOptions fusionOptions;
+    fusionOptions.producers = options.workers;
+    fusionOptions.tickUs = std::int64_t(cfg.fusionTickMs) * 1000;
+    fusionOptions.threshold = options.threshold;
+    fusionOptions.minVote = cfg.fusionMinVote;
+    fusionOptions.maxLinks = static_cast<std::size_t>(cfg.maxLinks);
+    FusionEngine fusion(systemTime, fusionOptions, processFusion);
+    options.fusion = cfg.fusionTickMs > 0 ? &fusion : nullptr;
+    ShardedDetector detector(systemTime, options, processSample, processEpisode, flushSamples);
 
-    // 1) Initialize Mosquitto library and create a client.
-    //    We pass &detector as user_data so on_message can call detector->addSample(...) & isMovement...
+    // 1b) Age-based pruning of the database (--retention-days, --retention-1m-days)
+    //     in short steps on a low-priority thread
+    RetentionOptions retentionOptions;
+    retentionOptions.rawMaxAge = std::chrono::hours(24 * cfg.retentionDays);
+    retentionOptions.minuteMaxAge = std::chrono::hours(24 * cfg.retention1mDays);
+    RetentionManager retention(db, retentionOptions);
+    retention.start();
+
+    // 1c) Prometheus endpoint (--metrics-port), scraped on its own thread
+    MetricsServer metricsServer;
+    if (cfg.metricsPort > 0
+        && !metricsServer.start(cfg.metricsAddr, cfg.metricsPort,
+            [&detector, &fusion, &retention]() { return renderMetrics(detector, fusion, retention); }))
+    {
+        return 1;
+    }
+
+    // Initialize Mosquitto library and create a client.
+    // We pass &detector as user_data so on_message can hand decoded samples to the shards.
     mosquitto_lib_init();
-    MotionDetector detector(30 /* calibration seconds */, 10.0 /* RSSI threshold */);
 
     mosquitto* mosq = mosquitto_new(
         "motion_detector",   // client ID
         true,                // clean session
-        &detector            // user_data ? pointer to our MotionDetector
+        &detector            // user_data ? routes samples to the detector shards
     );
     if (!mosq)
     {
@@ -134,95 +372,122 @@ int main()
         }
     });
 
-    Scanner scanner;
+    // 2b) Start the detector workers; calibration starts now.
+    detector.start();
+    if (options.fusion)
+    {
+        fusion.start();
+    }
+
+    // Wi-Fi scans run as a child process read from poll(); BSS records are
+    // handed to the callbacks below as soon as the scan prints them.
+    ScanEngine scanner(cfg.scanCommand(), std::chrono::milliseconds(cfg.scanIntervalMs));
 
     // ---- 3) CALIBRATION: Collect samples from both Scanner (Raspberry) and MQTT (ESP) for 30 seconds ----
-    std::cout << "Calibrating for " << detector.getDuration()
-        << " seconds (collecting samples from Scanner + MQTT)..." << std::endl;
+    std::cout << "Calibrating for " << options.calibrationSec
+        << " seconds (collecting samples from Scanner + MQTT) on "
+        << detector.workers() << " workers..." << std::endl;
 
-    auto start = std::chrono::steady_clock::now();
-    while (std::chrono::steady_clock::now() - start
-        < std::chrono::seconds(detector.getDuration()))
+    while (running.load() && !detector.calibrated())
     {
-        // 3.1) Perform one Wi-Fi scan (Raspberry), add each measurement to the detector
-        auto batch = scanner.scan();
-        for (auto& m : batch)
+        // 3.1) Pump the Wi-Fi scan (Raspberry) into the detector
+        scanner.poll(std::chrono::milliseconds(100), [&](const Sample& m)
         {
-            detector.addSample(m);
-            logger.log(m);
-        }
+            metrics.samples.add(symbols.sourceOf(m.link));
+            detector.push(kScanProducer, m);
+        });
+        publishScanMetrics(scanner);
 
-        // 3.2) Optionally call mosquitto_loop(mosq, 0, 1) here if you want to pump
-        //      any pending MQTT packets immediately. mqttThread is already running
-        //      mosquitto_loop(-1,1), so this is not strictly required.
-        mosquitto_loop(mosq, 0, 1);
+        // 3.2) MQTT packets are pumped by mqttThread only: on_message must stay
+        //      the single kMqttProducer.
     }
 
-    // 4) After 30 seconds, compute per-(source,SSID) averages and print them
-    detector.computeAverages();
+    // 4) After 30 seconds every shard has computed its per-(source,SSID) averages; print them.
+    //    From here on the workers check every sample for movement.
     std::cout << "Calibration complete. Average RSSI per (source, SSID):" << std::endl;
-    for (auto& [key, avg] : detector.getAverages())
+    detector.forEachCalibratedLink([](const CalibratedLink& link)
     {
-        const auto& source = key.first;
-        const auto& ssid = key.second;
-        std::cout << "  Source = " << source
-            << "  SSID = " << ssid
-            << "  AvgRSSI = " << avg << std::endl;
-    }
+        std::cout << "  Source = " << symbols.source(link.link)
+            << "  SSID = " << symbols.ssid(link.link)
+            << "  AvgRSSI = " << link.mean
+            << "  StdDev = " << link.stddev
+            << "  Samples = " << link.count << std::endl;
+    });
     std::cout << std::string(40, '-') << std::endl;
 
-    // 5) Mark calibration as done so on_message() will start checking ESP samples for movement
-    calibrated.store(true);
-
-    // ---- 6) MAIN LOOP: Wi-Fi scanning (Raspberry) + movement detection for Raspberry ----
+    // ---- 6) MAIN LOOP: Wi-Fi scanning (Raspberry) ----
+    std::int64_t lastStatsUs = systemTime.monotonicUs();
+    std::int64_t lastLatencyUs = lastStatsUs;
+    Histogram latency;
     while (running.load())
     {
-        try
+        // 6.1) Pump the Wi-Fi scan; its shard logs each measurement and checks it for movement
+        scanner.poll(std::chrono::milliseconds(500), [&](const Sample& m)
         {
-            // 6.1) Perform a Wi-Fi scan, log each measurement, and check for movement
-            auto batch = scanner.scan();
-            for (auto& m : batch)
-            {
-                // Log to CSV, console, and measurements table
-                logger.log(m);
-
-                // Check for movement on Raspberry measurements only
-                if (detector.isMovement(m))
-                {
-                    std::cout << nowTimestamp()
-                        << " Movement! Source: " << m.source
-                        << " SSID: " << m.ssid
-                        << " RSSI = " << m.rssi << std::endl;
-
-                    // Save this Raspberry-based movement event
-                    if (!db.saveMotion("Movement detected", m.timeStamp, m.source, m.rssi))
-                    {
-                        std::cerr << "DB insert error (motion for Raspberry)" << std::endl;
-                    }
-                }
-            }
+            metrics.samples.add(symbols.sourceOf(m.link));
+            detector.push(kScanProducer, m);
+        });
+        publishScanMetrics(scanner);
 
-            /**
-             * 6.2) Any incoming ESP messages are handled asynchronously by on_message()
-             *      in the background mqttThread. Since calibrated == true, on_message()
-             *      will check ESP samples for movement and save them if needed.
-             *      You can optionally call mosquitto_loop(mosq, 0, 1) here to pump the
-             *      network I/O, but mqttThread already runs mosquitto_loop(-1,1).
-             */
+        /**
+         * 6.2) Any incoming ESP messages are decoded by on_message() in mqttThread
+         *      and processed by the worker of their topic's shard.
+         */
+
+        // 6.3) Report MQTT queue counters once a minute
+        if (systemTime.monotonicUs() - lastStatsUs >= 60 * 1000000)
+        {
+            printQueueStats(detector);
+            std::cout << "Scans: completed=" << scanner.scansCompleted()
+                << " failed=" << scanner.scansFailed()
+                << " last=" << scanner.lastScanDuration().count() / 1000 << " ms" << std::endl;
+#if MOTION_INSTRUMENT
+            dumpStagesRequested.store(true);
+#endif
+            lastStatsUs = systemTime.monotonicUs();
         }
-        catch (const std::exception& e)
+
+        // 6.4) Publish the publish-to-detection latencies of timestamped payloads
+        //      (motion_loadgen) once a second, as a cumulative histogram
+        if (systemTime.monotonicUs() - lastLatencyUs >= 1000000)
         {
-            std::cerr << "Scan error: " << e.what() << std::endl;
+            latency.clear();
+            detector.latencySnapshot(latency);
+            if (latency.total() > 0)
+            {
+                const std::string text = latency.encode();
+                mosquitto_publish(mosq, nullptr, "motion/stats/latency",
+                    static_cast<int>(text.size()), text.data(), 0, false);
+            }
+            lastLatencyUs = systemTime.monotonicUs();
         }
 
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+#if MOTION_INSTRUMENT
+        // 6.5) Per-stage latency histograms, once a minute and on SIGUSR1
+        if (dumpStagesRequested.exchange(false))
+        {
+            dumpStageLatencies(std::cout);
+        }
+#endif
     }
 
     // ---- 7) CLEANUP AND EXIT ----
     mosquitto_disconnect(mosq);
     running.store(false);
     mqttThread.join();
+    metricsServer.stop();
+    detector.stop();   // both producers have stopped: process what is queued
+    fusion.stop();
+    printQueueStats(detector);
     mosquitto_destroy(mosq);
     mosquitto_lib_cleanup();
+
+    // Commit everything still queued for the measurements/motions/episodes tables
+    retention.stop();
+    db.stopWriter();
+    logger.closeSegmentLog();
+#if MOTION_INSTRUMENT
+    dumpStageLatencies(std::cout);
+#endif
     return 0;
 }
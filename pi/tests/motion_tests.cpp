@@ -0,0 +1,405 @@
+// motion_tests.cpp
+// motion_tests: checks of motion_core that need no broker or Wi-Fi: the feature
+// kernels against the scalar reference (bit for bit), FusionEngine's
+// resampling, coherence and slot reuse, EpisodeTracker, and the SQLite
+// rollups and cursors. Exits non-zero on any failure (run by ctest).
+#include "EpisodeTracker.h"
+#include "FusionEngine.h"
+#include "LinkFeatures.h"
+#include "SQLiteDB.h"
+#include "SymbolTable.h"
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+    int failures = 0;
+
+    void check(bool ok, const std::string& what)
+    {
+        if (!ok)
+        {
+            std::cerr << "FAIL: " << what << "\n";
+            ++failures;
+        }
+    }
+
+    const FeatureKernel kKernels[] = { FeatureKernel::Scalar, FeatureKernel::Avx2, FeatureKernel::Neon };
+
+    /// Compute `table` with every supported kernel and compare each field of
+    /// the first `links` links with the scalar results, bit for bit
+    void checkKernelsAgree(LinkFeatureTable& table, std::size_t links, const char* what)
+    {
+        table.compute(FeatureKernel::Scalar);
+        std::vector<std::vector<float>> reference;
+        for (const float* f : { table.mean(), table.variance(), table.mad(), table.zscore(), table.min(), table.max() })
+        {
+            reference.emplace_back(f, f + links);
+        }
+        for (FeatureKernel k : kKernels)
+        {
+            if (k == FeatureKernel::Scalar || !featureKernelSupported(k))
+            {
+                continue;
+            }
+            table.compute(k);
+            std::size_t field = 0;
+            for (const float* f : { table.mean(), table.variance(), table.mad(), table.zscore(), table.min(), table.max() })
+            {
+                check(std::memcmp(f, reference[field].data(), links * sizeof(float)) == 0,
+                    std::string(what) + ": " + featureKernelName(k) + " field " + std::to_string(field)
+                    + " differs from the scalar reference");
+                ++field;
+            }
+        }
+        table.compute(FeatureKernel::Scalar);
+    }
+
+    void testFeatureKernels()
+    {
+        // RSSI-like windows, partly filled, flat and fresh links included
+        const std::size_t links = 1000;
+        LinkFeatureTable table(links, 16);
+        std::mt19937 rng(25);
+        std::normal_distribution<float> noise(0.0f, 3.0f);
+        for (std::size_t step = 0; step < 40; ++step)
+        {
+            for (std::size_t l = 0; l < links; ++l)
+            {
+                if (l % 10 == 3 && step > 0)
+                {
+                    continue;   // one sample only: a flat window
+                }
+                if (l % 10 == 7 && step < 35)
+                {
+                    continue;   // seen recently
+                }
+                table.push(l, -40.0f - float(l % 50) + noise(rng) * float(l % 4));
+            }
+        }
+        checkKernelsAgree(table, links, "random windows");
+        for (std::size_t l = 3; l < links; l += 10)
+        {
+            if (table.variance()[l] != 0.0f || table.zscore()[l] != 0.0f || table.mad()[l] != 0.0f
+                || table.min()[l] != table.max()[l])
+            {
+                check(false, "a one-sample window is not flat (link " + std::to_string(l) + ")");
+                break;
+            }
+        }
+    }
+
+    void testFlatWindows()
+    {
+        // the same value pushed over and over, for windows whose length is and
+        // is not a power of two: sd == 0, so the z-score must be 0 (no NaN/inf)
+        for (std::size_t window : { 16, 12, 5 })
+        {
+            LinkFeatureTable table(16, window);
+            const float values[] = { -87.3f, -40.0f, 0.0f, -0.0f, -33.33f, -99.9f, -1.0f, -64.1f };
+            for (std::size_t l = 0; l < 8; ++l)
+            {
+                for (std::size_t k = 0; k < 3 * window; ++k)
+                {
+                    table.push(l, values[l]);
+                }
+            }
+            const std::string what = "flat windows of " + std::to_string(window);
+            checkKernelsAgree(table, 8, what.c_str());
+            for (std::size_t l = 0; l < 8; ++l)
+            {
+                check(table.zscore()[l] == 0.0f && !std::signbit(table.zscore()[l]),
+                    what + ": z-score " + std::to_string(table.zscore()[l]) + " for constant " + std::to_string(values[l]));
+                check(table.min()[l] == values[l] && table.max()[l] == values[l],
+                    what + ": min/max differ from the constant " + std::to_string(values[l]));
+            }
+        }
+    }
+
+    void testSignedZeros()
+    {
+        // min/max of +0 and -0 compare equal; every kernel must keep the same one
+        LinkFeatureTable table(8, 4);
+        const float rings[4][2] = { { 0.0f, -0.0f }, { -0.0f, 0.0f }, { -0.0f, -0.0f }, { 0.0f, 0.0f } };
+        for (std::size_t l = 0; l < 4; ++l)
+        {
+            table.push(l, rings[l][0]);
+            table.push(l, rings[l][1]);
+        }
+        checkKernelsAgree(table, 8, "signed zeros");
+        for (std::size_t l = 0; l < 4; ++l)
+        {
+            // the ring starts with the first sample, which wins a tie
+            check(std::signbit(table.min()[l]) == std::signbit(rings[l][0])
+                && std::signbit(table.max()[l]) == std::signbit(rings[l][0]),
+                "signed zeros: link " + std::to_string(l) + " keeps the wrong zero");
+        }
+    }
+
+    void testFeatureReset()
+    {
+        LinkFeatureTable table(8, 4);
+        for (float x : { -40.0f, -60.0f, -50.0f })
+        {
+            table.push(2, x);
+        }
+        table.reset(2);
+        table.push(2, -70.0f);
+        table.compute();
+        check(table.mean()[2] == -70.0f && table.variance()[2] == 0.0f && table.min()[2] == -70.0f,
+            "reset() left old samples in the window");
+    }
+
+    void testFusion()
+    {
+        VirtualTime time;
+        FusionOptions options;
+        options.delayUs = 0;
+        const std::int64_t t0 = 1700000000000000;
+
+        // interpolation between a Pi scan's samples and the fading weight of a held sample
+        {
+            FusionEngine fusion(time, options);
+            const LinkId pi = symbols.link("pi", "fusion-test");
+            const LinkId esp = symbols.link("motion/esp32/test", "fusion-test");
+            fusion.push(0, Sample{ t0, pi, 0.0f }, 0.0f);
+            fusion.push(0, Sample{ t0 + 4000000, pi, 0.0f }, 20.0f);
+            fusion.push(0, Sample{ t0, esp, 0.0f }, 15.0f);
+            const FusionTick a = fusion.tick(t0 + 2000000);   // pi: 10 dB (no vote), esp: 15 dB held 2 s of 6
+            const FusionTick b = fusion.tick(t0 + 7000000);   // esp too old to count
+            check(a.links == 2 && a.votes == 1, "fusion: interpolated and held links not both counted");
+            check(std::fabs(a.score - (1.0f + 1.5f * (2.0f / 3.0f)) / (5.0f / 3.0f)) < 1e-5f,
+                "fusion: score " + std::to_string(a.score) + " does not weigh the held sample by its age");
+            check(b.links == 1 && b.votes == 1 && !b.movement, "fusion: a sample older than maxAgeUs still counts");
+        }
+
+        // links moving together are coherent
+        {
+            FusionEngine together(time, options);
+            const LinkId links[3] = { symbols.link("motion/esp32/a", "fusion-test"),
+                symbols.link("motion/esp32/b", "fusion-test"), symbols.link("motion/esp32/c", "fusion-test") };
+            FusionTick c;
+            for (int k = 0; k < 16; ++k)
+            {
+                const float dev = k % 4 < 2 ? 14.0f : 1.0f;
+                for (const LinkId link : links)
+                {
+                    together.push(0, Sample{ t0 + k * 500000, link, 0.0f }, dev);
+                }
+                c = together.tick(t0 + k * 500000);
+            }
+            check(c.links == 3 && c.coherence > 0.99f,
+                "fusion: coherence " + std::to_string(c.coherence) + " of links moving together");
+        }
+
+        // with every slot taken, a new link reuses the slot of one silent for maxAgeUs
+        {
+            FusionOptions small = options;
+            small.maxLinks = 8;
+            small.window = 4;
+            FusionEngine fusion(time, small);
+            LinkId links[10];
+            for (int i = 0; i < 10; ++i)
+            {
+                links[i] = symbols.link("motion/esp32/recycle", "SSID-" + std::to_string(i));
+            }
+            for (int i = 0; i < 9; ++i)
+            {
+                fusion.push(0, Sample{ t0, links[i], 0.0f }, 20.0f);
+            }
+            fusion.tick(t0);
+            check(fusion.links() == 8 && fusion.dropped() == 1 && fusion.recycled() == 0,
+                "fusion: a ninth live link was not dropped");
+
+            // links 1..7 keep reporting 1 dB, link 0 falls silent
+            for (int k = 1; k <= 14; ++k)
+            {
+                for (int i = 1; i < 8; ++i)
+                {
+                    fusion.push(0, Sample{ t0 + k * 500000, links[i], 0.0f }, 1.0f);
+                }
+                fusion.tick(t0 + k * 500000);
+            }
+            fusion.push(0, Sample{ t0 + 7000000, links[9], 0.0f }, 20.0f);
+            const FusionTick t = fusion.tick(t0 + 7000000);
+            check(fusion.recycled() == 1 && fusion.dropped() == 1, "fusion: the silent link's slot was not reused");
+            check(t.links == 8 && t.votes == 1,
+                "fusion: reused slot counts " + std::to_string(t.votes) + " votes of " + std::to_string(t.links) + " links");
+            check(t.peakZ == 0.0f, "fusion: reused slot kept the old link's window");
+        }
+    }
+
+    void testEpisodes()
+    {
+        // a one-sample spike is no episode, a 20 s walk whose samples alternate
+        // between past the threshold and past the exit level is one
+        EpisodeTracker tracker;
+        const LinkId link = symbols.link("motion/esp32/test", "walk");
+        std::size_t started = 0, ended = 0;
+        Episode last{};
+        auto fn = [&](const Episode& e, EpisodeTracker::Event event)
+        {
+            if (event == EpisodeTracker::Event::Started)
+            {
+                ++started;
+            }
+            else
+            {
+                ++ended;
+                last = e;
+            }
+        };
+        std::int64_t t = 1700000000000000;
+        auto feed = [&](int count, double a, double b)
+        {
+            for (int i = 0; i < count; ++i, t += 500000)
+            {
+                const double dev = i % 2 ? b : a;
+                tracker.observe(Sample{ t, link, float(-50.0 + dev) }, std::fabs(dev) > 10.0, dev, fn);
+            }
+        };
+        feed(1, 12.0, 12.0);
+        feed(20, 1.0, -1.0);
+        feed(40, -12.0, -7.0);
+        feed(20, 1.0, -1.0);
+        tracker.closeAll(fn);
+        check(started == 1 && ended == 1, "episodes: " + std::to_string(started) + " started, "
+            + std::to_string(ended) + " ended instead of one");
+        check(last.samples == 40 && last.endUs - last.startUs == 19500000 && last.peakDeviation == -12.0f,
+            "episodes: the walk is not one 19.5 s episode of 40 samples peaking at -12 dB");
+    }
+
+    void testSQLite(const std::string& dir)
+    {
+        SQLiteDB db;
+        const std::string path = dir + "/test.db";
+        if (!db.open(path) || !db.initSchema() || !db.startWriter(512, std::chrono::milliseconds(50), 1u << 20))
+        {
+            check(false, "sqlite: cannot open " + path);
+            return;
+        }
+
+        // 8 links, one sample each per 0.5 s for 10 minutes, straddling minute boundaries
+        const std::int64_t t0 = 1700000000000000 + 17000000;
+        std::vector<LinkId> links;
+        for (int i = 0; i < 8; ++i)
+        {
+            links.push_back(symbols.link("motion/esp32/db", "SSID-" + std::to_string(i)));
+        }
+        std::mt19937 rng(9);
+        std::normal_distribution<float> noise(0.0f, 2.0f);
+        std::vector<Sample> samples;
+        for (std::int64_t k = 0; k < 1200; ++k)
+        {
+            for (std::size_t l = 0; l < links.size(); ++l)
+            {
+                samples.push_back(Sample{ t0 + k * 500000 + std::int64_t(l), links[l], -50.0f - float(l) + noise(rng) });
+            }
+        }
+        db.enqueueSignals(samples.data(), samples.size());
+        db.flush();
+        const std::int64_t end = samples.back().tsUs + 1;
+
+        // every row lands in rollup_1m
+        std::uint64_t rawRows = 0, rollupRows = 0;
+        double rawSum = 0.0, rollupSum = 0.0;
+        db.forEachSignal(t0, end, [&](std::int64_t, std::string_view, std::string_view, double rssi)
+        {
+            ++rawRows;
+            rawSum += rssi;
+        });
+        db.forEachRollup(RollupResolution::Minute, t0, end, [&](const RollupRow& r)
+        {
+            rollupRows += r.count;
+            rollupSum += r.mean * double(r.count);
+        });
+        check(rawRows == samples.size(), "sqlite: " + std::to_string(rawRows) + " rows read back of "
+            + std::to_string(samples.size()));
+        check(rollupRows == rawRows, "sqlite: rollup_1m counts " + std::to_string(rollupRows)
+            + " rows, measurements hold " + std::to_string(rawRows));
+        check(std::fabs(rollupSum - rawSum) < 1e-6 * std::fabs(rawSum), "sqlite: rollup_1m means do not add up");
+
+        // the same rows through a cursor, in keyset pages of 1000 (the last one short)
+        RangeQuery q;
+        q.fromUs = t0;
+        q.toUs = end;
+        q.limit = 1000;
+        std::uint64_t paged = 0;
+        std::int64_t lastTs = std::numeric_limits<std::int64_t>::min();
+        bool ordered = true;
+        for (;;)
+        {
+            SignalCursor cursor = db.openSignals(q);
+            SignalRow row;
+            std::size_t page = 0;
+            while (cursor.next(row))
+            {
+                ordered = ordered && row.key.tsUs >= lastTs;
+                lastTs = row.key.tsUs;
+                ++page;
+            }
+            paged += page;
+            if (page < q.limit)
+            {
+                break;
+            }
+            q.after = cursor.lastKey();
+        }
+        check(paged == rawRows, "sqlite: pages hold " + std::to_string(paged) + " of the " + std::to_string(rawRows) + " rows");
+        check(ordered, "sqlite: pages are not in timestamp order");
+
+        // a source filter on the cursor
+        RangeQuery one;
+        one.fromUs = t0;
+        one.toUs = end;
+        one.ssid = "SSID-3";
+        std::uint64_t ssidRows = 0;
+        SignalCursor cursor = db.openSignals(one);
+        SignalRow row;
+        while (cursor.next(row))
+        {
+            ssidRows += row.ssid == "SSID-3";
+        }
+        check(ssidRows == 1200, "sqlite: the SSID filter returned " + std::to_string(ssidRows) + " of 1200 rows");
+
+        db.stopWriter();
+        for (const char* f : { "/test.db", "/test.db-wal", "/test.db-shm" })
+        {
+            unlink((dir + f).c_str());
+        }
+    }
+}
+
+int main()
+{
+    testFeatureKernels();
+    testFlatWindows();
+    testSignedZeros();
+    testFeatureReset();
+    testFusion();
+    testEpisodes();
+
+    char tmpl[] = "/tmp/motion_tests.XXXXXX";
+    if (const char* dir = mkdtemp(tmpl))
+    {
+        testSQLite(dir);
+        rmdir(dir);
+    }
+    else
+    {
+        check(false, "cannot create a scratch directory");
+    }
+
+    if (failures)
+    {
+        std::cerr << failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << "motion_tests: all checks passed\n";
+    return 0;
+}
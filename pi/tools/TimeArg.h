@@ -0,0 +1,27 @@
+// TimeArg.h
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+
+/// Parse a command-line time, "YYYY-MM-DD HH:MM:SS" (local time) or seconds since
+/// the epoch, into microseconds since the epoch
+inline bool parseTimeArg(const char* text, std::int64_t& us)
+{
+    std::tm tm{};
+    const char* end = strptime(text, "%Y-%m-%d %H:%M:%S", &tm);
+    if (end && *end == '\0')
+    {
+        tm.tm_isdst = -1;
+        us = static_cast<std::int64_t>(std::mktime(&tm)) * 1000000;
+        return true;
+    }
+    char* e = nullptr;
+    double sec = std::strtod(text, &e);
+    if (e == text || *e != '\0')
+    {
+        return false;
+    }
+    us = static_cast<std::int64_t>(sec * 1e6);
+    return true;
+}
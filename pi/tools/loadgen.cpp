@@ -0,0 +1,284 @@
+// loadgen.cpp
+// motion_loadgen: synthetic MQTT load for motion_detector. Simulates N ESP32
+// publishers on motion/esp32/<id>, each sending "SSID,RSSI,@sendUs" at a fixed
+// rate with jitter and occasional motion bursts, then reads back the
+// publish-to-detection latencies the Pi publishes on motion/stats/latency.
+#include "Histogram.h"
+#include <mosquitto.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    void usage(const char* argv0)
+    {
+        std::cerr << "Usage: " << argv0 << " [options]\n"
+            << "  --host=HOST         broker (default localhost)\n"
+            << "  --port=N            broker port (default 1883)\n"
+            << "  --publishers=N      simulated ESP32 boards (default 10)\n"
+            << "  --first-id=N        id of the first board, topic motion/esp32/<id> (default 100)\n"
+            << "  --ssids=N           networks reported per board and round (default 1)\n"
+            << "  --rate=HZ           rounds per second per board (default 2, like the ESP32 sketch)\n"
+            << "  --jitter=F          random spread of the send interval, fraction of it (default 0.2)\n"
+            << "  --duration=S        seconds of load (default 30)\n"
+            << "  --burst-every=S     start a motion burst every S seconds, 0 = none (default 10)\n"
+            << "  --burst-len=S       length of a burst (default 2)\n"
+            << "  --burst-share=F     fraction of the boards that see a burst (default 0.25)\n"
+            << "  --burst-db=DB       RSSI swing during a burst (default 15)\n"
+            << "  --qos=0|1           MQTT QoS of the samples (default 0)\n"
+            << "  --settle=S          wait at most S seconds for the Pi to catch up (default 5)\n";
+    }
+
+    std::int64_t wallMicros()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    /// Latest cumulative histogram received on motion/stats/latency
+    struct LatencyFeed
+    {
+        std::mutex              mu;
+        std::condition_variable cv;
+        Histogram               latest;
+        std::uint64_t           updates = 0;
+    };
+
+    void onMessage(struct mosquitto*, void* userData, const struct mosquitto_message* msg)
+    {
+        LatencyFeed& feed = *static_cast<LatencyFeed*>(userData);
+        Histogram h;
+        if (!h.decode(std::string_view(static_cast<const char*>(msg->payload),
+            static_cast<std::size_t>(msg->payloadlen))))
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(feed.mu);
+        feed.latest = h;
+        ++feed.updates;
+        feed.cv.notify_all();
+    }
+
+    /// Wait for the next histogram update (or the deadline); returns a copy of the latest one
+    Histogram nextUpdate(LatencyFeed& feed, Clock::time_point deadline)
+    {
+        std::unique_lock<std::mutex> lock(feed.mu);
+        const std::uint64_t seen = feed.updates;
+        feed.cv.wait_until(lock, deadline, [&]() { return feed.updates != seen; });
+        return feed.latest;
+    }
+
+    struct Board
+    {
+        std::string        topic;
+        std::vector<float> baseRssi;   ///< per SSID
+        Clock::time_point  next;
+        bool               bursting = false;
+    };
+}
+
+int main(int argc, char** argv)
+{
+    std::string host = "localhost";
+    int port = 1883, publishers = 10, firstId = 100, ssids = 1, qos = 0;
+    double rate = 2.0, jitter = 0.2, duration = 30.0, settle = 5.0;
+    double burstEvery = 10.0, burstLen = 2.0, burstShare = 0.25, burstDb = 15.0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const std::size_t eq = arg.find('=');
+        const std::string key = arg.substr(0, eq);
+        const char* text = eq == std::string::npos ? "" : argv[i] + eq + 1;
+        char* end = nullptr;
+        const double v = std::strtod(text, &end);
+        const bool number = *text != '\0' && *end == '\0';
+        bool ok = true;
+        if (key == "--host" && *text)
+        {
+            host = text;
+        }
+        else if (!number)
+        {
+            ok = false;
+        }
+        else if (key == "--port") port = static_cast<int>(v);
+        else if (key == "--publishers") publishers = static_cast<int>(v);
+        else if (key == "--first-id") firstId = static_cast<int>(v);
+        else if (key == "--ssids") ssids = static_cast<int>(v);
+        else if (key == "--rate") rate = v;
+        else if (key == "--jitter") jitter = v;
+        else if (key == "--duration") duration = v;
+        else if (key == "--burst-every") burstEvery = v;
+        else if (key == "--burst-len") burstLen = v;
+        else if (key == "--burst-share") burstShare = v;
+        else if (key == "--burst-db") burstDb = v;
+        else if (key == "--qos") qos = static_cast<int>(v);
+        else if (key == "--settle") settle = v;
+        else ok = false;
+
+        if (!ok || publishers < 1 || ssids < 1 || rate <= 0.0 || jitter < 0.0 || jitter >= 1.0 || qos < 0 || qos > 1)
+        {
+            std::cerr << "Bad option: " << arg << "\n";
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    LatencyFeed feed;
+    mosquitto_lib_init();
+    mosquitto* mosq = mosquitto_new(nullptr, true, &feed);
+    if (!mosq)
+    {
+        std::cerr << "Failed to create mosquitto client\n";
+        return 1;
+    }
+    mosquitto_message_callback_set(mosq, onMessage);
+    if (mosquitto_connect(mosq, host.c_str(), port, 60) != MOSQ_ERR_SUCCESS)
+    {
+        std::cerr << "Cannot connect to MQTT broker at " << host << ":" << port << "\n";
+        mosquitto_destroy(mosq);
+        mosquitto_lib_cleanup();
+        return 1;
+    }
+    mosquitto_subscribe(mosq, nullptr, "motion/stats/latency", 0);
+    mosquitto_loop_start(mosq);
+
+    // Baseline of the Pi's cumulative histogram (it publishes once a second, if non-empty)
+    const Histogram before = nextUpdate(feed, Clock::now() + std::chrono::milliseconds(1500));
+
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::normal_distribution<float> noise(0.0f, 1.5f);
+
+    const auto interval = std::chrono::duration<double>(1.0 / rate);
+    const auto start = Clock::now();
+    std::vector<Board> boards(static_cast<std::size_t>(publishers));
+    for (std::size_t b = 0; b < boards.size(); ++b)
+    {
+        boards[b].topic = "motion/esp32/" + std::to_string(firstId + static_cast<int>(b));
+        for (int k = 0; k < ssids; ++k)
+        {
+            boards[b].baseRssi.push_back(-45.0f - float((b * 7 + std::size_t(k) * 13) % 40));
+        }
+        // spread the boards over the first interval
+        boards[b].next = start + std::chrono::duration_cast<Clock::duration>(interval * unit(rng));
+    }
+
+    // earliest board first
+    auto later = [&](std::size_t a, std::size_t b) { return boards[a].next > boards[b].next; };
+    std::priority_queue<std::size_t, std::vector<std::size_t>, decltype(later)> schedule(later);
+    for (std::size_t b = 0; b < boards.size(); ++b)
+    {
+        schedule.push(b);
+    }
+
+    const auto stopAt = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(duration));
+    std::uint64_t sent = 0, publishErrors = 0, bursts = 0;
+    long burstIndex = -1;
+    char payload[128];
+    while (!schedule.empty())
+    {
+        const std::size_t b = schedule.top();
+        schedule.pop();
+        Board& board = boards[b];
+        if (board.next >= stopAt)
+        {
+            continue;
+        }
+        std::this_thread::sleep_until(board.next);
+
+        // motion bursts: a new random share of the boards every burst-every seconds
+        const double t = std::chrono::duration<double>(board.next - start).count();
+        if (burstEvery > 0.0)
+        {
+            const long index = static_cast<long>(t / burstEvery);
+            if (index != burstIndex)
+            {
+                burstIndex = index;
+                ++bursts;
+                for (Board& other : boards)
+                {
+                    other.bursting = unit(rng) < burstShare;
+                }
+            }
+            board.bursting = board.bursting && t - double(index) * burstEvery < burstLen;
+        }
+
+        for (int k = 0; k < ssids; ++k)
+        {
+            float rssi = board.baseRssi[std::size_t(k)] + noise(rng);
+            if (board.bursting)
+            {
+                rssi += float(unit(rng) < 0.5 ? -burstDb : burstDb);
+            }
+            const int len = std::snprintf(payload, sizeof(payload), "LoadGen-%d,%d,@%lld",
+                k, static_cast<int>(std::lround(std::clamp(rssi, -100.0f, -1.0f))),
+                static_cast<long long>(wallMicros()));
+            if (mosquitto_publish(mosq, nullptr, board.topic.c_str(), len, payload, qos, false) == MOSQ_ERR_SUCCESS)
+            {
+                ++sent;
+            }
+            else
+            {
+                ++publishErrors;
+            }
+        }
+
+        const double spread = 1.0 + jitter * (2.0 * unit(rng) - 1.0);
+        board.next += std::chrono::duration_cast<Clock::duration>(interval * spread);
+        schedule.push(b);
+    }
+    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Wait for the Pi to report every sample (or give up after --settle seconds)
+    Histogram delta;
+    const auto settleUntil = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(settle));
+    do
+    {
+        delta = nextUpdate(feed, settleUntil);
+        delta.subtract(before);
+    } while (delta.total() < sent && Clock::now() < settleUntil);
+
+    mosquitto_disconnect(mosq);
+    mosquitto_loop_stop(mosq, false);
+    mosquitto_destroy(mosq);
+    mosquitto_lib_cleanup();
+
+    const std::uint64_t detected = std::min(delta.total(), sent);
+    std::cout << "Load: " << publishers << " publishers x " << ssids << " SSIDs at " << rate << " Hz, "
+        << bursts << " bursts\n"
+        << "Sent: " << sent << " in " << elapsed << " s = " << (elapsed > 0.0 ? double(sent) / elapsed : 0.0)
+        << " msgs/s (publish errors: " << publishErrors << ")\n"
+        << "Detected: " << detected << "  dropped: " << sent - detected;
+    if (sent)
+    {
+        std::cout << " (" << 100.0 * double(sent - detected) / double(sent) << "%)";
+    }
+    std::cout << "\n";
+    if (delta.total() == 0)
+    {
+        std::cout << "Latency: no reports on motion/stats/latency (is motion_detector running?)\n";
+        return 1;
+    }
+    std::cout << "Latency publish->detection: p50=" << double(delta.percentile(0.50)) / 1000.0
+        << " ms  p99=" << double(delta.percentile(0.99)) / 1000.0
+        << " ms  p999=" << double(delta.percentile(0.999)) / 1000.0 << " ms\n";
+    return 0;
+}
@@ -0,0 +1,114 @@
+// logdump.cpp
+// motion_logdump: print or summarize the samples of a binary segment log
+// (written by motion_detector --binlog-dir=DIR) in a time range.
+#include "SegmentLog.h"
+#include "TimeArg.h"
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <string>
+#include <tuple>
+
+namespace
+{
+    void usage(const char* argv0)
+    {
+        std::cerr << "Usage: " << argv0 << " DIR [--from=TIME] [--to=TIME] [--stats]\n"
+            << "  TIME is \"YYYY-MM-DD HH:MM:SS\" (local time) or seconds since the epoch.\n"
+            << "  Prints timestamp,source,ssid,rssi lines, or with --stats one line per link.\n";
+    }
+
+    struct LinkSummary
+    {
+        std::uint64_t count = 0;
+        double        sum = 0.0;
+        float         min = std::numeric_limits<float>::max();
+        float         max = std::numeric_limits<float>::lowest();
+    };
+}
+
+int main(int argc, char** argv)
+{
+    std::string dir;
+    std::int64_t from = std::numeric_limits<std::int64_t>::min();
+    std::int64_t to = std::numeric_limits<std::int64_t>::max();
+    bool stats = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        bool ok = true;
+        if (std::strncmp(arg, "--from=", 7) == 0)
+        {
+            ok = parseTimeArg(arg + 7, from);
+        }
+        else if (std::strncmp(arg, "--to=", 5) == 0)
+        {
+            ok = parseTimeArg(arg + 5, to);
+        }
+        else if (std::strcmp(arg, "--stats") == 0)
+        {
+            stats = true;
+        }
+        else if (arg[0] != '-' && dir.empty())
+        {
+            dir = arg;
+        }
+        else
+        {
+            ok = false;
+        }
+        if (!ok)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (dir.empty())
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // (source, ssid) -> summary; link ids are only meaningful within one segment
+    std::map<std::pair<std::string, std::string>, LinkSummary> summaries;
+    std::uint64_t total = 0;
+    TimestampFormatter formatter;
+    char ts[TimestampFormatter::kLength + 1];
+
+    for (const std::string& path : listSegments(dir))
+    {
+        SegmentReader reader;
+        if (!reader.open(path))
+        {
+            continue;
+        }
+        total += reader.scan(from, to, [&](const SegmentRecord& r)
+        {
+            if (stats)
+            {
+                LinkSummary& s = summaries[{ std::string(reader.source(r.link)), std::string(reader.ssid(r.link)) }];
+                ++s.count;
+                s.sum += r.rssi;
+                s.min = std::min(s.min, r.rssi);
+                s.max = std::max(s.max, r.rssi);
+                return;
+            }
+            formatter.format(r.tsUs, ts);
+            std::cout << ts << ',' << reader.source(r.link) << ',' << reader.ssid(r.link)
+                << ',' << r.rssi << '\n';
+        });
+    }
+
+    if (stats)
+    {
+        std::cout << "source,ssid,count,mean,min,max\n";
+        for (const auto& [key, s] : summaries)
+        {
+            std::cout << key.first << ',' << key.second << ',' << s.count << ','
+                << s.sum / static_cast<double>(s.count) << ',' << s.min << ',' << s.max << '\n';
+        }
+    }
+    std::cerr << total << " samples\n";
+    return 0;
+}
@@ -0,0 +1,442 @@
+// replay.cpp
+// motion_replay: feed recorded measurements through the motion_detector
+// calibration + detection path under a virtual clock, as fast as possible,
+// for one or more detector configurations side by side.
+#include "MotionPipeline.h"
+#include "SQLiteDB.h"
+#include "SegmentLog.h"
+#include "TimeArg.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    void usage(const char* argv0)
+    {
+        std::cerr << "Usage: " << argv0 << " INPUT [options]\n"
+            << "INPUT (one of):\n"
+            << "  --db=FILE         measurements table of a motion_detector database\n"
+            << "  --csv=FILE        log.csv written by motion_detector\n"
+            << "  --binlog=DIR      binary segment log (--binlog-dir)\n"
+            << "Options:\n"
+            << "  --from=TIME --to=TIME   replay only this range (\"YYYY-MM-DD HH:MM:SS\" or epoch seconds)\n"
+            << "  --detector=NAME[:key=value,...]   add a detector configuration (repeatable);\n"
+            << "        keys: calib-s, threshold, max-links, baseline (frozen|ewma|window), alpha, window, relearn\n"
+            << "        default: one detector \"default\" with motion_detector's settings\n"
+            << "  --out=FILE        motion events as CSV: detector,timestamp,source,ssid,rssi (default: stdout)\n";
+    }
+
+    struct DetectorSpec
+    {
+        std::string    name;
+        int            calibrationSec = 30;
+        double         threshold = 10.0;
+        int            maxLinks = 4096;
+        BaselineConfig baseline;
+    };
+
+    /// Parse "NAME[:key=value,...]"
+    bool parseDetector(const std::string& text, DetectorSpec& spec)
+    {
+        const std::size_t colon = text.find(':');
+        spec.name = text.substr(0, colon);
+        if (spec.name.empty())
+        {
+            return false;
+        }
+        std::size_t pos = colon == std::string::npos ? text.size() : colon + 1;
+        while (pos < text.size())
+        {
+            std::size_t comma = text.find(',', pos);
+            if (comma == std::string::npos)
+            {
+                comma = text.size();
+            }
+            const std::string item = text.substr(pos, comma - pos);
+            pos = comma + 1;
+            const std::size_t eq = item.find('=');
+            if (eq == std::string::npos)
+            {
+                return false;
+            }
+            const std::string key = item.substr(0, eq);
+            const std::string value = item.substr(eq + 1);
+            char* end = nullptr;
+            const double number = std::strtod(value.c_str(), &end);
+            const bool isNumber = !value.empty() && *end == '\0';
+            if (key == "baseline")
+            {
+                if (!parseBaselineMode(value, spec.baseline.mode))
+                {
+                    return false;
+                }
+            }
+            else if (!isNumber || number < 0)
+            {
+                return false;
+            }
+            else if (key == "calib-s")
+            {
+                spec.calibrationSec = static_cast<int>(number);
+            }
+            else if (key == "threshold")
+            {
+                spec.threshold = number;
+            }
+            else if (key == "max-links" && number >= 1)
+            {
+                spec.maxLinks = static_cast<int>(number);
+            }
+            else if (key == "alpha" && number > 0 && number <= 1)
+            {
+                spec.baseline.alpha = number;
+            }
+            else if (key == "window" && number >= 1)
+            {
+                spec.baseline.window = static_cast<std::uint32_t>(number);
+            }
+            else if (key == "relearn")
+            {
+                spec.baseline.relearn = static_cast<std::uint32_t>(number);
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// Local "YYYY-MM-DD HH:MM:SS[.fff]" -> epoch microseconds. mktime() is only
+    /// called when the minute changes.
+    class CsvTimeParser
+    {
+    public:
+        bool parse(std::string_view text, std::int64_t& us)
+        {
+            if (text.size() < 19 || text[16] != ':')
+            {
+                return false;
+            }
+            if (text.compare(0, 16, minute_) != 0)
+            {
+                std::tm tm{};
+                const std::string head(text.substr(0, 16));
+                const char* end = strptime(head.c_str(), "%Y-%m-%d %H:%M", &tm);
+                if (!end || *end != '\0')
+                {
+                    return false;
+                }
+                tm.tm_isdst = -1;
+                minuteUs_ = static_cast<std::int64_t>(std::mktime(&tm)) * 1000000;
+                minute_ = head;
+            }
+            const int sec = (text[17] - '0') * 10 + (text[18] - '0');
+            std::int64_t frac = 0;
+            std::int64_t scale = 1000000;
+            if (text.size() > 20 && text[19] == '.')
+            {
+                for (std::size_t i = 20; i < text.size() && scale > 1; ++i)
+                {
+                    scale /= 10;
+                    frac += (text[i] - '0') * scale;
+                }
+            }
+            us = minuteUs_ + sec * 1000000 + frac;
+            return true;
+        }
+
+    private:
+        std::string  minute_;
+        std::int64_t minuteUs_ = 0;
+    };
+
+    /// Replays samples through every configured pipeline and writes their motion events
+    class Replayer
+    {
+    public:
+        Replayer(const std::vector<DetectorSpec>& specs, std::ostream& out)
+            : specs_(specs), out_(out)
+        {
+            for (const DetectorSpec& spec : specs_)
+            {
+                pipelines_.emplace_back(new MotionPipeline(time_, spec.calibrationSec, spec.threshold,
+                    static_cast<std::size_t>(spec.maxLinks), spec.baseline));
+            }
+            events_.assign(specs_.size(), 0);
+            out_ << "detector,timestamp,source,ssid,rssi\n";
+        }
+
+        void feed(const Sample& m)
+        {
+            if (m.link == SymbolTable::kNoLink)
+            {
+                return;   // SymbolTable full
+            }
+            if (samples_++ == 0)
+            {
+                time_.set(m.tsUs);
+                for (auto& p : pipelines_)
+                {
+                    p->start();
+                }
+                firstUs_ = m.tsUs;
+            }
+            time_.advanceTo(m.tsUs);
+            lastUs_ = time_.nowUs();
+            for (std::size_t i = 0; i < pipelines_.size(); ++i)
+            {
+                MotionPipeline& p = *pipelines_[i];
+                p.tick();
+                if (p.process(m))
+                {
+                    ++events_[i];
+                    formatter_.format(m.tsUs, ts_);
+                    out_ << specs_[i].name << ',' << ts_ << ',' << symbols.source(m.link) << ','
+                        << symbols.ssid(m.link) << ',' << m.rssi << '\n';
+                }
+            }
+        }
+
+        void report(double seconds) const
+        {
+            const double hours = (lastUs_ - firstUs_) / 3.6e9;
+            std::fprintf(stderr, "%llu samples, %.1f h of recording, replayed in %.2f s (%.0f samples/s, %.0fx real time)\n",
+                static_cast<unsigned long long>(samples_), hours, seconds,
+                samples_ / std::max(seconds, 1e-9), hours * 3600 / std::max(seconds, 1e-9));
+            std::fprintf(stderr, "%-20s %10s %12s %10s\n", "detector", "links", "events", "events/h");
+            for (std::size_t i = 0; i < pipelines_.size(); ++i)
+            {
+                const std::size_t links = pipelines_[i]->detector().getLinks().size();
+                std::fprintf(stderr, "%-20s %10zu %12llu %10.1f\n", specs_[i].name.c_str(), links,
+                    static_cast<unsigned long long>(events_[i]), hours > 0 ? events_[i] / hours : 0.0);
+            }
+        }
+
+    private:
+        const std::vector<DetectorSpec>& specs_;
+        std::ostream&                    out_;
+        VirtualTime                      time_;
+        std::vector<std::unique_ptr<MotionPipeline>> pipelines_;
+        std::vector<std::uint64_t>       events_;
+        std::uint64_t                    samples_ = 0;
+        std::int64_t                     firstUs_ = 0;
+        std::int64_t                     lastUs_ = 0;
+        TimestampFormatter               formatter_;
+        char                             ts_[TimestampFormatter::kLength + 1];
+    };
+
+    /// The last link looked up, so runs of one (source, SSID) skip the SymbolTable
+    struct LinkCache
+    {
+        std::string source, ssid;
+        LinkId      link = 0;
+        bool        valid = false;
+
+        LinkId get(std::string_view src, std::string_view id)
+        {
+            if (!valid || src != source || id != ssid)
+            {
+                source.assign(src.data(), src.size());
+                ssid.assign(id.data(), id.size());
+                link = symbols.link(src, id);
+                valid = true;
+            }
+            return link;
+        }
+    };
+
+    bool replayDb(const std::string& path, std::int64_t from, std::int64_t to, Replayer& replay)
+    {
+        SQLiteDB db;
+        if (!db.openReadOnly(path))
+        {
+            return false;
+        }
+        LinkCache cache;
+        return db.forEachSignal(from, to, [&](std::int64_t tsUs, std::string_view source,
+            std::string_view ssid, double rssi)
+        {
+            replay.feed(Sample{ tsUs, cache.get(source, ssid), static_cast<float>(rssi) });
+        });
+    }
+
+    bool replayCsv(const std::string& path, std::int64_t from, std::int64_t to, Replayer& replay)
+    {
+        std::ifstream in(path);
+        if (!in)
+        {
+            std::cerr << "Cannot open " << path << "\n";
+            return false;
+        }
+        CsvTimeParser times;
+        LinkCache cache;
+        std::string line;
+        std::uint64_t bad = 0;
+        std::getline(in, line);   // header
+        while (std::getline(in, line))
+        {
+            // timestamp,source,ssid,rssi (the SSID may itself contain commas)
+            const std::string_view row(line);
+            const std::size_t c1 = row.find(',');
+            const std::size_t c2 = c1 == std::string_view::npos ? c1 : row.find(',', c1 + 1);
+            const std::size_t c3 = row.rfind(',');
+            std::int64_t tsUs = 0;
+            if (c2 == std::string_view::npos || c3 <= c2 || !times.parse(row.substr(0, c1), tsUs))
+            {
+                ++bad;
+                continue;
+            }
+            char* end = nullptr;
+            const std::string rssiText(row.substr(c3 + 1));
+            const double rssi = std::strtod(rssiText.c_str(), &end);
+            if (end == rssiText.c_str())
+            {
+                ++bad;
+                continue;
+            }
+            if (tsUs < from || tsUs >= to)
+            {
+                continue;
+            }
+            replay.feed(Sample{ tsUs, cache.get(row.substr(c1 + 1, c2 - c1 - 1), row.substr(c2 + 1, c3 - c2 - 1)),
+                static_cast<float>(rssi) });
+        }
+        if (bad)
+        {
+            std::cerr << bad << " malformed CSV lines skipped\n";
+        }
+        return true;
+    }
+
+    bool replayBinlog(const std::string& dir, std::int64_t from, std::int64_t to, Replayer& replay)
+    {
+        const std::vector<std::string> segments = listSegments(dir);
+        if (segments.empty())
+        {
+            std::cerr << "No segments in " << dir << "\n";
+            return false;
+        }
+        for (const std::string& path : segments)
+        {
+            SegmentReader reader;
+            if (!reader.open(path))
+            {
+                continue;
+            }
+            // link ids are per-process: map this segment's ids into our SymbolTable
+            std::vector<LinkId> links;
+            reader.scan(from, to, [&](const SegmentRecord& r)
+            {
+                if (r.link >= links.size())
+                {
+                    links.resize(r.link + 1, SymbolTable::kMaxLinks);
+                }
+                if (links[r.link] == SymbolTable::kMaxLinks)
+                {
+                    links[r.link] = symbols.link(reader.source(r.link), reader.ssid(r.link));
+                }
+                replay.feed(Sample{ r.tsUs, links[r.link], r.rssi });
+            });
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string dbPath, csvPath, binlogDir, outPath;
+    std::int64_t from = std::numeric_limits<std::int64_t>::min();
+    std::int64_t to = std::numeric_limits<std::int64_t>::max();
+    std::vector<DetectorSpec> specs;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        auto value = [&](const char* prefix, std::string& out)
+        {
+            const std::size_t n = std::strlen(prefix);
+            if (arg.compare(0, n, prefix) != 0)
+            {
+                return false;
+            }
+            out = arg.substr(n);
+            return true;
+        };
+        std::string text;
+        bool ok = true;
+        if (value("--db=", dbPath) || value("--csv=", csvPath) || value("--binlog=", binlogDir)
+            || value("--out=", outPath))
+        {
+        }
+        else if (value("--from=", text))
+        {
+            ok = parseTimeArg(text.c_str(), from);
+        }
+        else if (value("--to=", text))
+        {
+            ok = parseTimeArg(text.c_str(), to);
+        }
+        else if (value("--detector=", text))
+        {
+            specs.emplace_back();
+            ok = parseDetector(text, specs.back());
+        }
+        else
+        {
+            ok = false;
+        }
+        if (!ok)
+        {
+            std::cerr << "Bad option: " << arg << "\n";
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (dbPath.empty() + csvPath.empty() + binlogDir.empty() != 2)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    if (specs.empty())
+    {
+        DetectorSpec spec;
+        spec.name = "default";
+        specs.push_back(spec);
+    }
+
+    std::ofstream file;
+    if (!outPath.empty())
+    {
+        file.open(outPath);
+        if (!file)
+        {
+            std::cerr << "Cannot write " << outPath << "\n";
+            return 1;
+        }
+    }
+    std::ostream& out = outPath.empty() ? std::cout : file;
+
+    Replayer replay(specs, out);
+    const auto t0 = std::chrono::steady_clock::now();
+    bool ok = !dbPath.empty() ? replayDb(dbPath, from, to, replay)
+        : !csvPath.empty() ? replayCsv(csvPath, from, to, replay)
+        : replayBinlog(binlogDir, from, to, replay);
+    out.flush();
+    if (!ok)
+    {
+        return 1;
+    }
+    replay.report(std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+    return 0;
+}